@@ -0,0 +1,125 @@
+// Convert a BinaryTraceSink file back into the per-stream text .dat files.
+//
+// The output files, their header lines and the number formatting are the
+// ones the text tracers in prob1_new.cc write, so cwnd.plt and any other
+// plot scripts keep working unchanged:
+//
+//   ./waf --run "prob1_new --binaryTrace=1"
+//   ./waf --run "binary-trace-convert tcp-dynamic-pacing.btrc"
+//
+// The converter does not use the simulator and can also be built on its
+// own:  g++ -O2 -std=c++11 -o binary-trace-convert binary-trace-convert.cc
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "binary-trace-sink.h"
+
+using namespace ns3;
+
+struct OutputStream
+{
+  std::ofstream *out;
+  uint8_t format;
+};
+
+static bool
+ReadString (std::FILE *in, uint16_t length, std::string &s)
+{
+  s.resize (length);
+  return length == 0 || std::fread (&s[0], 1, length, in) == length;
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      std::cerr << "usage: " << argv[0] << " <trace.btrc>\n";
+      return 1;
+    }
+
+  std::FILE *in = std::fopen (argv[1], "rb");
+  if (in == 0)
+    {
+      std::cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+    }
+
+  BinaryTraceFileHeader fh;
+  if (std::fread (&fh, sizeof (fh), 1, in) != 1
+      || std::memcmp (fh.magic, "NS3BTRC1", 8) != 0
+      || fh.recordSize != sizeof (BinaryTraceRecord))
+    {
+      std::cerr << argv[1] << " is not a binary trace file\n";
+      return 1;
+    }
+
+  std::map<uint16_t, OutputStream> streams;
+  for (uint32_t i = 0; i < fh.nStreams; ++i)
+    {
+      BinaryTraceStreamHeader sh;
+      std::string fileName;
+      std::string header;
+      if (std::fread (&sh, sizeof (sh), 1, in) != 1
+          || !ReadString (in, sh.fileNameLength, fileName)
+          || !ReadString (in, sh.headerLength, header))
+        {
+          std::cerr << argv[1] << ": truncated stream table\n";
+          return 1;
+        }
+      OutputStream os;
+      os.out = new std::ofstream (fileName.c_str (), std::ios::out);
+      os.format = sh.format;
+      *os.out << header << "\n";
+      *os.out << std::fixed << std::setprecision (6);
+      streams[sh.id] = os;
+    }
+
+  uint64_t nRecords = 0;
+  std::vector<BinaryTraceRecord> chunk (65536);
+  std::size_t n;
+  while ((n = std::fread (chunk.data (), sizeof (BinaryTraceRecord), chunk.size (), in)) > 0)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        {
+          const BinaryTraceRecord &r = chunk[i];
+          std::map<uint16_t, OutputStream>::iterator it = streams.find (r.stream);
+          if (it == streams.end ())
+            {
+              continue;
+            }
+          std::ofstream &out = *it->second.out;
+          out << r.timeNs / 1e9;
+          switch (it->second.format)
+            {
+            case BinaryTraceSink::FORMAT_INTEGER:
+              out << std::setw (12) << static_cast<uint64_t> (r.value) << "\n";
+              break;
+            case BinaryTraceSink::FORMAT_REAL:
+              out << std::setw (12) << r.value << "\n";
+              break;
+            case BinaryTraceSink::FORMAT_PACKET:
+              out << (r.kind == BinaryTraceSink::KIND_TX ? " tx " : " rx ")
+                  << static_cast<uint64_t> (r.value) << "\n";
+              break;
+            }
+        }
+      nRecords += n;
+    }
+  std::fclose (in);
+
+  for (std::map<uint16_t, OutputStream>::iterator it = streams.begin (); it != streams.end (); ++it)
+    {
+      it->second.out->close ();
+      delete it->second.out;
+    }
+  std::cout << nRecords << " records converted\n";
+  return 0;
+}
@@ -0,0 +1,253 @@
+#ifndef BINARY_TRACE_SINK_H
+#define BINARY_TRACE_SINK_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary trace file layout (native byte order):
+//
+//   BinaryTraceFileHeader
+//   nStreams x { BinaryTraceStreamHeader, file name, header line }
+//   BinaryTraceRecord...              until end of file
+//
+// Each stream describes one of the text .dat files the tracers used to
+// write directly; binary-trace-convert turns the records back into them.
+
+namespace ns3 {
+
+struct BinaryTraceFileHeader
+{
+  char     magic[8];       //!< "NS3BTRC1"
+  uint32_t recordSize;     //!< sizeof (BinaryTraceRecord)
+  uint32_t nStreams;
+};
+
+struct BinaryTraceStreamHeader
+{
+  uint16_t id;
+  uint8_t  format;         //!< BinaryTraceSink::Format
+  uint8_t  reserved;
+  uint16_t fileNameLength;
+  uint16_t headerLength;
+};
+
+struct BinaryTraceRecord
+{
+  int64_t  timeNs;
+  uint16_t stream;
+  uint16_t kind;           //!< BinaryTraceSink::Kind for FORMAT_PACKET streams
+  uint32_t reserved;
+  double   value;
+};
+
+/**
+ * Trace sink that appends fixed-size binary records to an in-memory ring
+ * and drains it to disk on a background writer thread.
+ *
+ * The ring is a fixed number of blocks.  The simulator thread fills one
+ * block without locking; only when a block is full does it hand the block
+ * to the writer under a mutex.  If the writer falls so far behind that all
+ * blocks are full, Append waits for it rather than dropping records.
+ */
+class BinaryTraceSink
+{
+public:
+  /// How binary-trace-convert prints the value of a stream.
+  enum Format
+  {
+    FORMAT_INTEGER = 0,    //!< "time value" with an integer value
+    FORMAT_REAL = 1,       //!< "time value" with a fixed-point value
+    FORMAT_PACKET = 2      //!< "time tx|rx size"
+  };
+
+  enum Kind
+  {
+    KIND_TX = 0,
+    KIND_RX = 1
+  };
+
+  BinaryTraceSink ()
+    : m_file (0),
+      m_blockRecords (0),
+      m_fill (0),
+      m_current (0),
+      m_head (0),
+      m_ready (0),
+      m_stop (false)
+  {
+  }
+
+  ~BinaryTraceSink ()
+  {
+    Close ();
+  }
+
+  /// Declare a stream; must be called before Open.
+  void
+  AddStream (uint16_t id, std::string fileName, std::string header, Format format)
+  {
+    Stream s;
+    s.id = id;
+    s.fileName = fileName;
+    s.header = header;
+    s.format = format;
+    m_streams.push_back (s);
+  }
+
+  /**
+   * \param fileName binary output file
+   * \param nBlocks number of blocks in the ring
+   * \param blockRecords records per block
+   * \return false if the file could not be created
+   */
+  bool
+  Open (std::string fileName, uint32_t nBlocks = 16, uint32_t blockRecords = 8192)
+  {
+    Close ();
+    m_file = std::fopen (fileName.c_str (), "wb");
+    if (m_file == 0)
+      {
+        return false;
+      }
+
+    BinaryTraceFileHeader fh;
+    std::memcpy (fh.magic, "NS3BTRC1", 8);
+    fh.recordSize = sizeof (BinaryTraceRecord);
+    fh.nStreams = m_streams.size ();
+    std::fwrite (&fh, sizeof (fh), 1, m_file);
+    for (std::size_t i = 0; i < m_streams.size (); ++i)
+      {
+        BinaryTraceStreamHeader sh;
+        sh.id = m_streams[i].id;
+        sh.format = m_streams[i].format;
+        sh.reserved = 0;
+        sh.fileNameLength = m_streams[i].fileName.size ();
+        sh.headerLength = m_streams[i].header.size ();
+        std::fwrite (&sh, sizeof (sh), 1, m_file);
+        std::fwrite (m_streams[i].fileName.data (), 1, sh.fileNameLength, m_file);
+        std::fwrite (m_streams[i].header.data (), 1, sh.headerLength, m_file);
+      }
+
+    m_blockRecords = blockRecords;
+    m_blocks.assign (nBlocks < 2 ? 2 : nBlocks, std::vector<BinaryTraceRecord> (blockRecords));
+    m_blockFill.assign (m_blocks.size (), 0);
+    m_fill = 0;
+    m_current = 0;
+    m_head = 0;
+    m_ready = 0;
+    m_stop = false;
+    m_writer = std::thread (&BinaryTraceSink::WriterLoop, this);
+    return true;
+  }
+
+  bool
+  IsOpen (void) const
+  {
+    return m_file != 0;
+  }
+
+  void
+  Append (int64_t timeNs, uint16_t stream, uint16_t kind, double value)
+  {
+    BinaryTraceRecord &r = m_blocks[m_current][m_fill];
+    r.timeNs = timeNs;
+    r.stream = stream;
+    r.kind = kind;
+    r.reserved = 0;
+    r.value = value;
+    if (++m_fill == m_blockRecords)
+      {
+        Submit ();
+      }
+  }
+
+  /// Flush the partially filled block, stop the writer and close the file.
+  void
+  Close (void)
+  {
+    if (m_file == 0)
+      {
+        return;
+      }
+    if (m_fill > 0)
+      {
+        Submit ();
+      }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stop = true;
+    }
+    m_readyCv.notify_one ();
+    m_writer.join ();
+    std::fclose (m_file);
+    m_file = 0;
+    m_blocks.clear ();
+  }
+
+private:
+  struct Stream
+  {
+    uint16_t id;
+    std::string fileName;
+    std::string header;
+    Format format;
+  };
+
+  void
+  Submit (void)
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_blockFill[m_current] = m_fill;
+    ++m_ready;
+    m_readyCv.notify_one ();
+    m_freeCv.wait (lock, [this] { return m_ready < m_blocks.size (); });
+    m_current = (m_current + 1) % m_blocks.size ();
+    m_fill = 0;
+  }
+
+  void
+  WriterLoop (void)
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (true)
+      {
+        m_readyCv.wait (lock, [this] { return m_ready > 0 || m_stop; });
+        if (m_ready == 0)
+          {
+            break;
+          }
+        std::size_t block = m_head;
+        lock.unlock ();
+        std::fwrite (m_blocks[block].data (), sizeof (BinaryTraceRecord), m_blockFill[block], m_file);
+        lock.lock ();
+        m_head = (m_head + 1) % m_blocks.size ();
+        --m_ready;
+        m_freeCv.notify_one ();
+      }
+  }
+
+  std::vector<Stream>                          m_streams;
+  std::FILE                                   *m_file;
+  std::vector<std::vector<BinaryTraceRecord> > m_blocks;
+  std::vector<uint32_t>                        m_blockFill;
+  uint32_t                                     m_blockRecords;
+  uint32_t                                     m_fill;     //!< records in m_current, producer only
+  std::size_t                                  m_current;  //!< block being filled, producer only
+  std::size_t                                  m_head;     //!< next block to write, writer only
+  std::size_t                                  m_ready;    //!< full blocks awaiting the writer
+  bool                                         m_stop;
+  std::mutex                                   m_mutex;
+  std::condition_variable                      m_readyCv;
+  std::condition_variable                      m_freeCv;
+  std::thread                                  m_writer;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_SINK_H */
@@ -0,0 +1,481 @@
+#ifndef COMPRESSED_PCAP_H
+#define COMPRESSED_PCAP_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/wifi-module.h"
+
+namespace ns3 {
+
+/**
+ * Truncated, compressed pcap capture.
+ *
+ * A replacement for PointToPointHelper::EnablePcap and
+ * WifiPhyHelper::EnablePcap on long runs.  Only the first SnapLen bytes of
+ * each frame are copied out of the packet, so headers are kept and
+ * payload is dropped; records are batched into blocks that a background
+ * thread pipes through a compressor (gzip by default) while the
+ * simulation goes on.  With a rotation size, each capture is split into
+ * numbered files once the uncompressed data reaches that size.
+ *
+ * Every file is a standard pcap file once decompressed, with the same
+ * link types and per-device file names ns-3 uses (prefix-node-device):
+ *
+ * \code
+ *   CompressedPcap pcap;
+ *   pcap.SetSnapLen (96);
+ *   pcap.SetMaxFileBytes (100 << 20);
+ *   pcap.EnablePointToPoint ("left-side", devices);
+ *   Simulator::Run ();
+ *   pcap.Close ();
+ *
+ *   zcat left-side-0-1.pcap.gz | tcpdump -r -
+ * \endcode
+ */
+class CompressedPcap
+{
+public:
+  /// libpcap link types, as in PcapHelper
+  enum
+  {
+    DLT_PPP = 9,
+    DLT_IEEE802_11 = 105
+  };
+
+  CompressedPcap ()
+    : m_snapLen (96),
+      m_compressor ("gzip"),
+      m_maxFileBytes (0),
+      m_blockBytes (1 << 20),
+      m_maxQueued (16),
+      m_started (false),
+      m_stop (false)
+  {
+  }
+
+  ~CompressedPcap ()
+  {
+    Close ();
+  }
+
+  /// Bytes kept per frame, 0 for whole frames
+  void SetSnapLen (uint32_t snapLen) { m_snapLen = snapLen; }
+  /// "gzip", "bzip2", "xz", "zstd" or "none"
+  void SetCompressor (std::string compressor) { m_compressor = compressor; }
+  /// Uncompressed size at which to start a new file, 0 for no rotation
+  void SetMaxFileBytes (uint64_t maxFileBytes) { m_maxFileBytes = maxFileBytes; }
+
+  /// Capture everything a point-to-point device sends and receives.
+  void
+  EnablePointToPoint (std::string prefix, NetDeviceContainer devices)
+  {
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice> (*i);
+        NS_ABORT_MSG_UNLESS (device, "EnablePointToPoint needs PointToPointNetDevices");
+        Capture *c = AddCapture (FileName (prefix, device), DLT_PPP);
+        Connect (device, "PromiscSniffer", MakeBoundCallback (&CompressedPcap::Sniff, c));
+      }
+  }
+
+  /// Capture the 802.11 frames a Wi-Fi PHY sends and receives.
+  void
+  EnableWifi (std::string prefix, NetDeviceContainer devices)
+  {
+    for (NetDeviceContainer::Iterator i = devices.Begin (); i != devices.End (); ++i)
+      {
+        Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (*i);
+        NS_ABORT_MSG_UNLESS (device, "EnableWifi needs WifiNetDevices");
+        Capture *c = AddCapture (FileName (prefix, device), DLT_IEEE802_11);
+        Ptr<WifiPhy> phy = device->GetPhy ();
+        Connect (phy, "MonitorSnifferTx", MakeBoundCallback (&CompressedPcap::SniffWifiTx, c));
+        Connect (phy, "MonitorSnifferRx", MakeBoundCallback (&CompressedPcap::SniffWifiRx, c));
+      }
+  }
+
+  /**
+   * Stop capturing, flush all captures and wait for the compressors to
+   * finish.  The trace sinks are disconnected first, so packets sent later
+   * are simply not captured.  Calling it again does nothing.
+   */
+  void
+  Close (void)
+  {
+    if (!m_started)
+      {
+        return;
+      }
+    for (std::size_t i = 0; i < m_hooks.size (); ++i)
+      {
+        m_hooks[i].object->TraceDisconnectWithoutContext (m_hooks[i].name, m_hooks[i].callback);
+      }
+    m_hooks.clear ();
+    for (std::size_t i = 0; i < m_captures.size (); ++i)
+      {
+        Submit (m_captures[i], false);
+      }
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stop = true;
+    }
+    m_ready.notify_one ();
+    m_thread.join ();
+    for (std::size_t i = 0; i < m_captures.size (); ++i)
+      {
+        CloseFile (m_captures[i]);
+        delete m_captures[i];
+      }
+    m_captures.clear ();
+    m_started = false;
+  }
+
+private:
+  struct Capture
+  {
+    CompressedPcap      *owner;
+    std::string          base;
+    uint32_t             linkType;
+    std::vector<uint8_t> block;
+    uint64_t             fileBytes;     //!< uncompressed bytes in the current file
+    uint32_t             fileIndex;
+    std::FILE           *out;           //!< only used by the writer thread
+    pid_t                compressor;    //!< process reading out, 0 for a plain file
+  };
+
+  // A trace sink to disconnect on Close
+  struct Hook
+  {
+    Ptr<Object>  object;
+    std::string  name;
+    CallbackBase callback;
+  };
+
+  struct Job
+  {
+    Capture             *capture;
+    std::vector<uint8_t> data;
+    bool                 rotate;        //!< start a new file after writing data
+  };
+
+  static const uint32_t FILE_HEADER_BYTES = 24;
+  static const uint32_t RECORD_HEADER_BYTES = 16;
+
+  static std::string
+  FileName (std::string prefix, Ptr<NetDevice> device)
+  {
+    std::ostringstream name;
+    name << prefix << "-" << device->GetNode ()->GetId () << "-" << device->GetIfIndex ();
+    return name.str ();
+  }
+
+  Capture *
+  AddCapture (std::string base, uint32_t linkType)
+  {
+    if (!m_started)
+      {
+        m_stop = false;
+        m_thread = std::thread (&CompressedPcap::WriterLoop, this);
+        m_started = true;
+      }
+    Capture *c = new Capture;
+    c->owner = this;
+    c->base = base;
+    c->linkType = linkType;
+    c->block.reserve (m_blockBytes);
+    c->fileBytes = FILE_HEADER_BYTES;
+    c->fileIndex = 0;
+    c->out = 0;
+    c->compressor = 0;
+    m_captures.push_back (c);
+    return c;
+  }
+
+  void
+  Connect (Ptr<Object> object, std::string name, const CallbackBase &callback)
+  {
+    object->TraceConnectWithoutContext (name, callback);
+    Hook h;
+    h.object = object;
+    h.name = name;
+    h.callback = callback;
+    m_hooks.push_back (h);
+  }
+
+  static void
+  Sniff (Capture *c, Ptr<const Packet> p)
+  {
+    c->owner->Write (c, p);
+  }
+
+  static void
+  SniffWifiTx (Capture *c, Ptr<const Packet> p, uint16_t channelFreqMhz, WifiTxVector txVector,
+               MpduInfo aMpdu, uint16_t staId)
+  {
+    c->owner->Write (c, p);
+  }
+
+  static void
+  SniffWifiRx (Capture *c, Ptr<const Packet> p, uint16_t channelFreqMhz, WifiTxVector txVector,
+               MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId)
+  {
+    c->owner->Write (c, p);
+  }
+
+  void
+  Write (Capture *c, Ptr<const Packet> p)
+  {
+    uint32_t length = p->GetSize ();
+    uint32_t captured = (m_snapLen > 0 && length > m_snapLen) ? m_snapLen : length;
+    uint32_t recordBytes = RECORD_HEADER_BYTES + captured;
+    if (m_maxFileBytes > 0 && c->fileBytes + recordBytes > m_maxFileBytes && c->fileBytes > FILE_HEADER_BYTES)
+      {
+        Submit (c, true);
+        c->fileBytes = FILE_HEADER_BYTES;
+      }
+
+    int64_t us = Simulator::Now ().GetMicroSeconds ();
+    uint32_t header[4];
+    header[0] = static_cast<uint32_t> (us / 1000000);
+    header[1] = static_cast<uint32_t> (us % 1000000);
+    header[2] = captured;
+    header[3] = length;
+    std::size_t offset = c->block.size ();
+    c->block.resize (offset + recordBytes);
+    std::memcpy (&c->block[offset], header, RECORD_HEADER_BYTES);
+    p->CopyData (&c->block[offset + RECORD_HEADER_BYTES], captured);
+    c->fileBytes += recordBytes;
+
+    if (c->block.size () >= m_blockBytes)
+      {
+        Submit (c, false);
+      }
+  }
+
+  // Hand the capture's current block to the writer thread, waiting if it
+  // has fallen too far behind.
+  void
+  Submit (Capture *c, bool rotate)
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_space.wait (lock, [this] { return m_jobs.size () < m_maxQueued; });
+    m_jobs.push_back (Job ());
+    Job &job = m_jobs.back ();
+    job.capture = c;
+    job.rotate = rotate;
+    job.data.swap (c->block);
+    if (!m_spare.empty ())
+      {
+        c->block.swap (m_spare.back ());
+        m_spare.pop_back ();
+      }
+    lock.unlock ();
+    m_ready.notify_one ();
+  }
+
+  void
+  WriterLoop (void)
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (true)
+      {
+        m_ready.wait (lock, [this] { return m_stop || !m_jobs.empty (); });
+        if (m_jobs.empty ())
+          {
+            return;
+          }
+        Job job;
+        job.capture = m_jobs.front ().capture;
+        job.rotate = m_jobs.front ().rotate;
+        job.data.swap (m_jobs.front ().data);
+        m_jobs.pop_front ();
+        lock.unlock ();
+        m_space.notify_one ();
+
+        Capture *c = job.capture;
+        if (c->out == 0)
+          {
+            OpenFile (c);
+          }
+        if (c->out != 0 && !job.data.empty ())
+          {
+            std::fwrite (&job.data[0], 1, job.data.size (), c->out);
+          }
+        if (job.rotate)
+          {
+            CloseFile (c);
+            ++c->fileIndex;
+          }
+        job.data.clear ();
+
+        lock.lock ();
+        m_spare.push_back (std::vector<uint8_t> ());
+        m_spare.back ().swap (job.data);
+      }
+  }
+
+  void
+  OpenFile (Capture *c)
+  {
+    std::ostringstream name;
+    name << c->base;
+    if (m_maxFileBytes > 0)
+      {
+        name << "-" << c->fileIndex;
+      }
+    name << ".pcap";
+    if (m_compressor == "none")
+      {
+        c->out = std::fopen (name.str ().c_str (), "wb");
+      }
+    else
+      {
+        const char *argv[4] = { 0, 0, 0, 0 };
+        std::string extension;
+        if (m_compressor == "gzip")
+          {
+            argv[0] = "gzip";
+            argv[1] = "-1";
+            extension = ".gz";
+          }
+        else if (m_compressor == "bzip2")
+          {
+            argv[0] = "bzip2";
+            extension = ".bz2";
+          }
+        else if (m_compressor == "xz")
+          {
+            argv[0] = "xz";
+            argv[1] = "-1";
+            extension = ".xz";
+          }
+        else if (m_compressor == "zstd")
+          {
+            argv[0] = "zstd";
+            argv[1] = "-q";
+            extension = ".zst";
+          }
+        else
+          {
+            NS_FATAL_ERROR ("Unknown pcap compressor " << m_compressor);
+          }
+        name << extension;
+        StartCompressor (c, argv, name.str ());
+      }
+    if (c->out == 0)
+      {
+        NS_FATAL_ERROR ("Cannot open capture file " << name.str ());
+      }
+
+    uint32_t header[6];
+    header[0] = 0xa1b2c3d4;
+    header[1] = 2 | (4 << 16);   // version 2.4
+    header[2] = 0;               // GMT
+    header[3] = 0;               // timestamp accuracy
+    header[4] = m_snapLen > 0 ? m_snapLen : 65535;
+    header[5] = c->linkType;
+    std::fwrite (header, FILE_HEADER_BYTES, 1, c->out);
+  }
+
+  /**
+   * Run the compressor \p argv (which reads stdin) with its output in
+   * \p fileName, and make its input the capture's file.  The file is opened
+   * here and the compressor is started without a shell, so the name is
+   * never parsed as a command.  Both descriptors are close-on-exec, or
+   * every later compressor would hold the pipes of the earlier ones open
+   * and they would never see the end of their input.
+   */
+  static void
+  StartCompressor (Capture *c, const char *argv[], std::string fileName)
+  {
+    int file = open (fileName.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+      {
+        return;
+      }
+    int fds[2];
+    if (pipe (fds) != 0)
+      {
+        close (file);
+        return;
+      }
+    fcntl (file, F_SETFD, FD_CLOEXEC);
+    fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+    pid_t pid = fork ();
+    if (pid == 0)
+      {
+        // This process has other threads: nothing but dup2 and exec here
+        dup2 (fds[0], STDIN_FILENO);
+        dup2 (file, STDOUT_FILENO);
+        execvp (argv[0], const_cast<char *const *> (argv));
+        _exit (127);
+      }
+    close (fds[0]);
+    close (file);
+    if (pid < 0)
+      {
+        close (fds[1]);
+        return;
+      }
+    c->out = fdopen (fds[1], "wb");
+    c->compressor = pid;
+  }
+
+  static void
+  CloseFile (Capture *c)
+  {
+    if (c->out == 0)
+      {
+        return;
+      }
+    std::fclose (c->out);
+    if (c->compressor > 0)
+      {
+        int status;
+        if (waitpid (c->compressor, &status, 0) != c->compressor || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+          {
+            std::cerr << "Pcap compressor for " << c->base << " failed\n";
+          }
+        c->compressor = 0;
+      }
+    c->out = 0;
+  }
+
+  CompressedPcap (const CompressedPcap &);
+  CompressedPcap &operator= (const CompressedPcap &);
+
+  uint32_t                           m_snapLen;
+  std::string                        m_compressor;
+  uint64_t                           m_maxFileBytes;
+  std::size_t                        m_blockBytes;
+  std::size_t                        m_maxQueued;
+  std::vector<Capture *>             m_captures;
+  std::vector<Hook>                  m_hooks;
+  std::deque<Job>                    m_jobs;
+  std::vector<std::vector<uint8_t> > m_spare;   //!< recycled block buffers
+  std::thread                        m_thread;
+  std::mutex                         m_mutex;
+  std::condition_variable            m_ready;
+  std::condition_variable            m_space;
+  bool                               m_started;
+  bool                               m_stop;
+};
+
+} // namespace ns3
+
+#endif /* COMPRESSED_PCAP_H */
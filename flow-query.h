@@ -0,0 +1,413 @@
+#ifndef FLOW_QUERY_H
+#define FLOW_QUERY_H
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+namespace ns3 {
+
+/**
+ * Which flows a FlowQuery selects.  Unset fields match everything.
+ *
+ * \code
+ *   FlowFilter ().Source (Ipv4Address ("10.1.1.1")).Destination (Ipv4Address ("10.1.2.0"), Ipv4Mask ("/24"))
+ * \endcode
+ */
+struct FlowFilter
+{
+  FlowFilter ()
+    : source (0), sourceMask (0), destination (0), destinationMask (0),
+      sourcePort (-1), destinationPort (-1), protocol (-1)
+  {
+  }
+
+  FlowFilter &
+  Source (Ipv4Address address, Ipv4Mask mask = Ipv4Mask::GetOnes ())
+  {
+    sourceMask = mask.Get ();
+    source = address.Get () & sourceMask;
+    return *this;
+  }
+
+  FlowFilter &
+  Destination (Ipv4Address address, Ipv4Mask mask = Ipv4Mask::GetOnes ())
+  {
+    destinationMask = mask.Get ();
+    destination = address.Get () & destinationMask;
+    return *this;
+  }
+
+  FlowFilter &SourcePort (uint16_t port) { sourcePort = port; return *this; }
+  FlowFilter &DestinationPort (uint16_t port) { destinationPort = port; return *this; }
+  FlowFilter &Protocol (uint8_t proto) { protocol = proto; return *this; }
+
+  uint32_t source;
+  uint32_t sourceMask;
+  uint32_t destination;
+  uint32_t destinationMask;
+  int32_t  sourcePort;
+  int32_t  destinationPort;
+  int32_t  protocol;
+};
+
+/// Totals and delay/jitter percentiles of a group of flows
+struct FlowGroupSummary
+{
+  FlowGroupSummary ()
+    : nFlows (0), txPackets (0), rxPackets (0), lostPackets (0), txBytes (0), rxBytes (0),
+      throughputMbps (0), lossRatio (0), meanDelay (0),
+      delayP50 (0), delayP95 (0), delayP99 (0),
+      jitterP50 (0), jitterP95 (0), jitterP99 (0)
+  {
+  }
+
+  uint32_t nFlows;
+  uint64_t txPackets;
+  uint64_t rxPackets;
+  uint64_t lostPackets;
+  uint64_t txBytes;
+  uint64_t rxBytes;
+  double   throughputMbps;  //!< sum of the flows' receive rates
+  double   lossRatio;       //!< lost / (received + lost)
+  double   meanDelay;       //!< seconds
+  double   delayP50;        //!< seconds, to the histogram bin width
+  double   delayP95;
+  double   delayP99;
+  double   jitterP50;
+  double   jitterP95;
+  double   jitterP99;
+};
+
+/**
+ * Indexed queries and percentile summaries over FlowMonitor results.
+ *
+ * Building the query makes one pass over GetFlowStats, resolving each
+ * flow's five-tuple once and sorting flow indices by source address,
+ * destination address and destination port.  A filter on any of those
+ * is then a binary search plus a scan of the matching range; the other
+ * fields are checked on the candidates.  Summaries merge the flows'
+ * delay and jitter histograms bin by bin and read p50/p95/p99 off the
+ * merged counts, so no per-packet data is needed.
+ *
+ * Percentiles are as fine as FlowMonitor's DelayBinWidth and
+ * JitterBinWidth attributes (1ms by default).  The query refers to the
+ * monitor's stats, so build it after the simulation has run.
+ */
+class FlowQuery
+{
+public:
+  FlowQuery (Ptr<FlowMonitor> monitor, Ptr<FlowClassifier> classifier)
+  {
+    Ptr<Ipv4FlowClassifier> ipv4 = DynamicCast<Ipv4FlowClassifier> (classifier);
+    NS_ABORT_MSG_UNLESS (ipv4, "FlowQuery needs an Ipv4FlowClassifier");
+    const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+    m_flows.reserve (stats.size ());
+    for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+      {
+        Ipv4FlowClassifier::FiveTuple t = ipv4->FindFlow (i->first);
+        Flow f;
+        f.id = i->first;
+        f.source = t.sourceAddress.Get ();
+        f.destination = t.destinationAddress.Get ();
+        f.sourcePort = t.sourcePort;
+        f.destinationPort = t.destinationPort;
+        f.protocol = t.protocol;
+        f.stats = &i->second;
+        m_flows.push_back (f);
+      }
+    BuildIndex (m_bySource, &Flow::source);
+    BuildIndex (m_byDestination, &Flow::destination);
+    m_byDestinationPort.resize (m_flows.size ());
+    for (uint32_t i = 0; i < m_flows.size (); ++i)
+      {
+        m_byDestinationPort[i] = i;
+      }
+    std::sort (m_byDestinationPort.begin (), m_byDestinationPort.end (), LessPort (m_flows));
+  }
+
+  std::size_t GetNFlows (void) const { return m_flows.size (); }
+  FlowId GetFlowId (uint32_t i) const { return m_flows[i].id; }
+  const FlowMonitor::FlowStats &GetStats (uint32_t i) const { return *m_flows[i].stats; }
+  Ipv4Address GetSource (uint32_t i) const { return Ipv4Address (m_flows[i].source); }
+  Ipv4Address GetDestination (uint32_t i) const { return Ipv4Address (m_flows[i].destination); }
+
+  /// \return indices (for the Get* accessors) of the matching flows, in FlowId order
+  std::vector<uint32_t>
+  Select (const FlowFilter &filter) const
+  {
+    std::vector<uint32_t> result;
+    const uint32_t *begin;
+    const uint32_t *end;
+    Candidates (filter, begin, end);
+    for (const uint32_t *i = begin; i != end; ++i)
+      {
+        if (Matches (m_flows[*i], filter))
+          {
+            result.push_back (*i);
+          }
+      }
+    std::sort (result.begin (), result.end ());
+    return result;
+  }
+
+  FlowGroupSummary
+  Summarize (const FlowFilter &filter) const
+  {
+    Group group;
+    std::vector<uint32_t> flows = Select (filter);
+    for (std::size_t i = 0; i < flows.size (); ++i)
+      {
+        group.Add (*m_flows[flows[i]].stats);
+      }
+    return group.Finish ();
+  }
+
+  enum GroupKey
+  {
+    BY_SOURCE,             //!< source address under the given mask
+    BY_DESTINATION,        //!< destination address under the given mask
+    BY_DESTINATION_PORT,
+    BY_PROTOCOL
+  };
+
+  /**
+   * Summarize the flows matching \p filter per group, in one pass.  For
+   * the address keys, \p mask groups flows by prefix (/24 gives one group
+   * per destination subnet).
+   */
+  std::map<uint32_t, FlowGroupSummary>
+  SummarizeBy (const FlowFilter &filter, GroupKey key, Ipv4Mask mask = Ipv4Mask::GetOnes ()) const
+  {
+    std::map<uint32_t, Group> groups;
+    const uint32_t *begin;
+    const uint32_t *end;
+    Candidates (filter, begin, end);
+    for (const uint32_t *i = begin; i != end; ++i)
+      {
+        const Flow &f = m_flows[*i];
+        if (!Matches (f, filter))
+          {
+            continue;
+          }
+        uint32_t k = 0;
+        switch (key)
+          {
+          case BY_SOURCE:
+            k = f.source & mask.Get ();
+            break;
+          case BY_DESTINATION:
+            k = f.destination & mask.Get ();
+            break;
+          case BY_DESTINATION_PORT:
+            k = f.destinationPort;
+            break;
+          case BY_PROTOCOL:
+            k = f.protocol;
+            break;
+          }
+        groups[k].Add (*f.stats);
+      }
+    std::map<uint32_t, FlowGroupSummary> result;
+    for (std::map<uint32_t, Group>::iterator g = groups.begin (); g != groups.end (); ++g)
+      {
+        result[g->first] = g->second.Finish ();
+      }
+    return result;
+  }
+
+private:
+  struct Flow
+  {
+    FlowId                         id;
+    uint32_t                       source;
+    uint32_t                       destination;
+    uint16_t                       sourcePort;
+    uint16_t                       destinationPort;
+    uint8_t                        protocol;
+    const FlowMonitor::FlowStats  *stats;
+  };
+
+  struct LessAddress
+  {
+    LessAddress (const std::vector<Flow> &flows, uint32_t Flow::*field) : flows (flows), field (field) {}
+    bool operator() (uint32_t a, uint32_t b) const { return flows[a].*field < flows[b].*field; }
+    bool operator() (uint32_t a, uint64_t value) const { return flows[a].*field < value; }
+    bool operator() (uint64_t value, uint32_t a) const { return value < flows[a].*field; }
+    const std::vector<Flow> &flows;
+    uint32_t Flow::*field;
+  };
+
+  struct LessPort
+  {
+    LessPort (const std::vector<Flow> &flows) : flows (flows) {}
+    bool operator() (uint32_t a, uint32_t b) const { return flows[a].destinationPort < flows[b].destinationPort; }
+    bool operator() (uint32_t a, uint64_t port) const { return flows[a].destinationPort < port; }
+    bool operator() (uint64_t port, uint32_t a) const { return port < flows[a].destinationPort; }
+    const std::vector<Flow> &flows;
+  };
+
+  /// Running totals and merged histograms of one group
+  struct Group
+  {
+    Group () : delaySum (0), delayWidth (0), jitterWidth (0) {}
+
+    void
+    Add (const FlowMonitor::FlowStats &st)
+    {
+      ++summary.nFlows;
+      summary.txPackets += st.txPackets;
+      summary.rxPackets += st.rxPackets;
+      summary.lostPackets += st.lostPackets;
+      summary.txBytes += st.txBytes;
+      summary.rxBytes += st.rxBytes;
+      double duration = (st.timeLastRxPacket - st.timeFirstTxPacket).GetSeconds ();
+      if (st.rxPackets > 0 && duration > 0)
+        {
+          summary.throughputMbps += st.rxBytes * 8.0 / duration / 1e6;
+        }
+      delaySum += st.delaySum.GetSeconds ();
+      Merge (delay, delayWidth, st.delayHistogram);
+      Merge (jitter, jitterWidth, st.jitterHistogram);
+    }
+
+    FlowGroupSummary
+    Finish (void)
+    {
+      uint64_t seen = summary.rxPackets + summary.lostPackets;
+      summary.lossRatio = seen > 0 ? double (summary.lostPackets) / seen : 0;
+      summary.meanDelay = summary.rxPackets > 0 ? delaySum / summary.rxPackets : 0;
+      summary.delayP50 = Percentile (delay, delayWidth, 0.50);
+      summary.delayP95 = Percentile (delay, delayWidth, 0.95);
+      summary.delayP99 = Percentile (delay, delayWidth, 0.99);
+      summary.jitterP50 = Percentile (jitter, jitterWidth, 0.50);
+      summary.jitterP95 = Percentile (jitter, jitterWidth, 0.95);
+      summary.jitterP99 = Percentile (jitter, jitterWidth, 0.99);
+      return summary;
+    }
+
+    static void
+    Merge (std::vector<uint64_t> &bins, double &width, const Histogram &h)
+    {
+      uint32_t n = h.GetNBins ();
+      if (n == 0)
+        {
+          return;
+        }
+      width = h.GetBinWidth (0);
+      if (bins.size () < n)
+        {
+          bins.resize (n, 0);
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          bins[i] += h.GetBinCount (i);
+        }
+    }
+
+    // Linear interpolation inside the bin holding the q-quantile
+    static double
+    Percentile (const std::vector<uint64_t> &bins, double width, double q)
+    {
+      uint64_t total = 0;
+      for (std::size_t i = 0; i < bins.size (); ++i)
+        {
+          total += bins[i];
+        }
+      if (total == 0)
+        {
+          return 0;
+        }
+      double target = q * total;
+      uint64_t below = 0;
+      for (std::size_t i = 0; i < bins.size (); ++i)
+        {
+          if (bins[i] > 0 && below + bins[i] >= target)
+            {
+              return (i + (target - below) / bins[i]) * width;
+            }
+          below += bins[i];
+        }
+      return bins.size () * width;
+    }
+
+    FlowGroupSummary      summary;
+    double                delaySum;
+    std::vector<uint64_t> delay;
+    std::vector<uint64_t> jitter;
+    double                delayWidth;
+    double                jitterWidth;
+  };
+
+  void
+  BuildIndex (std::vector<uint32_t> &index, uint32_t Flow::*field)
+  {
+    index.resize (m_flows.size ());
+    for (uint32_t i = 0; i < m_flows.size (); ++i)
+      {
+        index[i] = i;
+      }
+    std::sort (index.begin (), index.end (), LessAddress (m_flows, field));
+  }
+
+  // Narrow the scan to one sorted index range using the most selective
+  // indexed field of the filter.
+  void
+  Candidates (const FlowFilter &filter, const uint32_t *&begin, const uint32_t *&end) const
+  {
+    const std::vector<uint32_t> *index = &m_bySource;
+    begin = index->empty () ? 0 : &(*index)[0];
+    end = begin + index->size ();
+    if (index->empty ())
+      {
+        return;
+      }
+    if (filter.sourceMask != 0 && filter.sourceMask >= filter.destinationMask)
+      {
+        Range (m_bySource, LessAddress (m_flows, &Flow::source),
+               filter.source, filter.source | ~filter.sourceMask, begin, end);
+      }
+    else if (filter.destinationMask != 0)
+      {
+        Range (m_byDestination, LessAddress (m_flows, &Flow::destination),
+               filter.destination, filter.destination | ~filter.destinationMask, begin, end);
+      }
+    else if (filter.destinationPort >= 0)
+      {
+        Range (m_byDestinationPort, LessPort (m_flows),
+               filter.destinationPort, filter.destinationPort, begin, end);
+      }
+  }
+
+  template <typename Less>
+  static void
+  Range (const std::vector<uint32_t> &index, Less less, uint64_t low, uint64_t high,
+         const uint32_t *&begin, const uint32_t *&end)
+  {
+    const uint32_t *first = &index[0];
+    const uint32_t *last = first + index.size ();
+    begin = std::lower_bound (first, last, low, less);
+    end = std::upper_bound (begin, last, high, less);
+  }
+
+  static bool
+  Matches (const Flow &f, const FlowFilter &filter)
+  {
+    return (f.source & filter.sourceMask) == filter.source
+           && (f.destination & filter.destinationMask) == filter.destination
+           && (filter.sourcePort < 0 || f.sourcePort == filter.sourcePort)
+           && (filter.destinationPort < 0 || f.destinationPort == filter.destinationPort)
+           && (filter.protocol < 0 || f.protocol == filter.protocol);
+  }
+
+  std::vector<Flow>     m_flows;
+  std::vector<uint32_t> m_bySource;
+  std::vector<uint32_t> m_byDestination;
+  std::vector<uint32_t> m_byDestinationPort;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_QUERY_H */
@@ -0,0 +1,55 @@
+// Print a binary FlowMonitor export (see flow-stats-export.h) as text.
+//
+//   ./waf --run "flow-stats-dump lab-2.flowmon.bin"
+//
+// Uses only flow-stats-reader.h, so it can also be built without ns-3:
+//   g++ -O2 -o flow-stats-dump flow-stats-dump.cc
+
+#include <iostream>
+
+#include "flow-stats-reader.h"
+
+using namespace ns3;
+
+static void
+PrintAddress (std::ostream &os, uint32_t a)
+{
+  os << (a >> 24) << "." << ((a >> 16) & 0xff) << "." << ((a >> 8) & 0xff) << "." << (a & 0xff);
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      std::cerr << "usage: " << argv[0] << " <file.flowmon.bin>\n";
+      return 1;
+    }
+
+  FlowStatsReader reader;
+  if (!reader.Open (argv[1]))
+    {
+      std::cerr << "cannot read " << argv[1] << "\n";
+      return 1;
+    }
+
+  for (const FlowStatsRecord *r = reader.begin (); r != reader.end (); ++r)
+    {
+      std::cout << "Flow " << r->flowId << " (";
+      PrintAddress (std::cout, r->sourceAddress);
+      std::cout << ":" << r->sourcePort << " -> ";
+      PrintAddress (std::cout, r->destinationAddress);
+      std::cout << ":" << r->destinationPort << " proto " << unsigned (r->protocol) << ")\n";
+      std::cout << "  Tx Packets: " << r->txPackets << "\n";
+      std::cout << "  Tx Bytes:   " << r->txBytes << "\n";
+      std::cout << "  Rx Packets: " << r->rxPackets << "\n";
+      std::cout << "  Rx Bytes:   " << r->rxBytes << "\n";
+      std::cout << "  Lost:       " << r->lostPackets << "\n";
+      if (r->rxPackets > 0)
+        {
+          std::cout << "  Mean delay: " << r->delaySum / 1e6 / r->rxPackets << " ms\n";
+        }
+    }
+  std::cout << reader.GetNFlows () << " flows\n";
+  return 0;
+}
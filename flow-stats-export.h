@@ -0,0 +1,154 @@
+#ifndef FLOW_STATS_EXPORT_H
+#define FLOW_STATS_EXPORT_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "ns3/flow-monitor-module.h"
+
+#include "flow-stats-format.h"
+
+namespace ns3 {
+
+/**
+ * Streaming replacement for FlowMonitor::SerializeToXmlFile.
+ *
+ * Flows are written one at a time straight from FlowMonitor::GetFlowStats,
+ * either as fixed-size FlowStatsRecord entries (WriteBinary, read back
+ * with FlowStatsReader) or as one CSV line per flow (WriteCsv).  Neither
+ * builds the whole document in memory the way the XML writer does.
+ */
+class FlowStatsExporter
+{
+public:
+  static void
+  Fill (FlowStatsRecord &r, FlowId id, const FlowMonitor::FlowStats &st, const Ipv4FlowClassifier::FiveTuple &t)
+  {
+    std::memset (&r, 0, sizeof (r));
+    r.flowId = id;
+    r.sourceAddress = t.sourceAddress.Get ();
+    r.destinationAddress = t.destinationAddress.Get ();
+    r.sourcePort = t.sourcePort;
+    r.destinationPort = t.destinationPort;
+    r.protocol = t.protocol;
+    r.timesForwarded = st.timesForwarded;
+    r.timeFirstTxPacket = st.timeFirstTxPacket.GetNanoSeconds ();
+    r.timeFirstRxPacket = st.timeFirstRxPacket.GetNanoSeconds ();
+    r.timeLastTxPacket = st.timeLastTxPacket.GetNanoSeconds ();
+    r.timeLastRxPacket = st.timeLastRxPacket.GetNanoSeconds ();
+    r.delaySum = st.delaySum.GetNanoSeconds ();
+    r.jitterSum = st.jitterSum.GetNanoSeconds ();
+    r.lastDelay = st.lastDelay.GetNanoSeconds ();
+    r.txBytes = st.txBytes;
+    r.rxBytes = st.rxBytes;
+    r.txPackets = st.txPackets;
+    r.rxPackets = st.rxPackets;
+    r.lostPackets = st.lostPackets;
+    for (std::size_t i = 0; i < st.packetsDropped.size (); ++i)
+      {
+        r.packetsDropped += st.packetsDropped[i];
+      }
+    for (std::size_t i = 0; i < st.bytesDropped.size (); ++i)
+      {
+        r.bytesDropped += st.bytesDropped[i];
+      }
+  }
+
+  /// \return false if the file could not be written
+  static bool
+  WriteBinary (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, std::string fileName)
+  {
+    std::FILE *out = std::fopen (fileName.c_str (), "wb");
+    if (out == 0)
+      {
+        return false;
+      }
+    FlowStatsFileHeader h;
+    std::memset (&h, 0, sizeof (h));
+    std::memcpy (h.magic, "NS3FMON1", 8);
+    h.recordSize = sizeof (FlowStatsRecord);
+    std::fwrite (&h, sizeof (h), 1, out);
+
+    const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+    FlowStatsRecord r;
+    for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+      {
+        Fill (r, i->first, i->second, classifier->FindFlow (i->first));
+        std::fwrite (&r, sizeof (r), 1, out);
+        ++h.nFlows;
+      }
+
+    if (std::fseek (out, 0, SEEK_SET) == 0)
+      {
+        std::fwrite (&h, sizeof (h), 1, out);
+      }
+    return std::fclose (out) == 0;
+  }
+
+  /// \return false if the file could not be written
+  static bool
+  WriteCsv (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, std::string fileName)
+  {
+    std::FILE *out = std::fopen (fileName.c_str (), "w");
+    if (out == 0)
+      {
+        return false;
+      }
+    std::fputs ("flowId,source,destination,sourcePort,destinationPort,protocol,"
+                "timeFirstTxPacket,timeFirstRxPacket,timeLastTxPacket,timeLastRxPacket,"
+                "delaySum,jitterSum,lastDelay,txBytes,rxBytes,txPackets,rxPackets,"
+                "lostPackets,timesForwarded,packetsDropped,bytesDropped\n", out);
+
+    const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+    FlowStatsRecord r;
+    for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+      {
+        Fill (r, i->first, i->second, classifier->FindFlow (i->first));
+        std::fprintf (out, "%u,%u.%u.%u.%u,%u.%u.%u.%u,%u,%u,%u,"
+                      "%lld,%lld,%lld,%lld,%lld,%lld,%lld,%llu,%llu,%u,%u,%u,%u,%u,%llu\n",
+                      r.flowId,
+                      r.sourceAddress >> 24, (r.sourceAddress >> 16) & 0xff,
+                      (r.sourceAddress >> 8) & 0xff, r.sourceAddress & 0xff,
+                      r.destinationAddress >> 24, (r.destinationAddress >> 16) & 0xff,
+                      (r.destinationAddress >> 8) & 0xff, r.destinationAddress & 0xff,
+                      r.sourcePort, r.destinationPort, r.protocol,
+                      (long long) r.timeFirstTxPacket, (long long) r.timeFirstRxPacket,
+                      (long long) r.timeLastTxPacket, (long long) r.timeLastRxPacket,
+                      (long long) r.delaySum, (long long) r.jitterSum, (long long) r.lastDelay,
+                      (unsigned long long) r.txBytes, (unsigned long long) r.rxBytes,
+                      r.txPackets, r.rxPackets, r.lostPackets, r.timesForwarded,
+                      r.packetsDropped, (unsigned long long) r.bytesDropped);
+      }
+    return std::fclose (out) == 0;
+  }
+
+  /**
+   * Write \p baseName with the extension matching \p format: "bin", "csv",
+   * or "xml" for the original SerializeToXmlFile output with histograms
+   * and probes.
+   */
+  static bool
+  Write (Ptr<FlowMonitor> monitor, Ptr<FlowClassifier> classifier, std::string baseName, std::string format)
+  {
+    if (format == "xml")
+      {
+        monitor->SerializeToXmlFile (baseName + ".flowmon", true, true);
+        return true;
+      }
+    Ptr<Ipv4FlowClassifier> ipv4Classifier = DynamicCast<Ipv4FlowClassifier> (classifier);
+    if (format == "bin")
+      {
+        return WriteBinary (monitor, ipv4Classifier, baseName + ".flowmon.bin");
+      }
+    if (format == "csv")
+      {
+        return WriteCsv (monitor, ipv4Classifier, baseName + ".flowmon.csv");
+      }
+    NS_FATAL_ERROR ("Unknown flow monitor output format " << format);
+    return false;
+  }
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_EXPORT_H */
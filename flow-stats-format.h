@@ -0,0 +1,60 @@
+#ifndef FLOW_STATS_FORMAT_H
+#define FLOW_STATS_FORMAT_H
+
+#include <stdint.h>
+
+// Compact FlowMonitor export format, shared by the writer in
+// flow-stats-export.h and the simulator-independent reader in
+// flow-stats-reader.h.
+//
+// This is a row format, not a columnar one: each flow is one fixed-size
+// FlowStatsRecord holding its 5-tuple and all of its counters, so the
+// writer can stream one flow at a time and the reader can map the file
+// as an array of records.
+//
+//   FlowStatsFileHeader
+//   FlowStatsRecord...                one per flow, in FlowId order
+//
+// All fields are in native byte order; addresses are in host order as
+// returned by Ipv4Address::Get ().  Times are nanoseconds.  Histograms
+// are not exported; use the XML output when they are needed.
+
+namespace ns3 {
+
+struct FlowStatsFileHeader
+{
+  char     magic[8];              //!< "NS3FMON1"
+  uint32_t recordSize;            //!< sizeof (FlowStatsRecord)
+  uint32_t reserved;
+  uint64_t nFlows;                //!< 0 if the writer could not seek back
+};
+
+struct FlowStatsRecord
+{
+  uint32_t flowId;
+  uint32_t sourceAddress;
+  uint32_t destinationAddress;
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+  uint8_t  protocol;
+  uint8_t  reserved[3];
+  uint32_t timesForwarded;
+  int64_t  timeFirstTxPacket;
+  int64_t  timeFirstRxPacket;
+  int64_t  timeLastTxPacket;
+  int64_t  timeLastRxPacket;
+  int64_t  delaySum;
+  int64_t  jitterSum;
+  int64_t  lastDelay;
+  uint64_t txBytes;
+  uint64_t rxBytes;
+  uint64_t bytesDropped;          //!< sum over all drop reasons
+  uint32_t txPackets;
+  uint32_t rxPackets;
+  uint32_t lostPackets;
+  uint32_t packetsDropped;        //!< sum over all drop reasons
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_FORMAT_H */
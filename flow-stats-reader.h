@@ -0,0 +1,131 @@
+#ifndef FLOW_STATS_READER_H
+#define FLOW_STATS_READER_H
+
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flow-stats-format.h"
+
+namespace ns3 {
+
+/**
+ * Read-only view of a file written by FlowStatsExporter::WriteBinary.
+ *
+ * The file is memory-mapped, so opening it costs one mmap regardless of
+ * the number of flows and records are read in place.  This header does
+ * not depend on the simulator and can be used by analysis tools on its
+ * own.
+ *
+ * \code
+ *   FlowStatsReader reader;
+ *   if (reader.Open ("lab-2.flowmon.bin"))
+ *     for (const FlowStatsRecord *r = reader.begin (); r != reader.end (); ++r)
+ *       total += r->rxBytes;
+ * \endcode
+ */
+class FlowStatsReader
+{
+public:
+  FlowStatsReader ()
+    : m_base (0),
+      m_length (0),
+      m_records (0),
+      m_nFlows (0)
+  {
+  }
+
+  ~FlowStatsReader ()
+  {
+    Close ();
+  }
+
+  /// \return false if the file is missing or not a flow stats file
+  bool
+  Open (std::string fileName)
+  {
+    Close ();
+    int fd = open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return false;
+      }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || static_cast<std::size_t> (st.st_size) < sizeof (FlowStatsFileHeader))
+      {
+        close (fd);
+        return false;
+      }
+    void *base = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+      {
+        return false;
+      }
+    m_base = base;
+    m_length = st.st_size;
+
+    const FlowStatsFileHeader *h = static_cast<const FlowStatsFileHeader *> (m_base);
+    if (std::memcmp (h->magic, "NS3FMON1", 8) != 0 || h->recordSize != sizeof (FlowStatsRecord))
+      {
+        Close ();
+        return false;
+      }
+    m_records = reinterpret_cast<const FlowStatsRecord *> (h + 1);
+    m_nFlows = (m_length - sizeof (FlowStatsFileHeader)) / sizeof (FlowStatsRecord);
+    return true;
+  }
+
+  void
+  Close (void)
+  {
+    if (m_base != 0)
+      {
+        munmap (m_base, m_length);
+      }
+    m_base = 0;
+    m_length = 0;
+    m_records = 0;
+    m_nFlows = 0;
+  }
+
+  std::size_t
+  GetNFlows (void) const
+  {
+    return m_nFlows;
+  }
+
+  const FlowStatsRecord &
+  Get (std::size_t i) const
+  {
+    return m_records[i];
+  }
+
+  const FlowStatsRecord *
+  begin (void) const
+  {
+    return m_records;
+  }
+
+  const FlowStatsRecord *
+  end (void) const
+  {
+    return m_records + m_nFlows;
+  }
+
+private:
+  FlowStatsReader (const FlowStatsReader &);
+  FlowStatsReader &operator= (const FlowStatsReader &);
+
+  void                  *m_base;
+  std::size_t            m_length;
+  const FlowStatsRecord *m_records;
+  std::size_t            m_nFlows;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_READER_H */
@@ -0,0 +1,129 @@
+// Memory benchmark for FlowTraceReplay
+//
+// Writes a trace of --flows flows arriving at --rate flows per second
+// between the --endpoints spokes of a point-to-point star (every
+// --udpEvery th flow UDP, the rest TCP, --bytes each), replays it and
+// prints the resident set size every --rssInterval simulated seconds
+// next to the flows started and in progress.  Once the first flows are
+// past TIME_WAIT the RSS column should stay level however many flows the
+// trace has:
+//
+//   ./waf --run "flow-trace-bench --flows=10000000 --rate=10000"
+//
+// Closed TCP senders stay in TIME_WAIT for twice --maxSegLifetime, so
+// the level reached grows with it and with the arrival rate.
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/point-to-point-layout-module.h"
+
+#include "flow-trace-replay.h"
+#include "topology-builder.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FlowTraceBench");
+
+static void
+WriteTrace (std::string fileName, uint64_t nFlows, uint32_t nEndpoints, double rate, uint64_t bytes,
+            uint32_t udpEvery)
+{
+  std::FILE *out = std::fopen (fileName.c_str (), "wb");
+  NS_ABORT_MSG_IF (out == 0, "Cannot write " << fileName);
+  FlowTraceFileHeader h;
+  std::memcpy (h.magic, "NS3FLOW1", 8);
+  h.recordSize = sizeof (FlowTraceRecord);
+  h.nEndpoints = nEndpoints;
+  h.nFlows = nFlows;
+  std::fwrite (&h, sizeof (h), 1, out);
+
+  // Written in blocks, so generating the trace does not take memory either
+  std::vector<FlowTraceRecord> block (4096);
+  std::memset (&block[0], 0, block.size () * sizeof (FlowTraceRecord));
+  for (uint64_t i = 0; i < nFlows; )
+    {
+      std::size_t n = 0;
+      for (; n < block.size () && i < nFlows; ++n, ++i)
+        {
+          FlowTraceRecord &r = block[n];
+          r.startNs = static_cast<int64_t> (1e9 + i * 1e9 / rate);
+          r.bytes = bytes;
+          r.source = i % nEndpoints;
+          r.destination = (r.source + 1 + (i / nEndpoints) % (nEndpoints - 1)) % nEndpoints;
+          r.protocol = (udpEvery > 0 && i % udpEvery == 0) ? 17 : 6;
+        }
+      std::fwrite (&block[0], sizeof (FlowTraceRecord), n, out);
+    }
+  NS_ABORT_MSG_IF (std::fclose (out) != 0, "Cannot write " << fileName);
+}
+
+static void
+SampleRss (FlowTraceReplay *replay, Time interval)
+{
+  std::cout << Simulator::Now ().GetSeconds () << "\t" << replay->GetNStarted ()
+            << "\t" << replay->GetNInProgress ()
+            << "\t" << TopologyBuilder::GetRssBytes () / (1024.0 * 1024.0) << std::endl;
+  Simulator::Schedule (interval, &SampleRss, replay, interval);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t nFlows = 1000000;
+  uint32_t nEndpoints = 16;
+  double rate = 10000;
+  uint64_t bytes = 2000;
+  uint32_t udpEvery = 10;
+  double rssInterval = 10;
+  double maxSegLifetime = 1;
+  std::string fileName = "flow-trace-bench.ftrc";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("flows", "Flows in the generated trace", nFlows);
+  cmd.AddValue ("endpoints", "Spokes of the star, the trace's endpoints", nEndpoints);
+  cmd.AddValue ("rate", "Flow arrivals per second", rate);
+  cmd.AddValue ("bytes", "Bytes per flow", bytes);
+  cmd.AddValue ("udpEvery", "Make every this many flows UDP (0 for none)", udpEvery);
+  cmd.AddValue ("rssInterval", "RSS sampling interval in simulated seconds", rssInterval);
+  cmd.AddValue ("maxSegLifetime", "TCP MaxSegLifetime in seconds (TIME_WAIT is twice this)", maxSegLifetime);
+  cmd.AddValue ("file", "Where to write the generated trace", fileName);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (nEndpoints < 2, "Need at least two endpoints");
+
+  Config::SetDefault ("ns3::TcpSocketBase::MaxSegLifetime", DoubleValue (maxSegLifetime));
+  WriteTrace (fileName, nFlows, nEndpoints, rate, bytes, udpEvery);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Gbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  PointToPointStarHelper star (nEndpoints, p2p);
+  InternetStackHelper stack;
+  star.InstallStack (stack);
+  star.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.252"));
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  FlowTraceReplay replay;
+  for (uint32_t i = 0; i < nEndpoints; ++i)
+    {
+      replay.AddEndpoint (star.GetSpokeNode (i), star.GetSpokeIpv4Address (i));
+    }
+  replay.SetUdpRate (DataRate ("100Mbps"));
+  replay.Start (fileName);
+
+  double duration = 1 + nFlows / rate + 2 * maxSegLifetime + 1;
+  std::cout << "#Time(s)\tstarted\tin progress\tRSS (MB)\n";
+  Simulator::Schedule (Seconds (rssInterval), &SampleRss, &replay, Seconds (rssInterval));
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+  replay.Report (std::cout);
+  Simulator::Destroy ();
+  std::remove (fileName.c_str ());
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Convert a CSV flow log into the memory-mapped flow arrival format
+// replayed by FlowTraceReplay.
+//
+//   flow-trace-convert flows.csv flows.ftrc
+//
+// Each line is "start,source,destination,bytes,protocol": the start time
+// in seconds, source and destination endpoint indices, the flow size in
+// bytes and "tcp", "udp", 6 or 17.  Blank lines, '#' comments and a
+// header line are skipped.  Flows are sorted by start time.
+//
+// The converter does not use the simulator and can also be built on its
+// own:  g++ -O2 -std=c++11 -o flow-trace-convert flow-trace-convert.cc
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "flow-trace-format.h"
+
+using namespace ns3;
+
+static bool
+EarlierFlow (const FlowTraceRecord &a, const FlowTraceRecord &b)
+{
+  return a.startNs < b.startNs;
+}
+
+static bool
+ParseProtocol (const char *name, uint8_t &protocol)
+{
+  if (std::strcmp (name, "tcp") == 0 || std::strcmp (name, "TCP") == 0 || std::strcmp (name, "6") == 0)
+    {
+      protocol = 6;
+      return true;
+    }
+  if (std::strcmp (name, "udp") == 0 || std::strcmp (name, "UDP") == 0 || std::strcmp (name, "17") == 0)
+    {
+      protocol = 17;
+      return true;
+    }
+  return false;
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 3)
+    {
+      std::cerr << "usage: " << argv[0] << " <flows.csv> <output.ftrc>\n";
+      return 1;
+    }
+  std::ifstream in (argv[1]);
+  if (!in)
+    {
+      std::cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+    }
+
+  std::vector<FlowTraceRecord> flows;
+  uint32_t nEndpoints = 0;
+  std::string line;
+  uint64_t lineNo = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNo;
+      std::size_t first = line.find_first_not_of (" \t\r");
+      if (first == std::string::npos || line[first] == '#')
+        {
+          continue;
+        }
+      double start;
+      unsigned source, destination;
+      unsigned long long bytes;
+      char protocol[16];
+      FlowTraceRecord r;
+      std::memset (&r, 0, sizeof (r));
+      if (std::sscanf (line.c_str (), " %lf , %u , %u , %llu , %15[A-Za-z0-9]",
+                       &start, &source, &destination, &bytes, protocol) != 5
+          || !ParseProtocol (protocol, r.protocol))
+        {
+          if (flows.empty () && lineNo == 1)
+            {
+              continue;           // header line
+            }
+          std::cerr << argv[1] << ":" << lineNo << ": bad flow: " << line << "\n";
+          return 1;
+        }
+      r.startNs = llround (start * 1e9);
+      r.bytes = bytes;
+      r.source = source;
+      r.destination = destination;
+      nEndpoints = std::max (nEndpoints, std::max (source, destination) + 1);
+      flows.push_back (r);
+    }
+  std::stable_sort (flows.begin (), flows.end (), EarlierFlow);
+
+  std::FILE *out = std::fopen (argv[2], "wb");
+  if (out == 0)
+    {
+      std::cerr << "cannot write " << argv[2] << "\n";
+      return 1;
+    }
+  FlowTraceFileHeader h;
+  std::memcpy (h.magic, "NS3FLOW1", 8);
+  h.recordSize = sizeof (FlowTraceRecord);
+  h.nEndpoints = nEndpoints;
+  h.nFlows = flows.size ();
+  std::fwrite (&h, sizeof (h), 1, out);
+  if (!flows.empty ())
+    {
+      std::fwrite (&flows[0], sizeof (FlowTraceRecord), flows.size (), out);
+    }
+  if (std::fclose (out) != 0)
+    {
+      std::cerr << "cannot write " << argv[2] << "\n";
+      return 1;
+    }
+  std::cout << flows.size () << " flows, " << nEndpoints << " endpoints\n";
+  return 0;
+}
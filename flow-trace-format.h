@@ -0,0 +1,146 @@
+#ifndef FLOW_TRACE_FORMAT_H
+#define FLOW_TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Flow arrival file, written by flow-trace-convert and replayed by
+// FlowTraceReplay (flow-trace-replay.h).
+//
+//   FlowTraceFileHeader
+//   FlowTraceRecord...                nFlows, sorted by start time
+//
+// Source and destination are endpoint indices, which the scenario maps
+// to nodes.  All fields are in native byte order; times are nanoseconds.
+
+namespace ns3 {
+
+struct FlowTraceFileHeader
+{
+  char     magic[8];              //!< "NS3FLOW1"
+  uint32_t recordSize;            //!< sizeof (FlowTraceRecord)
+  uint32_t nEndpoints;            //!< largest endpoint index + 1
+  uint64_t nFlows;
+};
+
+struct FlowTraceRecord
+{
+  int64_t  startNs;
+  uint64_t bytes;
+  uint32_t source;
+  uint32_t destination;
+  uint8_t  protocol;              //!< 6 for TCP, 17 for UDP
+  uint8_t  reserved[7];
+};
+
+/**
+ * Read-only, memory-mapped view of a flow arrival file.
+ *
+ * Records are meant to be read in order: the mapping is advised as
+ * sequential, and Release gives back the pages of the records already
+ * consumed, so the resident size stays flat however long the trace.
+ * Like MobilityTraceReader this header does not depend on the simulator.
+ */
+class FlowTraceReader
+{
+public:
+  FlowTraceReader ()
+    : m_base (0),
+      m_length (0),
+      m_records (0),
+      m_released (0)
+  {
+    std::memset (&m_header, 0, sizeof (m_header));
+  }
+
+  ~FlowTraceReader ()
+  {
+    Close ();
+  }
+
+  /// \return false if the file is missing, truncated or not a flow trace
+  bool
+  Open (std::string fileName)
+  {
+    Close ();
+    int fd = open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return false;
+      }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || static_cast<std::size_t> (st.st_size) < sizeof (FlowTraceFileHeader))
+      {
+        close (fd);
+        return false;
+      }
+    void *base = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+      {
+        return false;
+      }
+    m_base = base;
+    m_length = st.st_size;
+    std::memcpy (&m_header, m_base, sizeof (m_header));
+    if (std::memcmp (m_header.magic, "NS3FLOW1", 8) != 0 || m_header.recordSize != sizeof (FlowTraceRecord)
+        || m_length < sizeof (FlowTraceFileHeader) + m_header.nFlows * sizeof (FlowTraceRecord))
+      {
+        Close ();
+        return false;
+      }
+    m_records = reinterpret_cast<const FlowTraceRecord *> (static_cast<const char *> (m_base) + sizeof (FlowTraceFileHeader));
+    madvise (m_base, m_length, MADV_SEQUENTIAL);
+    return true;
+  }
+
+  void
+  Close (void)
+  {
+    if (m_base != 0)
+      {
+        munmap (m_base, m_length);
+      }
+    m_base = 0;
+    m_length = 0;
+    m_records = 0;
+    m_released = 0;
+    std::memset (&m_header, 0, sizeof (m_header));
+  }
+
+  uint64_t GetNFlows (void) const { return m_header.nFlows; }
+  uint32_t GetNEndpoints (void) const { return m_header.nEndpoints; }
+  const FlowTraceRecord &Get (uint64_t i) const { return m_records[i]; }
+
+  /// Drop the pages holding only records before \p next from memory
+  void
+  Release (uint64_t next)
+  {
+    std::size_t page = sysconf (_SC_PAGESIZE);
+    std::size_t end = (sizeof (FlowTraceFileHeader) + next * sizeof (FlowTraceRecord)) / page * page;
+    if (end > m_released)
+      {
+        madvise (static_cast<char *> (m_base) + m_released, end - m_released, MADV_DONTNEED);
+        m_released = end;
+      }
+  }
+
+private:
+  FlowTraceReader (const FlowTraceReader &);
+  FlowTraceReader &operator= (const FlowTraceReader &);
+
+  void                  *m_base;
+  std::size_t            m_length;
+  FlowTraceFileHeader    m_header;
+  const FlowTraceRecord *m_records;
+  std::size_t            m_released;    //!< bytes from the start already given back
+};
+
+} // namespace ns3
+
+#endif /* FLOW_TRACE_FORMAT_H */
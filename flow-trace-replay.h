@@ -0,0 +1,309 @@
+#ifndef FLOW_TRACE_REPLAY_H
+#define FLOW_TRACE_REPLAY_H
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+#include "flow-trace-format.h"
+
+namespace ns3 {
+
+/**
+ * Replays a flow arrival file (see flow-trace-format.h) into the
+ * simulation.
+ *
+ * The file is memory-mapped and read in order by a single arrival event,
+ * which starts every flow due at its time and reschedules itself for the
+ * next start time, so flows are created just in time.  A TCP flow opens
+ * a socket on its source endpoint, writes its bytes as fast as the send
+ * buffer allows and closes; it is complete when the receiver sees the
+ * close.  A UDP flow sends packets at UdpRate from its source endpoint's
+ * one UDP socket.
+ *
+ * Every endpoint gets a UDP PacketSink and a TCP listener.  Unlike
+ * PacketSink, which keeps every socket it accepts, the listener lets go
+ * of a connection once the peer has closed it.  With the pages of the
+ * records already replayed given back as well, only the flows in
+ * progress take memory, however many flows the trace has (closed TCP
+ * senders are among them until TIME_WAIT ends; see flow-trace-bench).
+ *
+ * \code
+ *   FlowTraceReplay replay;
+ *   replay.AddEndpoint (staNodes.Get (0), staInterfaces.GetAddress (0));   // endpoint 0
+ *   replay.AddEndpoint (serverNode, serverAddress);                         // endpoint 1
+ *   replay.Start ("flows.ftrc");
+ * \endcode
+ */
+class FlowTraceReplay
+{
+public:
+  FlowTraceReplay ()
+    : m_port (9000),
+      m_packetSize (1448),
+      m_udpRate ("1Mbps"),
+      m_next (0),
+      m_started (0),
+      m_completed (0),
+      m_failed (0),
+      m_peakActive (0),
+      m_bytesSent (0)
+  {
+  }
+
+  /// Endpoint with the next index, reached at \p address
+  void
+  AddEndpoint (Ptr<Node> node, Ipv4Address address)
+  {
+    m_nodes.push_back (node);
+    m_addresses.push_back (address);
+  }
+
+  /// Port of the receivers (default 9000)
+  void SetPort (uint16_t port) { m_port = port; }
+  /// Largest write or UDP packet (default 1448 bytes)
+  void SetPacketSize (uint32_t size) { m_packetSize = size; }
+  /// Sending rate of UDP flows (default 1Mbps)
+  void SetUdpRate (DataRate rate) { m_udpRate = rate; }
+
+  void
+  Start (std::string fileName)
+  {
+    NS_ABORT_MSG_UNLESS (m_reader.Open (fileName), fileName << " is not a flow trace file");
+    NS_ABORT_MSG_IF (m_reader.GetNEndpoints () > m_nodes.size (),
+                     fileName << " has " << m_reader.GetNEndpoints () << " endpoints, " << m_nodes.size () << " given");
+    PacketSinkHelper udpSink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), m_port));
+    for (uint32_t i = 0; i < m_nodes.size (); ++i)
+      {
+        m_udpSinks.Add (udpSink.Install (m_nodes[i]));
+        Ptr<Socket> udp = Socket::CreateSocket (m_nodes[i], UdpSocketFactory::GetTypeId ());
+        udp->Bind ();
+        m_udpSockets.push_back (udp);
+        Ptr<Socket> listener = Socket::CreateSocket (m_nodes[i], TcpSocketFactory::GetTypeId ());
+        listener->Bind (InetSocketAddress (Ipv4Address::GetAny (), m_port));
+        listener->Listen ();
+        listener->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                                     MakeBoundCallback (&FlowTraceReplay::Accept, this, i));
+        m_listeners.push_back (listener);
+      }
+    m_tcpRx.assign (m_nodes.size (), 0);
+    ScheduleNext ();
+  }
+
+  uint32_t GetNEndpoints (void) const { return m_nodes.size (); }
+
+  /// Bytes received so far by \p endpoint over TCP and UDP, for ThroughputSampler
+  Callback<uint64_t>
+  GetRxCounter (uint32_t endpoint)
+  {
+    return MakeBoundCallback (&FlowTraceReplay::TotalRx, this, endpoint);
+  }
+
+  uint64_t GetNStarted (void) const { return m_started; }
+  uint64_t GetNInProgress (void) const { return m_started - m_completed - m_failed; }
+
+  void
+  Report (std::ostream &os) const
+  {
+    os << "Flow trace: " << m_started << " of " << m_reader.GetNFlows () << " flows started, "
+       << m_completed << " completed, " << m_failed << " failed, "
+       << GetNInProgress () << " in progress (peak " << m_peakActive << "), "
+       << m_accepted.size () << " TCP connections open at the receivers, "
+       << m_bytesSent << " bytes sent\n";
+  }
+
+private:
+  void
+  ScheduleNext (void)
+  {
+    if (m_next < m_reader.GetNFlows ())
+      {
+        Time start = NanoSeconds (m_reader.Get (m_next).startNs);
+        m_arrival = Simulator::Schedule (std::max (start - Simulator::Now (), Time ()), &FlowTraceReplay::Arrive, this);
+      }
+  }
+
+  // The one arrival event: start every flow due now
+  void
+  Arrive (void)
+  {
+    int64_t now = Simulator::Now ().GetNanoSeconds ();
+    while (m_next < m_reader.GetNFlows () && m_reader.Get (m_next).startNs <= now)
+      {
+        StartFlow (m_reader.Get (m_next));
+        ++m_next;
+      }
+    m_reader.Release (m_next);
+    ScheduleNext ();
+  }
+
+  void
+  StartFlow (const FlowTraceRecord &r)
+  {
+    NS_ABORT_MSG_IF (r.source >= m_nodes.size () || r.destination >= m_nodes.size (), "Flow endpoint out of range");
+    ++m_started;
+    m_peakActive = std::max (m_peakActive, GetNInProgress ());
+    if (r.bytes == 0)
+      {
+        ++m_completed;
+      }
+    else if (r.protocol == 6)
+      {
+        Ptr<Socket> socket = Socket::CreateSocket (m_nodes[r.source], TcpSocketFactory::GetTypeId ());
+        m_writing[socket] = r.bytes;
+        socket->SetConnectCallback (MakeCallback (&FlowTraceReplay::Connected, this),
+                                    MakeCallback (&FlowTraceReplay::SenderFailed, this));
+        socket->SetSendCallback (MakeCallback (&FlowTraceReplay::SendTcp, this));
+        socket->SetCloseCallbacks (MakeNullCallback<void, Ptr<Socket> > (),
+                                   MakeCallback (&FlowTraceReplay::SenderFailed, this));
+        socket->Bind ();
+        socket->Connect (InetSocketAddress (m_addresses[r.destination], m_port));
+      }
+    else
+      {
+        SendUdp (r.source, m_addresses[r.destination], r.bytes);
+      }
+  }
+
+  void
+  Connected (Ptr<Socket> socket)
+  {
+    SendTcp (socket, socket->GetTxAvailable ());
+  }
+
+  void
+  SendTcp (Ptr<Socket> socket, uint32_t available)
+  {
+    std::map<Ptr<Socket>, uint64_t>::iterator i = m_writing.find (socket);
+    if (i == m_writing.end ())
+      {
+        return;
+      }
+    uint64_t &left = i->second;
+    while (left > 0 && socket->GetTxAvailable () > 0)
+      {
+        uint32_t size = std::min<uint64_t> (std::min (left, uint64_t (m_packetSize)), socket->GetTxAvailable ());
+        int sent = socket->Send (Create<Packet> (size));
+        if (sent <= 0)
+          {
+            break;
+          }
+        left -= sent;
+        m_bytesSent += sent;
+      }
+    if (left == 0)
+      {
+        // The stack keeps the socket until the connection has closed
+        m_writing.erase (i);
+        socket->Close ();
+      }
+  }
+
+  // Connection refused or reset on the sending side
+  void
+  SenderFailed (Ptr<Socket> socket)
+  {
+    ++m_failed;
+    if (m_writing.erase (socket) > 0)
+      {
+        socket->Close ();
+      }
+  }
+
+  void
+  SendUdp (uint32_t source, Ipv4Address destination, uint64_t left)
+  {
+    uint32_t size = std::min (left, uint64_t (m_packetSize));
+    if (m_udpSockets[source]->SendTo (Create<Packet> (size), 0, InetSocketAddress (destination, m_port)) > 0)
+      {
+        m_bytesSent += size;
+      }
+    left -= size;
+    if (left == 0)
+      {
+        ++m_completed;
+        return;
+      }
+    Simulator::Schedule (m_udpRate.CalculateBytesTxTime (size), &FlowTraceReplay::SendUdp, this,
+                         source, destination, left);
+  }
+
+  static void
+  Accept (FlowTraceReplay *self, uint32_t endpoint, Ptr<Socket> socket, const Address &from)
+  {
+    socket->SetRecvCallback (MakeBoundCallback (&FlowTraceReplay::Receive, self, endpoint));
+    socket->SetCloseCallbacks (MakeCallback (&FlowTraceReplay::PeerClosed, self),
+                               MakeCallback (&FlowTraceReplay::PeerFailed, self));
+    self->m_accepted.insert (socket);
+  }
+
+  static void
+  Receive (FlowTraceReplay *self, uint32_t endpoint, Ptr<Socket> socket)
+  {
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv ()) && packet->GetSize () > 0)
+      {
+        self->m_tcpRx[endpoint] += packet->GetSize ();
+      }
+  }
+
+  // The sender closed after its last byte: the flow is complete
+  void
+  PeerClosed (Ptr<Socket> socket)
+  {
+    ++m_completed;
+    Forget (socket);
+  }
+
+  // Counted as failed by the sender
+  void
+  PeerFailed (Ptr<Socket> socket)
+  {
+    Forget (socket);
+  }
+
+  void
+  Forget (Ptr<Socket> socket)
+  {
+    socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+    socket->Close ();
+    m_accepted.erase (socket);
+  }
+
+  static uint64_t
+  TotalRx (FlowTraceReplay *self, uint32_t endpoint)
+  {
+    return self->m_tcpRx[endpoint] + DynamicCast<PacketSink> (self->m_udpSinks.Get (endpoint))->GetTotalRx ();
+  }
+
+  std::vector<Ptr<Node> >         m_nodes;
+  std::vector<Ipv4Address>        m_addresses;
+  uint16_t                        m_port;
+  uint32_t                        m_packetSize;
+  DataRate                        m_udpRate;
+  FlowTraceReader                 m_reader;
+  uint64_t                        m_next;       //!< next record to replay
+  EventId                         m_arrival;
+  ApplicationContainer            m_udpSinks;   //!< one per endpoint
+  std::vector<Ptr<Socket> >       m_udpSockets; //!< UDP flows' sending socket, one per endpoint
+  std::vector<Ptr<Socket> >       m_listeners;
+  std::vector<uint64_t>           m_tcpRx;      //!< bytes received over TCP, per endpoint
+  std::map<Ptr<Socket>, uint64_t> m_writing;    //!< TCP flows with bytes left to write
+  std::set<Ptr<Socket> >          m_accepted;   //!< TCP connections the peer has not closed
+  uint64_t                        m_started;
+  uint64_t                        m_completed;
+  uint64_t                        m_failed;
+  uint64_t                        m_peakActive;
+  uint64_t                        m_bytesSent;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_TRACE_REPLAY_H */
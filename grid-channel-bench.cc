@@ -0,0 +1,184 @@
+// Range culling benchmark for GridSpectrumChannel
+//
+// Places --nodes (a comma separated list) 802.11b ad hoc nodes at random
+// in a fixed --area x --area square, every node broadcasting a small UDP
+// packet --rate times per second, and runs each node count twice: on a
+// plain SingleModelSpectrumChannel and on a GridSpectrumChannel whose
+// range is where the log-distance loss drops below RxSensitivity.
+// Reports simulator events and receive events scheduled by the channel
+// per transmission, wall clock time and broadcast packets received
+// (the same with and without culling).
+//
+//   ./waf --run "grid-channel-bench --nodes=100,200,400,800 --area=2000"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/spectrum-module.h"
+
+#include "grid-spectrum-channel.h"
+#include "trace-attach.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("GridChannelBench");
+
+static uint64_t g_tx = 0;
+static uint64_t g_rx = 0;
+
+static void
+PhyTx (Ptr<const Packet> p, double txPowerW)
+{
+  ++g_tx;
+}
+
+static void
+SinkRx (Ptr<const Packet> p, const Address &from)
+{
+  ++g_rx;
+}
+
+struct RunResult
+{
+  uint64_t transmissions;
+  uint64_t deliveries;
+  uint64_t events;
+  uint64_t received;
+  double   seconds;
+};
+
+static RunResult
+Run (uint32_t nNodes, double area, double rate, double duration, bool grid)
+{
+  g_tx = 0;
+  g_rx = 0;
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<SpectrumChannel> channel;
+  Ptr<GridSpectrumChannel> gridChannel;
+  if (grid)
+    {
+      // Default TxPowerEnd and RxSensitivity of the PHY
+      gridChannel = CreateObject<GridSpectrumChannel> ();
+      gridChannel->SetMaxRange (GridSpectrumChannel::GetRange (loss, 16.0206, -101));
+      channel = gridChannel;
+    }
+  else
+    {
+      channel = CreateObject<SingleModelSpectrumChannel> ();
+    }
+  channel->AddPropagationLossModel (loss);
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+
+  SpectrumWifiPhyHelper spectrumPhy = SpectrumWifiPhyHelper::Default ();
+  spectrumPhy.SetChannel (channel);
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue ("DsssRate1Mbps"),
+                                "ControlMode", StringValue ("DsssRate1Mbps"));
+  NetDeviceContainer devices = wifi.Install (spectrumPhy, wifiMac, nodes);
+  wifi.AssignStreams (devices, 100);
+
+  // Fixed streams so both channels see the same placement and backoffs
+  std::ostringstream bound;
+  bound << "ns3::UniformRandomVariable[Min=0.0|Max=" << area << "]";
+  Ptr<RandomRectanglePositionAllocator> positions = CreateObject<RandomRectanglePositionAllocator> ();
+  positions->SetAttribute ("X", StringValue (bound.str ()));
+  positions->SetAttribute ("Y", StringValue (bound.str ()));
+  positions->AssignStreams (10);
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (positions);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.0.0", "255.255.0.0");
+  ipv4.Assign (devices);
+
+  uint16_t port = 9;
+  PacketSinkHelper sinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer sinks = sinkHelper.Install (nodes);
+  OnOffHelper onOff ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address ("255.255.255.255"), port));
+  onOff.SetConstantRate (DataRate (static_cast<uint64_t> (rate * 100 * 8)), 100);
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      ApplicationContainer app = onOff.Install (nodes.Get (i));
+      // Spread the first packets over one period
+      app.Start (Seconds (1.0 + i / (rate * nNodes)));
+      app.Stop (Seconds (1.0 + duration));
+    }
+
+  TraceAttach::Applications<PacketSink> (sinks, "Rx", MakeCallback (&SinkRx));
+  for (uint32_t i = 0; i < devices.GetN (); ++i)
+    {
+      DynamicCast<WifiNetDevice> (devices.Get (i))->GetPhy ()
+        ->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&PhyTx));
+    }
+
+  Simulator::Stop (Seconds (1.5 + duration));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now () - start;
+
+  RunResult result;
+  result.transmissions = g_tx;
+  result.deliveries = grid ? gridChannel->GetNDeliveries () : g_tx * (nNodes - 1);
+  result.events = Simulator::GetEventCount ();
+  result.received = g_rx;
+  result.seconds = wall.count ();
+  Simulator::Destroy ();
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string nodeCounts = "100,200,400";
+  double area = 2000.0;
+  double rate = 5.0;
+  double duration = 5.0;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nodes", "Comma separated node counts", nodeCounts);
+  cmd.AddValue ("area", "Side of the square area in meters", area);
+  cmd.AddValue ("rate", "Broadcast packets per second per node", rate);
+  cmd.AddValue ("duration", "Seconds of traffic", duration);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint32_t> counts;
+  std::istringstream list (nodeCounts);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      counts.push_back (std::stoul (item));
+    }
+
+  std::cout << "Nodes\tNodes/km2\tChannel\tTx\tRxEvents/Tx\tEvents/Tx\tReceived\tWall(s)\n";
+  for (std::size_t i = 0; i < counts.size (); ++i)
+    {
+      double density = counts[i] / (area * area / 1e6);
+      for (int grid = 0; grid < 2; ++grid)
+        {
+          RunResult r = Run (counts[i], area, rate, duration, grid);
+          double tx = r.transmissions > 0 ? r.transmissions : 1;
+          std::cout << counts[i] << "\t" << density << "\t" << (grid ? "grid" : "single")
+                    << "\t" << r.transmissions << "\t" << r.deliveries / tx << "\t" << r.events / tx
+                    << "\t" << r.received << "\t" << r.seconds << "\n";
+        }
+    }
+  return 0;
+}
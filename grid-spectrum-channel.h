@@ -0,0 +1,436 @@
+#ifndef GRID_SPECTRUM_CHANNEL_H
+#define GRID_SPECTRUM_CHANNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/antenna-module.h"
+
+namespace ns3 {
+
+/**
+ * Single-model spectrum channel that only delivers a transmission to the
+ * PHYs within MaxRange of the sender.
+ *
+ * SingleModelSpectrumChannel (like YansWifiChannel) computes the path loss
+ * to every attached PHY and schedules a receive event for each, even
+ * for PHYs so far away that the signal will be dropped as below the
+ * receiver's sensitivity.  This channel keeps the receivers in a uniform
+ * 2D grid of CellSize cells and, per transmission, only looks at the
+ * cells within MaxRange of the sender; the candidates are then handled
+ * exactly as SingleModelSpectrumChannel does, in the order they were
+ * attached.
+ *
+ * Receivers are binned by position every RebinInterval and whenever
+ * their mobility model reports a course change.  Between rebins the
+ * search radius grows by the distance the fastest receiver can have
+ * covered, so a moving receiver is never missed.  For mobility models
+ * that change speed without firing CourseChange, SpeedBound must be set
+ * to a speed no receiver ever exceeds.
+ *
+ * With a deterministic loss model that only decreases with distance,
+ * GetRange gives the distance beyond which the received power is
+ * certainly below a threshold.  Use the PHY's RxSensitivity (WifiPhy
+ * ignores weaker signals entirely, even as interference) rather than
+ * the higher CCA energy-detection threshold:
+ *
+ * \code
+ *   Ptr<GridSpectrumChannel> channel = CreateObject<GridSpectrumChannel> ();
+ *   channel->AddPropagationLossModel (loss);
+ *   channel->SetMaxRange (GridSpectrumChannel::GetRange (loss, 16.0206 + 2, -101));
+ *   spectrumPhy.SetChannel (channel);
+ * \endcode
+ *
+ * A MaxRange of 0 disables the culling.
+ */
+class GridSpectrumChannel : public SpectrumChannel
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::GridSpectrumChannel")
+      .SetParent<SpectrumChannel> ()
+      .SetGroupName ("Spectrum")
+      .AddConstructor<GridSpectrumChannel> ()
+      .AddAttribute ("MaxRange",
+                     "Receivers further than this from the sender (m) get nothing; 0 delivers to all",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&GridSpectrumChannel::m_maxRange),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("CellSize",
+                     "Side of a grid cell (m); 0 uses MaxRange",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&GridSpectrumChannel::m_cellSize),
+                     MakeDoubleChecker<double> (0))
+      .AddAttribute ("RebinInterval",
+                     "Time after which all receivers are binned again",
+                     TimeValue (Seconds (1)),
+                     MakeTimeAccessor (&GridSpectrumChannel::m_rebinInterval),
+                     MakeTimeChecker ())
+      .AddAttribute ("SpeedBound",
+                     "Speed (m/s) no receiver exceeds, for mobility models that fire no CourseChange",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&GridSpectrumChannel::m_speedBound),
+                     MakeDoubleChecker<double> (0))
+    ;
+    return tid;
+  }
+
+  GridSpectrumChannel ()
+    : m_maxRange (0),
+      m_cellSize (0),
+      m_binnedCellSize (0),
+      m_maxSpeed (0),
+      m_speedBound (0),
+      m_dirty (true),
+      m_transmissions (0),
+      m_deliveries (0)
+  {
+  }
+
+  void SetMaxRange (double maxRange) { m_maxRange = maxRange; m_dirty = true; }
+  double GetMaxRange (void) const { return m_maxRange; }
+  void SetSpeedBound (double speed) { m_speedBound = speed; }
+
+  /// Transmissions started and receive events scheduled so far
+  uint64_t GetNTransmissions (void) const { return m_transmissions; }
+  uint64_t GetNDeliveries (void) const { return m_deliveries; }
+
+  /**
+   * Smallest distance (to 1cm) at which \p loss brings \p txPowerDbm below
+   * \p thresholdDbm, found by bisection between two nodes at z = 0.  Only
+   * meaningful for deterministic models whose loss grows with distance.
+   */
+  static double
+  GetRange (Ptr<PropagationLossModel> loss, double txPowerDbm, double thresholdDbm)
+  {
+    Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+    Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+    a->SetPosition (Vector (0, 0, 0));
+    double low = 0;
+    double high = 1;
+    b->SetPosition (Vector (high, 0, 0));
+    while (loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+      {
+        low = high;
+        high *= 2;
+        NS_ABORT_MSG_IF (high > 1e8, "Loss model never drops below " << thresholdDbm << " dBm");
+        b->SetPosition (Vector (high, 0, 0));
+      }
+    while (high - low > 0.01)
+      {
+        double mid = (low + high) / 2;
+        b->SetPosition (Vector (mid, 0, 0));
+        if (loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+          {
+            low = mid;
+          }
+        else
+          {
+            high = mid;
+          }
+      }
+    return high;
+  }
+
+  virtual void
+  AddRx (Ptr<SpectrumPhy> phy)
+  {
+    m_phys.push_back (Receiver ());
+    m_phys.back ().phy = phy;
+    m_phys.back ().cell = 0;
+    m_phys.back ().placed = false;
+    m_dirty = true;
+  }
+
+  virtual void
+  RemoveRx (Ptr<SpectrumPhy> phy)
+  {
+    for (std::size_t i = 0; i < m_phys.size (); ++i)
+      {
+        if (m_phys[i].phy == phy)
+          {
+            m_phys.erase (m_phys.begin () + i);
+            m_dirty = true;
+            return;
+          }
+      }
+  }
+
+  virtual void
+  StartTx (Ptr<SpectrumSignalParameters> txParams)
+  {
+    NS_ASSERT (txParams->txPhy);
+    NS_ASSERT (txParams->psd);
+    Ptr<SpectrumSignalParameters> txParamsTrace = txParams->Copy ();
+    m_txSigsTrace (txParamsTrace);
+    ++m_transmissions;
+
+    Ptr<MobilityModel> senderMobility = txParams->txPhy->GetMobility ();
+    if (m_maxRange <= 0 || !senderMobility)
+      {
+        for (uint32_t i = 0; i < m_phys.size (); ++i)
+          {
+            Deliver (txParams, senderMobility, m_phys[i].phy);
+          }
+        return;
+      }
+
+    if (m_dirty || Simulator::Now () - m_lastRebin >= m_rebinInterval)
+      {
+        Rebin ();
+      }
+    Vector p = senderMobility->GetPosition ();
+    double radius = m_maxRange + m_maxSpeed * (Simulator::Now () - m_lastRebin).GetSeconds ();
+    int64_t x0 = CellIndex (p.x - radius);
+    int64_t x1 = CellIndex (p.x + radius);
+    int64_t y0 = CellIndex (p.y - radius);
+    int64_t y1 = CellIndex (p.y + radius);
+    m_candidates.assign (m_unplaced.begin (), m_unplaced.end ());
+    for (int64_t x = x0; x <= x1; ++x)
+      {
+        for (int64_t y = y0; y <= y1; ++y)
+          {
+            CellMap::const_iterator c = m_cells.find (CellKey (x, y));
+            if (c != m_cells.end () && !c->second.empty ())
+              {
+                // Cells are sorted, so merging keeps the receive events in
+                // the order of a channel without culling
+                std::size_t middle = m_candidates.size ();
+                m_candidates.insert (m_candidates.end (), c->second.begin (), c->second.end ());
+                std::inplace_merge (m_candidates.begin (), m_candidates.begin () + middle, m_candidates.end ());
+              }
+          }
+      }
+    double maxRange2 = m_maxRange * m_maxRange;
+    for (std::size_t i = 0; i < m_candidates.size (); ++i)
+      {
+        const Receiver &r = m_phys[m_candidates[i]];
+        if (r.placed)
+          {
+            Vector q = r.mobility->GetPosition ();
+            double dx = q.x - p.x;
+            double dy = q.y - p.y;
+            double dz = q.z - p.z;
+            if (dx * dx + dy * dy + dz * dz > maxRange2)
+              {
+                continue;
+              }
+          }
+        Deliver (txParams, senderMobility, r.phy);
+      }
+  }
+
+  virtual std::size_t
+  GetNDevices (void) const
+  {
+    return m_phys.size ();
+  }
+
+  virtual Ptr<NetDevice>
+  GetDevice (std::size_t i) const
+  {
+    return m_phys.at (i).phy->GetDevice ();
+  }
+
+protected:
+  virtual void
+  DoDispose (void)
+  {
+    m_phys.clear ();
+    m_cells.clear ();
+    m_index.clear ();
+    SpectrumChannel::DoDispose ();
+  }
+
+private:
+  struct Receiver
+  {
+    Ptr<SpectrumPhy>   phy;
+    Ptr<MobilityModel> mobility;
+    int64_t            cell;
+    bool               placed;     //!< has a mobility model and is in m_cells
+  };
+
+  typedef std::unordered_map<int64_t, std::vector<uint32_t> > CellMap;
+
+  int64_t
+  CellIndex (double coordinate) const
+  {
+    return static_cast<int64_t> (std::floor (coordinate / m_binnedCellSize));
+  }
+
+  static int64_t
+  CellKey (int64_t x, int64_t y)
+  {
+    // Shifted unsigned: x is negative left of the origin
+    return static_cast<int64_t> ((static_cast<uint64_t> (x) << 32) ^ (static_cast<uint64_t> (y) & 0xffffffff));
+  }
+
+  int64_t
+  CellOf (const Vector &p) const
+  {
+    return CellKey (CellIndex (p.x), CellIndex (p.y));
+  }
+
+  void
+  Rebin (void)
+  {
+    m_binnedCellSize = m_cellSize > 0 ? m_cellSize : m_maxRange;
+    for (CellMap::iterator c = m_cells.begin (); c != m_cells.end (); ++c)
+      {
+        c->second.clear ();
+      }
+    m_unplaced.clear ();
+    m_index.clear ();
+    m_maxSpeed = m_speedBound;
+    for (uint32_t i = 0; i < m_phys.size (); ++i)
+      {
+        Receiver &r = m_phys[i];
+        m_index[PeekPointer (r.phy)] = i;
+        if (!r.mobility)
+          {
+            // Devices are usually attached before mobility is installed
+            r.mobility = r.phy->GetMobility ();
+            if (r.mobility)
+              {
+                r.mobility->TraceConnectWithoutContext ("CourseChange",
+                    MakeBoundCallback (&GridSpectrumChannel::CourseChanged, this, r.phy));
+              }
+          }
+        if (!r.mobility)
+          {
+            r.placed = false;
+            m_unplaced.push_back (i);
+            continue;
+          }
+        r.placed = true;
+        r.cell = CellOf (r.mobility->GetPosition ());
+        m_cells[r.cell].push_back (i);
+        Vector v = r.mobility->GetVelocity ();
+        m_maxSpeed = std::max (m_maxSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+      }
+    for (CellMap::iterator c = m_cells.begin (); c != m_cells.end (); ++c)
+      {
+        std::sort (c->second.begin (), c->second.end ());
+      }
+    m_lastRebin = Simulator::Now ();
+    m_dirty = false;
+  }
+
+  // Move a receiver to its new cell right away, so teleports and speed
+  // changes are covered without waiting for the next rebin.
+  static void
+  CourseChanged (GridSpectrumChannel *channel, Ptr<SpectrumPhy> phy, Ptr<const MobilityModel> mobility)
+  {
+    // A removed receiver makes the channel dirty until the next rebin
+    if (channel->m_dirty)
+      {
+        return;
+      }
+    std::unordered_map<SpectrumPhy *, uint32_t>::const_iterator found = channel->m_index.find (PeekPointer (phy));
+    if (found == channel->m_index.end () || !channel->m_phys[found->second].placed)
+      {
+        return;
+      }
+    uint32_t i = found->second;
+    Receiver &r = channel->m_phys[i];
+    Vector v = mobility->GetVelocity ();
+    channel->m_maxSpeed = std::max (channel->m_maxSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+    int64_t cell = channel->CellOf (mobility->GetPosition ());
+    if (cell != r.cell)
+      {
+        std::vector<uint32_t> &from = channel->m_cells[r.cell];
+        from.erase (std::lower_bound (from.begin (), from.end (), i));
+        std::vector<uint32_t> &to = channel->m_cells[cell];
+        to.insert (std::lower_bound (to.begin (), to.end (), i), i);
+        r.cell = cell;
+      }
+  }
+
+  // As SingleModelSpectrumChannel::StartTx does for each receiver
+  void
+  Deliver (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> senderMobility, Ptr<SpectrumPhy> rxPhy)
+  {
+    if (rxPhy == txParams->txPhy)
+      {
+        return;
+      }
+    Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+    Time delay = MicroSeconds (0);
+    Ptr<MobilityModel> receiverMobility = rxPhy->GetMobility ();
+    if (senderMobility && receiverMobility)
+      {
+        double pathLossDb = 0;
+        if (rxParams->txAntenna != 0)
+          {
+            Angles txAngles (receiverMobility->GetPosition (), senderMobility->GetPosition ());
+            pathLossDb -= rxParams->txAntenna->GetGainDb (txAngles);
+          }
+        Ptr<AntennaModel> rxAntenna = rxPhy->GetRxAntenna ();
+        if (rxAntenna != 0)
+          {
+            Angles rxAngles (senderMobility->GetPosition (), receiverMobility->GetPosition ());
+            pathLossDb -= rxAntenna->GetGainDb (rxAngles);
+          }
+        if (m_propagationLoss)
+          {
+            pathLossDb -= m_propagationLoss->CalcRxPower (0, senderMobility, receiverMobility);
+          }
+        m_pathLossTrace (txParams->txPhy, rxPhy, pathLossDb);
+        if (pathLossDb > m_maxLossDb)
+          {
+            return;
+          }
+        *(rxParams->psd) *= std::pow (10.0, -pathLossDb / 10.0);
+        if (m_spectrumPropagationLoss)
+          {
+            rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, senderMobility,
+                                                                                   receiverMobility);
+          }
+        if (m_propagationDelay)
+          {
+            delay = m_propagationDelay->GetDelay (senderMobility, receiverMobility);
+          }
+      }
+    Ptr<NetDevice> netDev = rxPhy->GetDevice ();
+    uint32_t dstNode = netDev ? netDev->GetNode ()->GetId () : 0xffffffff;
+    ++m_deliveries;
+    Simulator::ScheduleWithContext (dstNode, delay, &GridSpectrumChannel::StartRx, rxParams, rxPhy);
+  }
+
+  static void
+  StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver)
+  {
+    receiver->StartRx (params);
+  }
+
+  double                 m_maxRange;
+  double                 m_cellSize;
+  double                 m_binnedCellSize;
+  Time                   m_rebinInterval;
+  Time                   m_lastRebin;
+  double                 m_maxSpeed;        //!< fastest receiver since the last rebin, m/s
+  double                 m_speedBound;
+  bool                   m_dirty;
+  std::vector<Receiver>  m_phys;
+  std::unordered_map<SpectrumPhy *, uint32_t> m_index;   //!< position of each phy in m_phys
+  CellMap                m_cells;
+  std::vector<uint32_t>  m_unplaced;
+  std::vector<uint32_t>  m_candidates;
+  uint64_t               m_transmissions;
+  uint64_t               m_deliveries;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (GridSpectrumChannel);
+
+} // namespace ns3
+
+#endif /* GRID_SPECTRUM_CHANNEL_H */
@@ -0,0 +1,543 @@
+#ifndef INCREMENTAL_ROUTING_H
+#define INCREMENTAL_ROUTING_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+class IncrementalRouting;
+
+/**
+ * Per-node routing protocol that answers lookups from the shortest-path
+ * tables kept by IncrementalRouting.  It is added to each node's
+ * Ipv4ListRouting below static routing, so directly connected subnets are
+ * still routed by Ipv4StaticRouting.
+ */
+class IncrementalRoutingProtocol : public Ipv4RoutingProtocol
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::IncrementalRoutingProtocol")
+      .SetParent<Ipv4RoutingProtocol> ()
+      .SetGroupName ("Internet")
+      .AddConstructor<IncrementalRoutingProtocol> ()
+    ;
+    return tid;
+  }
+
+  IncrementalRoutingProtocol ()
+    : m_routing (0),
+      m_index (0)
+  {
+  }
+
+  void
+  SetTable (const IncrementalRouting *routing, uint32_t index)
+  {
+    m_routing = routing;
+    m_index = index;
+  }
+
+  virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                                      Socket::SocketErrno &sockerr);
+  virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                           UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                           LocalDeliverCallback lcb, ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface) {}
+  virtual void NotifyInterfaceDown (uint32_t interface) {}
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address) {}
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address) {}
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4) { m_ipv4 = ipv4; }
+  virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
+
+protected:
+  virtual void
+  DoDispose (void)
+  {
+    m_ipv4 = 0;
+    m_routing = 0;
+    Ipv4RoutingProtocol::DoDispose ();
+  }
+
+private:
+  Ptr<Ipv4Route> Lookup (Ipv4Address dest) const;
+
+  Ptr<Ipv4>                 m_ipv4;
+  const IncrementalRouting *m_routing;
+  uint32_t                  m_index;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (IncrementalRoutingProtocol);
+
+/**
+ * Shortest-path routing for point-to-point topologies with link up/down
+ * fault injection.
+ *
+ * Like Ipv4GlobalRoutingHelper it computes one shortest-path tree per
+ * node, using the interface metrics as link weights.  Unlike
+ * RecomputeRoutingTables, a link change only reruns Dijkstra for the
+ * sources whose tree is affected:
+ *
+ * - link down: sources whose tree uses the link;
+ * - link up: sources for which the link gives a strictly shorter path
+ *   to one of its ends.
+ *
+ * Every other tree is unchanged by construction.  Use it instead of
+ * PopulateRoutingTables:
+ *
+ * \code
+ *   IncrementalRouting routing;
+ *   routing.Install (nodes);
+ *   Simulator::Schedule (Seconds (10), &IncrementalRouting::SetLinkDown, &routing,
+ *                        topo.GetCoreDevices (0));
+ * \endcode
+ *
+ * The object must outlive Simulator::Destroy, since the per-node
+ * protocols read its tables directly.
+ */
+class IncrementalRouting
+{
+public:
+  /// Next hop from a source towards one destination node
+  struct Hop
+  {
+    uint32_t    interface;     //!< output interface, NO_ROUTE if unreachable
+    Ipv4Address gateway;
+  };
+
+  static const uint32_t NO_ROUTE = 0xffffffff;
+
+  IncrementalRouting ()
+    : m_lastAffected (0),
+      m_lastSeconds (0)
+  {
+  }
+
+  /**
+   * Add an IncrementalRoutingProtocol to every node (which must use
+   * Ipv4ListRouting, the InternetStackHelper default), discover the links
+   * between them and compute all tables.  Call after addresses are
+   * assigned.
+   */
+  void
+  Install (NodeContainer nodes, int16_t priority = -5)
+  {
+    NS_ABORT_MSG_IF (!m_nodes.empty (), "IncrementalRouting can only be installed once");
+    m_index.assign (NodeList::GetNNodes (), uint32_t (NO_ROUTE));
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        m_index[(*i)->GetId ()] = m_nodes.size ();
+        m_nodes.push_back ((*i)->GetObject<Ipv4> ());
+        NS_ABORT_MSG_UNLESS (m_nodes.back (), "Node " << (*i)->GetId () << " has no Ipv4");
+      }
+    DiscoverLinks ();
+
+    for (uint32_t n = 0; n < m_nodes.size (); ++n)
+      {
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (m_nodes[n]->GetRoutingProtocol ());
+        NS_ABORT_MSG_UNLESS (list, "IncrementalRouting needs Ipv4ListRouting on node "
+                             << m_nodes[n]->GetObject<Node> ()->GetId ());
+        Ptr<IncrementalRoutingProtocol> proto = CreateObject<IncrementalRoutingProtocol> ();
+        proto->SetTable (this, n);
+        list->AddRoutingProtocol (proto, priority);
+      }
+
+    m_hops.resize (m_nodes.size ());
+    m_dist.resize (m_nodes.size ());
+    m_parent.resize (m_nodes.size ());
+    RecomputeAll ();
+  }
+
+  /// Take down the link a device is attached to, on all of its interfaces.
+  void
+  SetLinkDown (Ptr<NetDevice> device)
+  {
+    SetLinkState (device, false);
+  }
+
+  void
+  SetLinkUp (Ptr<NetDevice> device)
+  {
+    SetLinkState (device, true);
+  }
+
+  /// Convenience for TopologyBuilder::GetCoreDevices and friends.
+  void
+  SetLinkDown (NetDeviceContainer devices)
+  {
+    SetLinkDown (devices.Get (0));
+  }
+
+  void
+  SetLinkUp (NetDeviceContainer devices)
+  {
+    SetLinkUp (devices.Get (0));
+  }
+
+  /// Rerun Dijkstra from every node, like RecomputeRoutingTables.
+  void
+  RecomputeAll (void)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    for (uint32_t s = 0; s < m_nodes.size (); ++s)
+      {
+        Dijkstra (s);
+      }
+    m_lastAffected = m_nodes.size ();
+    m_lastSeconds = Elapsed (start);
+  }
+
+  /// Trees recomputed by the last change
+  uint32_t GetLastAffected (void) const { return m_lastAffected; }
+  /// Wall-clock time of the last change, in seconds
+  double GetLastSeconds (void) const { return m_lastSeconds; }
+  uint32_t GetNNodes (void) const { return m_nodes.size (); }
+
+  const Hop *
+  FindHop (uint32_t source, Ipv4Address dest) const
+  {
+    std::map<uint32_t, uint32_t>::const_iterator i = m_addressOwner.find (dest.Get ());
+    if (i == m_addressOwner.end ())
+      {
+        return 0;
+      }
+    const Hop &hop = m_hops[source][i->second];
+    return hop.interface == NO_ROUTE ? 0 : &hop;
+  }
+
+  /// Path metric from a source to the node owning dest, NO_ROUTE if unreachable
+  uint32_t
+  GetDistance (uint32_t source, Ipv4Address dest) const
+  {
+    std::map<uint32_t, uint32_t>::const_iterator i = m_addressOwner.find (dest.Get ());
+    return i == m_addressOwner.end () ? uint32_t (NO_ROUTE) : m_dist[source][i->second];
+  }
+
+  void
+  Print (std::ostream &os, uint32_t source) const
+  {
+    os << "Destination\tGateway\tInterface\tDistance\n";
+    for (std::map<uint32_t, uint32_t>::const_iterator i = m_addressOwner.begin (); i != m_addressOwner.end (); ++i)
+      {
+        const Hop &hop = m_hops[source][i->second];
+        if (i->second == source || hop.interface == NO_ROUTE)
+          {
+            continue;
+          }
+        os << Ipv4Address (i->first) << "\t" << hop.gateway << "\t" << hop.interface
+           << "\t" << m_dist[source][i->second] << "\n";
+      }
+  }
+
+private:
+  struct Edge
+  {
+    uint32_t from;
+    uint32_t to;
+    uint32_t metric;
+    uint32_t link;
+    Hop      hop;              //!< first hop from \c from over this edge
+  };
+
+  struct Link
+  {
+    bool                                       up;
+    std::vector<uint32_t>                      edges;
+    std::vector<std::pair<Ptr<Ipv4>, uint32_t> > interfaces;
+  };
+
+  static const uint32_t INFINITE = std::numeric_limits<uint32_t>::max ();
+  static const int32_t  NO_EDGE = -1;
+
+  void
+  DiscoverLinks (void)
+  {
+    std::map<Ptr<Channel>, uint32_t> linkOf;
+    for (uint32_t u = 0; u < m_nodes.size (); ++u)
+      {
+        Ptr<Ipv4> ipv4 = m_nodes[u];
+        for (uint32_t i = 0; i < ipv4->GetNInterfaces (); ++i)
+          {
+            for (uint32_t a = 0; a < ipv4->GetNAddresses (i); ++a)
+              {
+                Ipv4Address local = ipv4->GetAddress (i, a).GetLocal ();
+                if (!local.IsLocalhost ())
+                  {
+                    m_addressOwner[local.Get ()] = u;
+                  }
+              }
+            Ptr<NetDevice> device = ipv4->GetNetDevice (i);
+            Ptr<Channel> channel = device->GetChannel ();
+            if (!channel || DynamicCast<LoopbackNetDevice> (device))
+              {
+                continue;
+              }
+            std::map<Ptr<Channel>, uint32_t>::iterator l = linkOf.find (channel);
+            if (l == linkOf.end ())
+              {
+                l = linkOf.insert (std::make_pair (channel, m_links.size ())).first;
+                m_links.push_back (Link ());
+                m_links.back ().up = ipv4->IsUp (i);
+              }
+            m_links[l->second].interfaces.push_back (std::make_pair (ipv4, i));
+            m_deviceLink[device] = l->second;
+            AddEdges (u, i, channel, l->second);
+          }
+      }
+    m_adjacency.assign (m_nodes.size (), std::vector<uint32_t> ());
+    for (uint32_t e = 0; e < m_edges.size (); ++e)
+      {
+        m_adjacency[m_edges[e].from].push_back (e);
+      }
+  }
+
+  void
+  AddEdges (uint32_t u, uint32_t interface, Ptr<Channel> channel, uint32_t link)
+  {
+    Ptr<NetDevice> self = m_nodes[u]->GetNetDevice (interface);
+    for (std::size_t d = 0; d < channel->GetNDevices (); ++d)
+      {
+        Ptr<NetDevice> peer = channel->GetDevice (d);
+        if (peer == self)
+          {
+            continue;
+          }
+        uint32_t id = peer->GetNode ()->GetId ();
+        if (id >= m_index.size () || m_index[id] == NO_ROUTE)
+          {
+            continue;
+          }
+        uint32_t v = m_index[id];
+        int32_t peerInterface = m_nodes[v]->GetInterfaceForDevice (peer);
+        if (peerInterface < 0 || m_nodes[v]->GetNAddresses (peerInterface) == 0)
+          {
+            continue;
+          }
+        Edge e;
+        e.from = u;
+        e.to = v;
+        e.metric = m_nodes[u]->GetMetric (interface);
+        e.link = link;
+        e.hop.interface = interface;
+        e.hop.gateway = m_nodes[v]->GetAddress (peerInterface, 0).GetLocal ();
+        m_links[link].edges.push_back (m_edges.size ());
+        m_edges.push_back (e);
+      }
+  }
+
+  void
+  SetLinkState (Ptr<NetDevice> device, bool up)
+  {
+    uint32_t link = FindLink (device);
+    Link &l = m_links[link];
+    if (l.up == up)
+      {
+        return;
+      }
+    l.up = up;
+    for (std::size_t i = 0; i < l.interfaces.size (); ++i)
+      {
+        if (up)
+          {
+            l.interfaces[i].first->SetUp (l.interfaces[i].second);
+          }
+        else
+          {
+            l.interfaces[i].first->SetDown (l.interfaces[i].second);
+          }
+      }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    m_lastAffected = 0;
+    for (uint32_t s = 0; s < m_nodes.size (); ++s)
+      {
+        if (up ? ImprovedBy (s, l) : Uses (s, l))
+          {
+            Dijkstra (s);
+            ++m_lastAffected;
+          }
+      }
+    m_lastSeconds = Elapsed (start);
+  }
+
+  uint32_t
+  FindLink (Ptr<NetDevice> device) const
+  {
+    std::map<Ptr<NetDevice>, uint32_t>::const_iterator i = m_deviceLink.find (device);
+    NS_ABORT_MSG_IF (i == m_deviceLink.end (), "Device is not on a link known to IncrementalRouting");
+    return i->second;
+  }
+
+  /// Does the shortest-path tree of \p s use any edge of \p l?
+  bool
+  Uses (uint32_t s, const Link &l) const
+  {
+    for (std::size_t i = 0; i < l.edges.size (); ++i)
+      {
+        const Edge &e = m_edges[l.edges[i]];
+        if (m_parent[s][e.to] == static_cast<int32_t> (l.edges[i]))
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /// Would any edge of \p l shorten a path in the tree of \p s?
+  bool
+  ImprovedBy (uint32_t s, const Link &l) const
+  {
+    for (std::size_t i = 0; i < l.edges.size (); ++i)
+      {
+        const Edge &e = m_edges[l.edges[i]];
+        uint32_t du = m_dist[s][e.from];
+        if (du != INFINITE && static_cast<uint64_t> (du) + e.metric < m_dist[s][e.to])
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  void
+  Dijkstra (uint32_t s)
+  {
+    typedef std::pair<uint32_t, uint32_t> Entry; // distance, node
+    std::vector<uint32_t> &dist = m_dist[s];
+    std::vector<int32_t> &parent = m_parent[s];
+    std::vector<Hop> &hops = m_hops[s];
+    dist.assign (m_nodes.size (), uint32_t (INFINITE));
+    parent.assign (m_nodes.size (), int32_t (NO_EDGE));
+    Hop none;
+    none.interface = NO_ROUTE;
+    hops.assign (m_nodes.size (), none);
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+    dist[s] = 0;
+    queue.push (Entry (0, s));
+    while (!queue.empty ())
+      {
+        Entry top = queue.top ();
+        queue.pop ();
+        uint32_t u = top.second;
+        if (top.first != dist[u])
+          {
+            continue;
+          }
+        const std::vector<uint32_t> &out = m_adjacency[u];
+        for (std::size_t i = 0; i < out.size (); ++i)
+          {
+            const Edge &e = m_edges[out[i]];
+            if (!m_links[e.link].up)
+              {
+                continue;
+              }
+            uint64_t d = static_cast<uint64_t> (dist[u]) + e.metric;
+            if (d < dist[e.to])
+              {
+                dist[e.to] = d;
+                parent[e.to] = out[i];
+                hops[e.to] = (u == s) ? e.hop : hops[u];
+                queue.push (Entry (d, e.to));
+              }
+          }
+      }
+  }
+
+  static double
+  Elapsed (std::chrono::steady_clock::time_point start)
+  {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+    return d.count ();
+  }
+
+  std::vector<Ptr<Ipv4> >                m_nodes;
+  std::vector<uint32_t>                  m_index;        //!< node id to table index
+  std::map<uint32_t, uint32_t>           m_addressOwner; //!< address to table index
+  std::vector<Edge>                      m_edges;
+  std::vector<Link>                      m_links;
+  std::map<Ptr<NetDevice>, uint32_t>     m_deviceLink;
+  std::vector<std::vector<uint32_t> >    m_adjacency;    //!< outgoing edges per node
+  std::vector<std::vector<Hop> >         m_hops;         //!< [source][destination]
+  std::vector<std::vector<uint32_t> >    m_dist;
+  std::vector<std::vector<int32_t> >     m_parent;       //!< edge into each node
+  uint32_t                               m_lastAffected;
+  double                                 m_lastSeconds;
+};
+
+inline Ptr<Ipv4Route>
+IncrementalRoutingProtocol::Lookup (Ipv4Address dest) const
+{
+  if (m_routing == 0)
+    {
+      return 0;
+    }
+  const IncrementalRouting::Hop *hop = m_routing->FindHop (m_index, dest);
+  if (hop == 0 || !m_ipv4->IsUp (hop->interface))
+    {
+      return 0;
+    }
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (dest);
+  route->SetGateway (hop->gateway);
+  route->SetOutputDevice (m_ipv4->GetNetDevice (hop->interface));
+  route->SetSource (m_ipv4->GetAddress (hop->interface, 0).GetLocal ());
+  return route;
+}
+
+inline Ptr<Ipv4Route>
+IncrementalRoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                                         Socket::SocketErrno &sockerr)
+{
+  Ptr<Ipv4Route> route = Lookup (header.GetDestination ());
+  if (!route || (oif && route->GetOutputDevice () != oif))
+    {
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
+    }
+  sockerr = Socket::ERROR_NOTERROR;
+  return route;
+}
+
+inline bool
+IncrementalRoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                                        UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                                        LocalDeliverCallback lcb, ErrorCallback ecb)
+{
+  // Local delivery and the forwarding check are done by Ipv4ListRouting
+  Ptr<Ipv4Route> route = Lookup (header.GetDestination ());
+  if (!route)
+    {
+      return false;
+    }
+  ucb (route, p, header);
+  return true;
+}
+
+inline void
+IncrementalRoutingProtocol::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+  *stream->GetStream () << "Node: " << m_ipv4->GetObject<Node> ()->GetId ()
+                        << ", Time: " << Now ().As (unit)
+                        << ", IncrementalRouting table\n";
+  if (m_routing)
+    {
+      m_routing->Print (*stream->GetStream (), m_index);
+    }
+}
+
+} // namespace ns3
+
+#endif /* INCREMENTAL_ROUTING_H */
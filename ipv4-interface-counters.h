@@ -0,0 +1,191 @@
+#ifndef IPV4_INTERFACE_COUNTERS_H
+#define IPV4_INTERFACE_COUNTERS_H
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/**
+ * Per-interface, per-interval IP packet and byte counters.
+ *
+ * Consumes the Ipv4L3Protocol Tx, Rx and Drop traces of the installed
+ * nodes and adds each packet to six counters (tx, rx and drop packets
+ * and bytes) of its interface in one flat array.  One periodic event
+ * writes the whole array as one row and clears it:
+ *
+ *   time  n0/if1:txPkts n0/if1:txBytes n0/if1:rxPkts ... n5/if3:dropBytes
+ *
+ * so the output grows with the simulated time instead of the number of
+ * packets.  Stop writes a last row for the partial interval since the
+ * previous one.  For drill-down, SetSampling also logs every Nth packet seen
+ * (counted over all installed interfaces) as
+ *
+ *   time  node  interface  tx|rx|drop  size
+ *
+ * Interfaces added to a node after Install are not counted.
+ */
+class Ipv4InterfaceCounters
+{
+public:
+  Ipv4InterfaceCounters ()
+    : m_sampleEvery (0),
+      m_seen (0)
+  {
+  }
+
+  /// Count the interfaces \p nodes have now
+  void
+  Install (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        NS_ABORT_MSG_UNLESS (ipv4, "Node " << (*n)->GetId () << " has no IPv4 stack");
+        uint32_t slot = m_nodes.size ();
+        m_nodes.push_back ((*n)->GetId ());
+        m_first.push_back (m_counters.size ());
+        m_nInterfaces.push_back (ipv4->GetNInterfaces ());
+        m_counters.resize (m_counters.size () + ipv4->GetNInterfaces () * N_COUNTERS, 0);
+        ipv4->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&Ipv4InterfaceCounters::Tx, this, slot));
+        ipv4->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&Ipv4InterfaceCounters::Rx, this, slot));
+        ipv4->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&Ipv4InterfaceCounters::Drop, this, slot));
+      }
+  }
+
+  /// Also log one packet in \p every to \p fileName (0 to disable)
+  void
+  SetSampling (uint32_t every, std::string fileName)
+  {
+    m_sampleEvery = every;
+    if (every > 0)
+      {
+        m_sampleOut.open (fileName.c_str (), std::ios::out);
+        m_sampleOut << "#Time(s)\tnode\tinterface\tevent\tsize (B)\n" << std::fixed << std::setprecision (6);
+      }
+  }
+
+  void
+  Start (Time start, Time interval, std::string fileName)
+  {
+    static const char *names[N_COUNTERS] = { "txPkts", "txBytes", "rxPkts", "rxBytes", "dropPkts", "dropBytes" };
+    m_interval = interval;
+    m_out.open (fileName.c_str (), std::ios::out);
+    m_out << "#Time(s)";
+    for (std::size_t s = 0; s < m_nodes.size (); ++s)
+      {
+        for (uint32_t i = 0; i < m_nInterfaces[s]; ++i)
+          {
+            for (uint32_t c = 0; c < N_COUNTERS; ++c)
+              {
+                m_out << "\tn" << m_nodes[s] << "/if" << i << ":" << names[c];
+              }
+          }
+      }
+    m_out << "\n" << std::fixed << std::setprecision (6);
+    m_lastRow = Simulator::Now () + start;
+    m_event = Simulator::Schedule (start, &Ipv4InterfaceCounters::Sample, this);
+  }
+
+  void
+  Stop (void)
+  {
+    m_event.Cancel ();
+    if (m_out.is_open () && Simulator::Now () > m_lastRow)
+      {
+        WriteRow ();
+      }
+    m_out.close ();
+    m_sampleOut.close ();
+  }
+
+private:
+  enum Counter
+  {
+    TX_PACKETS,
+    TX_BYTES,
+    RX_PACKETS,
+    RX_BYTES,
+    DROP_PACKETS,
+    DROP_BYTES,
+    N_COUNTERS
+  };
+
+  void
+  Count (uint32_t slot, uint32_t interface, Counter packets, uint32_t size, const char *event)
+  {
+    if (interface < m_nInterfaces[slot])
+      {
+        uint64_t *c = &m_counters[m_first[slot] + interface * N_COUNTERS];
+        ++c[packets];
+        c[packets + 1] += size;
+      }
+    if (m_sampleEvery > 0 && ++m_seen % m_sampleEvery == 0)
+      {
+        m_sampleOut << Simulator::Now ().GetSeconds () << "\t" << m_nodes[slot] << "\t" << interface
+                    << "\t" << event << "\t" << size << "\n";
+      }
+  }
+
+  static void
+  Tx (Ipv4InterfaceCounters *self, uint32_t slot, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    self->Count (slot, interface, TX_PACKETS, p->GetSize (), "tx");
+  }
+
+  static void
+  Rx (Ipv4InterfaceCounters *self, uint32_t slot, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    self->Count (slot, interface, RX_PACKETS, p->GetSize (), "rx");
+  }
+
+  static void
+  Drop (Ipv4InterfaceCounters *self, uint32_t slot, const Ipv4Header &header, Ptr<const Packet> p,
+        Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    self->Count (slot, interface, DROP_PACKETS, p->GetSize (), "drop");
+  }
+
+  void
+  Sample (void)
+  {
+    WriteRow ();
+    m_event = Simulator::Schedule (m_interval, &Ipv4InterfaceCounters::Sample, this);
+  }
+
+  void
+  WriteRow (void)
+  {
+    m_out << Simulator::Now ().GetSeconds ();
+    for (std::size_t i = 0; i < m_counters.size (); ++i)
+      {
+        m_out << "\t" << m_counters[i];
+      }
+    m_out << "\n";
+    std::fill (m_counters.begin (), m_counters.end (), 0);
+    m_lastRow = Simulator::Now ();
+  }
+
+  std::vector<uint32_t> m_nodes;        //!< node id of each installed node
+  std::vector<uint32_t> m_first;        //!< its first counter
+  std::vector<uint32_t> m_nInterfaces;
+  std::vector<uint64_t> m_counters;     //!< N_COUNTERS per interface, nodes in install order
+  uint32_t              m_sampleEvery;
+  uint64_t              m_seen;
+  Time                  m_interval;
+  Time                  m_lastRow;      //!< time of the last row written
+  EventId               m_event;
+  std::ofstream         m_out;
+  std::ofstream         m_sampleOut;
+};
+
+} // namespace ns3
+
+#endif /* IPV4_INTERFACE_COUNTERS_H */
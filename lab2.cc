@@ -11,6 +11,7 @@
 // - UDP flow from n1 to n3
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -20,119 +21,17 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 
+#include "my-app.h"
+#include "flow-stats-export.h"
+#include "topology-builder.h"
+#include "memory-accounting.h"
+#include "simulation-checkpoint.h"
+#include "steady-state-detector.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Lab2");
 
-class MyApp : public Application
-{
-public:
-
-  MyApp ();
-  virtual ~MyApp();
-
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-  void ChangeRate(DataRate newrate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-};
-
-MyApp::MyApp ()
-  : m_socket (0),
-    m_peer (),
-    m_packetSize (0),
-    m_nPackets (0),
-    m_dataRate (0),
-    m_sendEvent (),
-    m_running (false),
-    m_packetsSent (0)
-{
-}
-
-MyApp::~MyApp()
-{
-  m_socket = 0;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void
-MyApp::StartApplication (void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  m_socket->Bind ();
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
-
-void
-MyApp::StopApplication (void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
-    {
-      Simulator::Cancel (m_sendEvent);
-    }
-
-  if (m_socket)
-    {
-      m_socket->Close ();
-    }
-}
-
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
-
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
-}
-
-void
-MyApp::ScheduleTx (void)
-{
-  if (m_running)
-    {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
-    }
-}
-
-void
-MyApp::ChangeRate(DataRate newrate)
-{
-   m_dataRate = newrate;
-   return;
-}
-
 static void
 CwndChange (uint32_t oldCwnd, uint32_t newCwnd)
 {
@@ -152,62 +51,47 @@ int main (int argc, char *argv[])
   std::string lat = "2ms";
   std::string rate = "500kb/s"; // P2P link
   bool enableFlowMonitor = false;
+  uint32_t burst = 1;
+  std::string flowmonFormat = "bin";
+  double memoryInterval = 0;
+  std::string branchRates = "";
+  uint32_t branchParallel = 1;
+  double steadyState = 0;
 
 
   CommandLine cmd;
   cmd.AddValue ("latency", "P2P link Latency in miliseconds", lat);
   cmd.AddValue ("rate", "P2P data rate in bps", rate);
   cmd.AddValue ("EnableMonitor", "Enable Flow Monitor", enableFlowMonitor);
+  cmd.AddValue ("burst", "Packets sent per MyApp send event", burst);
+  cmd.AddValue ("flowmonFormat", "Flow monitor output format: bin, csv or xml", flowmonFormat);
+  cmd.AddValue ("memoryInterval", "Memory accounting sample interval in seconds (0 = off)", memoryInterval);
+  cmd.AddValue ("branchRates", "Comma-separated UDP rates for 30 s; each one is a branch of a single warm-up", branchRates);
+  cmd.AddValue ("branchParallel", "Branches run at the same time with --branchRates", branchParallel);
+  cmd.AddValue ("steadyState", "Stop once both goodputs are known to this relative precision (0 to run 100 s)", steadyState);
 
   cmd.Parse (argc, argv);
+  // The branches would all append to the one memory trace opened before the checkpoint
+  NS_ABORT_MSG_IF (memoryInterval > 0 && !branchRates.empty (), "--memoryInterval cannot be used with --branchRates");
 
 //
-// Explicitly create the nodes required by the topology (shown above).
+// Build the dumbbell shown above: n0, n1 on the left, n2, n3 on the right,
+// routers n4 and n5.  Every link uses the same rate and latency.
 //
-  NS_LOG_INFO ("Create nodes.");
-  NodeContainer c; // ALL Nodes
-  c.Create(6);
-
-  NodeContainer n0n4 = NodeContainer (c.Get (0), c.Get (4));
-  NodeContainer n1n4 = NodeContainer (c.Get (1), c.Get (4));
-  NodeContainer n2n5 = NodeContainer (c.Get (2), c.Get (5));
-  NodeContainer n3n5 = NodeContainer (c.Get (3), c.Get (5));
-  NodeContainer n4n5 = NodeContainer (c.Get (4), c.Get (5));
-
-//
-// Install Internet Stack
-//
-  InternetStackHelper internet;
-  internet.Install (c);
-
-  // We create the channels first without any IP addressing information
-  NS_LOG_INFO ("Create channels.");
+  NS_LOG_INFO ("Create topology.");
   PointToPointHelper p2p;
   p2p.SetDeviceAttribute ("DataRate", StringValue (rate));
   p2p.SetChannelAttribute ("Delay", StringValue (lat));
-  NetDeviceContainer d0d4 = p2p.Install (n0n4);
-  NetDeviceContainer d1d4 = p2p.Install (n1n4);
-  NetDeviceContainer d4d5 = p2p.Install (n4n5);
-  NetDeviceContainer d2d5 = p2p.Install (n2n5);
-  NetDeviceContainer d3d5 = p2p.Install (n3n5);
-
-    // Later, we add IP addresses.
-  NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer i0i4 = ipv4.Assign (d0d4);
 
-  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer i1i4 = ipv4.Assign (d1d4);
+  TopologyBuilder topo;
+  topo.BuildDumbbell (2, 2, p2p, p2p, p2p);
+  NodeContainer c = topo.GetAll (); // ALL Nodes
 
-  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer i4i5 = ipv4.Assign (d4d5);
-
-  ipv4.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer i2i5 = ipv4.Assign (d2d5);
+  InternetStackHelper internet;
+  topo.InstallStack (internet);
 
-  ipv4.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer i3i5 = ipv4.Assign (d3d5);
+  NS_LOG_INFO ("Assign IP Addresses.");
+  topo.AssignIpv4Addresses (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"));
 
   NS_LOG_INFO ("Enable static global routing.");
   //
@@ -221,7 +105,7 @@ int main (int argc, char *argv[])
   // TCP connfection from N0 to N2
 
   uint16_t sinkPort = 8080;
-  Address sinkAddress (InetSocketAddress (i2i5.GetAddress (0), sinkPort)); // interface of n2
+  Address sinkAddress (InetSocketAddress (topo.GetRightAddress (0), sinkPort)); // interface of n2
   PacketSinkHelper packetSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
   ApplicationContainer sinkApps = packetSinkHelper.Install (c.Get (2)); //n2 as sink
   sinkApps.Start (Seconds (0.));
@@ -235,6 +119,7 @@ int main (int argc, char *argv[])
   // Create TCP application at n0
   Ptr<MyApp> app = CreateObject<MyApp> ();
   app->Setup (ns3TcpSocket, sinkAddress, 1040, 100000, DataRate ("250Kbps"));
+  app->SetBurstSize (burst);
   c.Get (0)->AddApplication (app);
   app->SetStartTime (Seconds (1.));
   app->SetStopTime (Seconds (100.));
@@ -243,7 +128,7 @@ int main (int argc, char *argv[])
   // UDP connfection from N1 to N3
 
   uint16_t sinkPort2 = 6;
-  Address sinkAddress2 (InetSocketAddress (i3i5.GetAddress (0), sinkPort2)); // interface of n3
+  Address sinkAddress2 (InetSocketAddress (topo.GetRightAddress (1), sinkPort2)); // interface of n3
   PacketSinkHelper packetSinkHelper2 ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort2));
   ApplicationContainer sinkApps2 = packetSinkHelper2.Install (c.Get (3)); //n3 as sink
   sinkApps2.Start (Seconds (0.));
@@ -254,31 +139,87 @@ int main (int argc, char *argv[])
   // Create UDP application at n1
   Ptr<MyApp> app2 = CreateObject<MyApp> ();
   app2->Setup (ns3UdpSocket, sinkAddress2, 1040, 100000, DataRate ("250Kbps"));
+  app2->SetBurstSize (burst);
   c.Get (1)->AddApplication (app2);
   app2->SetStartTime (Seconds (20.));
   app2->SetStopTime (Seconds (100.));
 
-// Increase UDP Rate
-  Simulator::Schedule (Seconds(30.0), &IncRate, app2, DataRate("500kbps"));
+// Increase UDP Rate, or branch the simulation there with each of --branchRates
+  SimulationCheckpoint checkpoint;
+  if (branchRates.empty ())
+    {
+      Simulator::Schedule (Seconds(30.0), &IncRate, app2, DataRate("500kbps"));
+    }
+  else
+    {
+      std::istringstream rates (branchRates);
+      std::string r;
+      while (std::getline (rates, r, ','))
+        {
+          checkpoint.AddBranch (r, MakeBoundCallback (&IncRate, app2, DataRate (r)));
+        }
+      checkpoint.SetParallel (branchParallel);
+      if (branchParallel > 1)
+        {
+          checkpoint.SetOutputPrefix ("lab-2-");
+        }
+      checkpoint.Schedule (Seconds (30.0));
+    }
 
   // Flow Monitor
+  FlowMonitorHelper flowmonHelper;
   Ptr<FlowMonitor> flowmon;
   if (enableFlowMonitor)
     {
-      FlowMonitorHelper flowmonHelper;
       flowmon = flowmonHelper.InstallAll ();
     }
 
+  // Memory accounting: stdout carries the cwnd trace, so the report goes to stderr
+  MemoryAccounting memory;
+  if (memoryInterval > 0)
+    {
+      memory.Install (c);
+      memory.SetFlowMonitor (flowmon);
+      memory.Start (Seconds (0.), Seconds (memoryInterval), "lab-2");
+    }
+
+  // Early stop once both flows settle after the UDP rate change at 30 s
+  SteadyStateDetector detector;
+  if (steadyState > 0)
+    {
+      detector.AddSinkGoodput ("TCP n2", DynamicCast<PacketSink> (sinkApps.Get (0)));
+      detector.AddSinkGoodput ("UDP n3", DynamicCast<PacketSink> (sinkApps2.Get (0)));
+      detector.SetWarmup (Seconds (31.));
+      detector.SetRelativeWidth (steadyState);
+      detector.Start ();
+    }
+
 //
 // Now, do the actual simulation.
 //
   NS_LOG_INFO ("Run Simulation.");
   Simulator::Stop (Seconds(100.0));
+  SystemWallClockMs wallClock;
+  wallClock.Start ();
   Simulator::Run ();
+  int64_t wallMs = wallClock.End ();
+  std::string name = checkpoint.GetBranch ().empty () ? "lab-2" : "lab-2-" + checkpoint.GetBranch ();
+  std::cerr << "Burst size: " << burst << "\n";
+  std::cerr << "Events:     " << Simulator::GetEventCount () << "\n";
+  std::cerr << "Wall clock: " << wallMs << " ms\n";
+  if (steadyState > 0)
+    {
+      detector.Report (std::cerr);
+    }
+  if (memoryInterval > 0)
+    {
+      memory.Stop ();
+      memory.Report (std::cerr);
+    }
   if (enableFlowMonitor)
     {
 	  flowmon->CheckForLostPackets ();
-	  flowmon->SerializeToXmlFile("lab-2.flowmon", true, true);
+	  FlowStatsExporter::Write (flowmon, flowmonHelper.GetClassifier (), name, flowmonFormat);
     }
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
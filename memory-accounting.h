@@ -0,0 +1,351 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include "topology-builder.h"
+
+namespace ns3 {
+
+/**
+ * Live packets and bytes held by one node, by category.
+ */
+struct MemoryUsage
+{
+  MemoryUsage ()
+    : devicePackets (0), deviceBytes (0), queueDiscPackets (0), queueDiscBytes (0),
+      flowQueues (0), sockets (0), tcpTxBytes (0), tcpRxBytes (0),
+      inFlightPackets (0), inFlightBytes (0)
+  {
+  }
+
+  void
+  Add (const MemoryUsage &o)
+  {
+    devicePackets += o.devicePackets;
+    deviceBytes += o.deviceBytes;
+    queueDiscPackets += o.queueDiscPackets;
+    queueDiscBytes += o.queueDiscBytes;
+    flowQueues += o.flowQueues;
+    sockets += o.sockets;
+    tcpTxBytes += o.tcpTxBytes;
+    tcpRxBytes += o.tcpRxBytes;
+    inFlightPackets += o.inFlightPackets;
+    inFlightBytes += o.inFlightBytes;
+  }
+
+  uint64_t devicePackets;       //!< point-to-point device queues (DropTailQueue)
+  uint64_t deviceBytes;
+  uint64_t queueDiscPackets;    //!< root queue discs, including FqCoDel flow queues
+  uint64_t queueDiscBytes;
+  uint64_t flowQueues;          //!< queue disc classes, one per FqCoDel flow queue
+  uint64_t sockets;             //!< TCP sockets
+  uint64_t tcpTxBytes;          //!< TCP send buffers
+  uint64_t tcpRxBytes;          //!< TCP receive buffers
+  uint64_t inFlightPackets;     //!< sent on a link by this node, not yet received
+  int64_t  inFlightBytes;
+};
+
+/**
+ * Periodic memory accounting for packets, queues and per-node stacks.
+ *
+ * Every interval one event reads the backlog of each node's
+ * point-to-point device queues and root queue discs, the number of
+ * FqCoDel flow queues, and the send and receive buffers of its TCP
+ * sockets.  Packets on the wire are counted from the devices' PhyTxBegin
+ * and PhyTxDrop and the peers' PhyRxEnd/PhyRxDrop traces and charged to
+ * the sender.
+ * The FlowMonitor's flow and histogram state is estimated from its
+ * flows, and the process RSS is read from /proc.
+ *
+ * Each sample is one line of \<prefix\>-memory.dat with the totals, and
+ * with per-node output one line per node of \<prefix\>-memory-nodes.dat:
+ *
+ *   time  devPkts devBytes qdiscPkts qdiscBytes flowQueues sockets tcpTx tcpRx flightPkts flightBytes [flowmon rss]
+ *
+ * Report prints the peak of every total, when it was reached, and the
+ * node with the largest peak.
+ */
+class MemoryAccounting
+{
+public:
+  MemoryAccounting ()
+    : m_perNode (true),
+      m_peakFlowMonitor (0),
+      m_peakRss (0)
+  {
+  }
+
+  /// Account for \p nodes; call after the devices and stacks are installed.
+  void
+  Install (NodeContainer nodes)
+  {
+    NS_ABORT_MSG_IF (!m_nodes.empty (), "MemoryAccounting can only be installed once");
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        m_nodes.push_back (*i);
+      }
+    m_usage.resize (m_nodes.size ());
+    m_nodePeak.resize (m_nodes.size (), 0);
+    for (uint32_t n = 0; n < m_nodes.size (); ++n)
+      {
+        for (uint32_t d = 0; d < m_nodes[n]->GetNDevices (); ++d)
+          {
+            Ptr<PointToPointNetDevice> dev = DynamicCast<PointToPointNetDevice> (m_nodes[n]->GetDevice (d));
+            if (!dev)
+              {
+                continue;
+              }
+            Ptr<Channel> channel = dev->GetChannel ();
+            Ptr<NetDevice> peer = channel->GetDevice (channel->GetDevice (0) == dev ? 1 : 0);
+            dev->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&MemoryAccounting::WireTx, &m_usage[n]));
+            dev->TraceConnectWithoutContext ("PhyTxDrop", MakeBoundCallback (&MemoryAccounting::WireRx, &m_usage[n]));
+            peer->TraceConnectWithoutContext ("PhyRxEnd", MakeBoundCallback (&MemoryAccounting::WireRx, &m_usage[n]));
+            peer->TraceConnectWithoutContext ("PhyRxDrop", MakeBoundCallback (&MemoryAccounting::WireRx, &m_usage[n]));
+          }
+      }
+  }
+
+  void SetFlowMonitor (Ptr<FlowMonitor> monitor) { m_monitor = monitor; }
+  /// Write the per-node file as well as the totals (default true)
+  void SetPerNode (bool perNode) { m_perNode = perNode; }
+
+  void
+  Start (Time start, Time interval, std::string prefix)
+  {
+    m_interval = interval;
+    std::string columns = "devPkts\tdevBytes\tqdiscPkts\tqdiscBytes\tflowQueues\tsockets\ttcpTx\ttcpRx\tflightPkts\tflightBytes";
+    m_out.open ((prefix + "-memory.dat").c_str (), std::ios::out);
+    m_out << "#Time(s)\t" << columns << "\tflowmon\trss\n" << std::fixed << std::setprecision (6);
+    if (m_perNode)
+      {
+        m_nodeOut.open ((prefix + "-memory-nodes.dat").c_str (), std::ios::out);
+        m_nodeOut << "#Time(s)\tnode\t" << columns << "\n" << std::fixed << std::setprecision (6);
+      }
+    m_event = Simulator::Schedule (start, &MemoryAccounting::Sample, this);
+  }
+
+  void
+  Stop (void)
+  {
+    m_event.Cancel ();
+    m_out.close ();
+    m_nodeOut.close ();
+  }
+
+  void
+  Report (std::ostream &os) const
+  {
+    uint32_t worst = std::max_element (m_nodePeak.begin (), m_nodePeak.end ()) - m_nodePeak.begin ();
+    os << "Peak memory use:\n";
+    PrintPeak (os, "device queues", m_peakTotal.deviceBytes, m_peakTime.deviceBytes, m_peakTotal.devicePackets, "packets");
+    PrintPeak (os, "queue discs", m_peakTotal.queueDiscBytes, m_peakTime.queueDiscBytes, m_peakTotal.queueDiscPackets, "packets");
+    os << "  flow queues     " << m_peakTotal.flowQueues << "\n";
+    PrintPeak (os, "TCP send", m_peakTotal.tcpTxBytes, m_peakTime.tcpTxBytes, m_peakTotal.sockets, "sockets");
+    PrintPeak (os, "TCP receive", m_peakTotal.tcpRxBytes, m_peakTime.tcpRxBytes, m_peakTotal.sockets, "sockets");
+    PrintPeak (os, "in flight", m_peakTotal.inFlightBytes, m_peakTime.inFlightBytes, m_peakTotal.inFlightPackets, "packets");
+    os << "  FlowMonitor     ~" << m_peakFlowMonitor << " bytes\n";
+    os << "  RSS             " << m_peakRss << " bytes\n";
+    if (!m_nodes.empty ())
+      {
+        os << "  largest node    " << m_nodes[worst]->GetId () << " (" << m_nodePeak[worst] << " bytes)\n";
+      }
+  }
+
+private:
+  static void
+  WireTx (MemoryUsage *u, Ptr<const Packet> p)
+  {
+    ++u->inFlightPackets;
+    u->inFlightBytes += p->GetSize ();
+  }
+
+  static void
+  WireRx (MemoryUsage *u, Ptr<const Packet> p)
+  {
+    --u->inFlightPackets;
+    u->inFlightBytes -= p->GetSize ();
+  }
+
+  // The peak of the packet or socket count may be at another time
+  static void
+  PrintPeak (std::ostream &os, const char *name, int64_t bytes, double time, uint64_t objects, const char *unit)
+  {
+    os << "  " << std::left << std::setw (16) << name << std::right << bytes << " bytes at " << time
+       << " s, up to " << objects << " " << unit << "\n";
+  }
+
+  void
+  Measure (Ptr<Node> node, MemoryUsage &u)
+  {
+    Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer> ();
+    for (uint32_t d = 0; d < node->GetNDevices (); ++d)
+      {
+        Ptr<NetDevice> dev = node->GetDevice (d);
+        Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice> (dev);
+        if (p2p)
+          {
+            Ptr<Queue<Packet> > queue = p2p->GetQueue ();
+            u.devicePackets += queue->GetNPackets ();
+            u.deviceBytes += queue->GetNBytes ();
+          }
+        Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice (dev) : 0;
+        if (qdisc)
+          {
+            u.queueDiscPackets += qdisc->GetNPackets ();
+            u.queueDiscBytes += qdisc->GetNBytes ();
+            u.flowQueues += qdisc->GetNQueueDiscClasses ();
+          }
+      }
+    Ptr<TcpL4Protocol> tcp = node->GetObject<TcpL4Protocol> ();
+    if (tcp)
+      {
+        ObjectVectorValue sockets;
+        tcp->GetAttribute ("SocketList", sockets);
+        for (ObjectVectorValue::Iterator s = sockets.Begin (); s != sockets.End (); ++s)
+          {
+            Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase> (s->second);
+            if (socket)
+              {
+                ++u.sockets;
+                u.tcpTxBytes += socket->GetTxBuffer ()->Size ();
+                u.tcpRxBytes += socket->GetRxBuffer ()->Size ();
+              }
+          }
+      }
+  }
+
+  // Flow records, probe records and histogram bins
+  uint64_t
+  FlowMonitorBytes (void) const
+  {
+    if (!m_monitor)
+      {
+        return 0;
+      }
+    const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+    uint64_t bytes = 0;
+    for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+      {
+        bytes += sizeof (FlowMonitor::FlowStats) + 32
+          + 4 * (i->second.delayHistogram.GetNBins () + i->second.jitterHistogram.GetNBins ()
+                 + i->second.packetSizeHistogram.GetNBins () + i->second.flowInterruptionsHistogram.GetNBins ());
+      }
+    const FlowMonitor::FlowProbeContainer &probes = m_monitor->GetAllProbes ();
+    for (std::size_t p = 0; p < probes.size (); ++p)
+      {
+        bytes += probes[p]->GetStats ().size () * (sizeof (FlowProbe::FlowStats) + 32);
+      }
+    return bytes;
+  }
+
+  void
+  Write (std::ofstream &out, const MemoryUsage &u)
+  {
+    out << "\t" << u.devicePackets << "\t" << u.deviceBytes
+        << "\t" << u.queueDiscPackets << "\t" << u.queueDiscBytes << "\t" << u.flowQueues
+        << "\t" << u.sockets << "\t" << u.tcpTxBytes << "\t" << u.tcpRxBytes
+        << "\t" << u.inFlightPackets << "\t" << u.inFlightBytes;
+  }
+
+  static void
+  Peak (uint64_t value, uint64_t &peak, double &when)
+  {
+    if (value > peak)
+      {
+        peak = value;
+        when = Simulator::Now ().GetSeconds ();
+      }
+  }
+
+  void
+  Sample (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    MemoryUsage total;
+    for (uint32_t n = 0; n < m_nodes.size (); ++n)
+      {
+        // The wire counters are kept by the traces; the rest is measured
+        MemoryUsage u;
+        u.inFlightPackets = m_usage[n].inFlightPackets;
+        u.inFlightBytes = m_usage[n].inFlightBytes;
+        Measure (m_nodes[n], u);
+        total.Add (u);
+        if (m_perNode)
+          {
+            m_nodeOut << now << "\t" << m_nodes[n]->GetId ();
+            Write (m_nodeOut, u);
+            m_nodeOut << "\n";
+          }
+        uint64_t bytes = u.deviceBytes + u.queueDiscBytes + u.tcpTxBytes + u.tcpRxBytes
+          + std::max<int64_t> (u.inFlightBytes, 0);
+        m_nodePeak[n] = std::max (m_nodePeak[n], bytes);
+      }
+
+    uint64_t flowmon = FlowMonitorBytes ();
+    uint64_t rss = TopologyBuilder::GetRssBytes ();
+    m_out << now;
+    Write (m_out, total);
+    m_out << "\t" << flowmon << "\t" << rss << "\n";
+
+    Peak (total.devicePackets, m_peakTotal.devicePackets, m_peakTime.devicePackets);
+    Peak (total.deviceBytes, m_peakTotal.deviceBytes, m_peakTime.deviceBytes);
+    Peak (total.queueDiscPackets, m_peakTotal.queueDiscPackets, m_peakTime.queueDiscPackets);
+    Peak (total.queueDiscBytes, m_peakTotal.queueDiscBytes, m_peakTime.queueDiscBytes);
+    Peak (total.flowQueues, m_peakTotal.flowQueues, m_peakTime.flowQueues);
+    Peak (total.sockets, m_peakTotal.sockets, m_peakTime.sockets);
+    Peak (total.tcpTxBytes, m_peakTotal.tcpTxBytes, m_peakTime.tcpTxBytes);
+    Peak (total.tcpRxBytes, m_peakTotal.tcpRxBytes, m_peakTime.tcpRxBytes);
+    Peak (total.inFlightPackets, m_peakTotal.inFlightPackets, m_peakTime.inFlightPackets);
+    uint64_t flight = total.inFlightBytes > 0 ? total.inFlightBytes : 0;
+    uint64_t peakFlight = m_peakTotal.inFlightBytes;
+    Peak (flight, peakFlight, m_peakTime.inFlightBytes);
+    m_peakTotal.inFlightBytes = peakFlight;
+    m_peakFlowMonitor = std::max (m_peakFlowMonitor, flowmon);
+    m_peakRss = std::max (m_peakRss, rss);
+
+    m_event = Simulator::Schedule (m_interval, &MemoryAccounting::Sample, this);
+  }
+
+  // Time of each peak, in the fields of a MemoryUsage
+  struct PeakTimes
+  {
+    PeakTimes ()
+      : devicePackets (0), deviceBytes (0), queueDiscPackets (0), queueDiscBytes (0),
+        flowQueues (0), sockets (0), tcpTxBytes (0), tcpRxBytes (0),
+        inFlightPackets (0), inFlightBytes (0)
+    {
+    }
+    double devicePackets, deviceBytes, queueDiscPackets, queueDiscBytes, flowQueues;
+    double sockets, tcpTxBytes, tcpRxBytes, inFlightPackets, inFlightBytes;
+  };
+
+  std::vector<Ptr<Node> >  m_nodes;
+  std::vector<MemoryUsage> m_usage;      //!< wire counters, updated by the traces
+  std::vector<uint64_t>    m_nodePeak;   //!< largest sampled bytes of each node
+  MemoryUsage              m_peakTotal;
+  PeakTimes                m_peakTime;
+  uint64_t                 m_peakFlowMonitor;
+  uint64_t                 m_peakRss;
+  Ptr<FlowMonitor>         m_monitor;
+  bool                     m_perNode;
+  Time                     m_interval;
+  EventId                  m_event;
+  std::ofstream            m_out;
+  std::ofstream            m_nodeOut;
+};
+
+} // namespace ns3
+
+#endif /* MEMORY_ACCOUNTING_H */
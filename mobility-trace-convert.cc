@@ -0,0 +1,303 @@
+// Convert ns-2 or BonnMotion mobility traces into the memory-mapped
+// trajectory format played back by TracePlaybackMobilityModel.
+//
+//   mobility-trace-convert ns2 scenario.tcl manet.mobt
+//   mobility-trace-convert bonnmotion scenario.movements manet.mobt
+//   mobility-trace-convert bonnmotion3d scenario.movements manet.mobt
+//
+// ns-2: "$node_(i) set X_|Y_|Z_ v" lines give initial positions,
+// "$ns_ at t \"$node_(i) setdest x y speed\"" starts a straight move at
+// speed m/s (cut short by the node's next setdest) and
+// "$ns_ at t \"$node_(i) set X_ v\"" makes the node jump.
+//
+// BonnMotion: the .movements file has one line per node of
+// "t x y" (or "t x y z" for bonnmotion3d) waypoints.
+//
+// The converter does not use the simulator and can also be built on its
+// own:  g++ -O2 -std=c++11 -o mobility-trace-convert mobility-trace-convert.cc
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mobility-trace-format.h"
+
+using namespace ns3;
+
+struct Ns2Event
+{
+  double time;
+  int    order;          //!< position in the file, to keep equal times stable
+  char   axis;           //!< 'X', 'Y' or 'Z' for a jump, 0 for setdest
+  double x;
+  double y;
+  double speed;
+};
+
+struct Ns2Node
+{
+  Ns2Node () : x (0), y (0), z (0) {}
+  double x;
+  double y;
+  double z;
+  std::vector<Ns2Event> events;
+};
+
+static MobilityTraceWaypoint
+Waypoint (double t, double x, double y, double z)
+{
+  MobilityTraceWaypoint w;
+  w.timeNs = llround (t * 1e9);
+  w.x = x;
+  w.y = y;
+  w.z = z;
+  w.reserved = 0;
+  return w;
+}
+
+static bool
+EarlierEvent (const Ns2Event &a, const Ns2Event &b)
+{
+  return a.time < b.time || (a.time == b.time && a.order < b.order);
+}
+
+// Position on a waypoint list at time t, which must not be before the
+// first waypoint.
+static void
+PositionAt (const std::vector<MobilityTraceWaypoint> &w, int64_t t, double &x, double &y, double &z)
+{
+  std::size_t i = w.size () - 1;
+  while (i > 0 && w[i].timeNs > t)
+    {
+      --i;
+    }
+  if (i + 1 == w.size () || w[i + 1].timeNs == w[i].timeNs)
+    {
+      x = w[i].x;
+      y = w[i].y;
+      z = w[i].z;
+      return;
+    }
+  double f = double (t - w[i].timeNs) / (w[i + 1].timeNs - w[i].timeNs);
+  x = w[i].x + f * (w[i + 1].x - w[i].x);
+  y = w[i].y + f * (w[i + 1].y - w[i].y);
+  z = w[i].z + f * (w[i + 1].z - w[i].z);
+}
+
+static bool
+ReadNs2 (std::istream &in, std::vector<std::vector<MobilityTraceWaypoint> > &nodes)
+{
+  std::vector<Ns2Node> ns2;
+  std::string line;
+  int order = 0;
+  while (std::getline (in, line))
+    {
+      unsigned id;
+      char axis;
+      double t, x, y, speed, v;
+      Ns2Event e;
+      e.order = order++;
+      if (std::sscanf (line.c_str (), " $ns_ at %lf \"$node_(%u) setdest %lf %lf %lf", &t, &id, &x, &y, &speed) == 5)
+        {
+          e.time = t;
+          e.axis = 0;
+          e.x = x;
+          e.y = y;
+          e.speed = speed;
+        }
+      else if (std::sscanf (line.c_str (), " $ns_ at %lf \"$node_(%u) set %c_ %lf", &t, &id, &axis, &v) == 4)
+        {
+          e.time = t;
+          e.axis = axis;
+          e.x = v;
+        }
+      else if (std::sscanf (line.c_str (), " $node_(%u) set %c_ %lf", &id, &axis, &v) == 3)
+        {
+          if (ns2.size () <= id)
+            {
+              ns2.resize (id + 1);
+            }
+          (axis == 'X' ? ns2[id].x : axis == 'Y' ? ns2[id].y : ns2[id].z) = v;
+          continue;
+        }
+      else
+        {
+          continue;
+        }
+      if (ns2.size () <= id)
+        {
+          ns2.resize (id + 1);
+        }
+      ns2[id].events.push_back (e);
+    }
+
+  nodes.resize (ns2.size ());
+  for (std::size_t n = 0; n < ns2.size (); ++n)
+    {
+      std::vector<MobilityTraceWaypoint> &w = nodes[n];
+      w.push_back (Waypoint (0, ns2[n].x, ns2[n].y, ns2[n].z));
+      std::vector<Ns2Event> &events = ns2[n].events;
+      std::sort (events.begin (), events.end (), EarlierEvent);
+      for (std::size_t i = 0; i < events.size (); ++i)
+        {
+          const Ns2Event &e = events[i];
+          int64_t t = llround (e.time * 1e9);
+          double x, y, z;
+          PositionAt (w, t, x, y, z);
+          // A new command cuts short the move in progress
+          while (w.size () > 1 && w.back ().timeNs > t)
+            {
+              w.pop_back ();
+            }
+          if (w.back ().timeNs < t)
+            {
+              w.push_back (Waypoint (e.time, x, y, z));
+            }
+          if (e.axis != 0)
+            {
+              (e.axis == 'X' ? x : e.axis == 'Y' ? y : z) = e.x;
+              w.push_back (Waypoint (e.time, x, y, z));
+              continue;
+            }
+          double distance = std::sqrt ((e.x - x) * (e.x - x) + (e.y - y) * (e.y - y));
+          if (e.speed > 0 && distance > 0)
+            {
+              w.push_back (Waypoint (e.time + distance / e.speed, e.x, e.y, z));
+            }
+        }
+    }
+  return true;
+}
+
+static bool
+ReadBonnMotion (std::istream &in, bool threeD, std::vector<std::vector<MobilityTraceWaypoint> > &nodes)
+{
+  std::string line;
+  while (std::getline (in, line))
+    {
+      if (line.find_first_not_of (" \t\r") == std::string::npos)
+        {
+          continue;
+        }
+      std::istringstream fields (line);
+      std::vector<MobilityTraceWaypoint> w;
+      double t, x, y, z = 0;
+      while (fields >> t >> x >> y && (!threeD || fields >> z))
+        {
+          w.push_back (Waypoint (t, x, y, z));
+        }
+      if (w.empty ())
+        {
+          std::cerr << "bad BonnMotion line: " << line << "\n";
+          return false;
+        }
+      nodes.push_back (w);
+    }
+  return true;
+}
+
+static bool
+Write (std::string fileName, const std::vector<std::vector<MobilityTraceWaypoint> > &nodes, uint64_t &nWaypoints)
+{
+  std::FILE *out = std::fopen (fileName.c_str (), "wb");
+  if (out == 0)
+    {
+      return false;
+    }
+  MobilityTraceFileHeader h;
+  std::memset (&h, 0, sizeof (h));
+  std::memcpy (h.magic, "NS3MOBT2", 8);
+  h.waypointSize = sizeof (MobilityTraceWaypoint);
+  h.nNodes = nodes.size ();
+  h.nWaypoints = 0;
+  std::vector<MobilityTraceNodeEntry> table (nodes.size ());
+  double maxSpeed = 0;
+  for (std::size_t i = 0; i < nodes.size (); ++i)
+    {
+      table[i].first = h.nWaypoints;
+      table[i].count = nodes[i].size ();
+      h.nWaypoints += nodes[i].size ();
+      for (std::size_t j = 1; j < nodes[i].size (); ++j)
+        {
+          const MobilityTraceWaypoint &a = nodes[i][j - 1];
+          const MobilityTraceWaypoint &b = nodes[i][j];
+          double dx = b.x - a.x;
+          double dy = b.y - a.y;
+          double dz = b.z - a.z;
+          double distance = std::sqrt (dx * dx + dy * dy + dz * dz);
+          if (distance > 0)
+            {
+              double dt = (b.timeNs - a.timeNs) / 1e9;
+              maxSpeed = std::max (maxSpeed, dt > 0 ? distance / dt : HUGE_VAL);
+            }
+        }
+    }
+  // Rounded up, so the bound holds in single precision too
+  h.maxSpeed = std::isinf (maxSpeed) ? HUGE_VALF : std::nextafter (float (maxSpeed), HUGE_VALF);
+  std::fwrite (&h, sizeof (h), 1, out);
+  if (!table.empty ())
+    {
+      std::fwrite (&table[0], sizeof (MobilityTraceNodeEntry), table.size (), out);
+    }
+  for (std::size_t i = 0; i < nodes.size (); ++i)
+    {
+      if (!nodes[i].empty ())
+        {
+          std::fwrite (&nodes[i][0], sizeof (MobilityTraceWaypoint), nodes[i].size (), out);
+        }
+    }
+  nWaypoints = h.nWaypoints;
+  return std::fclose (out) == 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 4)
+    {
+      std::cerr << "usage: " << argv[0] << " ns2|bonnmotion|bonnmotion3d <input> <output.mobt>\n";
+      return 1;
+    }
+  std::string format = argv[1];
+  std::ifstream in (argv[2]);
+  if (!in)
+    {
+      std::cerr << "cannot open " << argv[2] << "\n";
+      return 1;
+    }
+
+  std::vector<std::vector<MobilityTraceWaypoint> > nodes;
+  bool ok;
+  if (format == "ns2")
+    {
+      ok = ReadNs2 (in, nodes);
+    }
+  else if (format == "bonnmotion" || format == "bonnmotion3d")
+    {
+      ok = ReadBonnMotion (in, format == "bonnmotion3d", nodes);
+    }
+  else
+    {
+      std::cerr << "unknown input format " << format << "\n";
+      return 1;
+    }
+  if (!ok)
+    {
+      return 1;
+    }
+
+  uint64_t nWaypoints;
+  if (!Write (argv[3], nodes, nWaypoints))
+    {
+      std::cerr << "cannot write " << argv[3] << "\n";
+      return 1;
+    }
+  std::cout << nodes.size () << " nodes, " << nWaypoints << " waypoints\n";
+  return 0;
+}
@@ -0,0 +1,173 @@
+#ifndef MOBILITY_TRACE_FORMAT_H
+#define MOBILITY_TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Precomputed trajectory file, written by mobility-trace-convert and
+// played back by TracePlaybackMobilityModel (mobility-trace-playback.h).
+//
+//   MobilityTraceFileHeader
+//   MobilityTraceNodeEntry...         nNodes, indexed by trace node number
+//   MobilityTraceWaypoint...          nWaypoints, grouped by node
+//
+// A node's waypoints are sorted by time and the node moves in a straight
+// line at constant speed from one to the next.  It stays at its first
+// waypoint before that time and at its last one after.  Two waypoints
+// with the same time make the node jump.  All fields are in native byte
+// order; times are nanoseconds, coordinates meters.
+//
+// maxSpeed bounds the speed of every node at all times, so consumers that
+// track nodes between position queries (GridSpectrumChannel) can tell how
+// far one may have moved; it is infinite if any node jumps.
+
+namespace ns3 {
+
+struct MobilityTraceFileHeader
+{
+  char     magic[8];              //!< "NS3MOBT2"
+  uint32_t waypointSize;          //!< sizeof (MobilityTraceWaypoint)
+  uint32_t nNodes;
+  uint64_t nWaypoints;
+  float    maxSpeed;              //!< fastest segment of any node, m/s
+  uint32_t reserved;
+};
+
+struct MobilityTraceNodeEntry
+{
+  uint64_t first;                 //!< index of the node's first waypoint
+  uint64_t count;
+};
+
+struct MobilityTraceWaypoint
+{
+  int64_t  timeNs;
+  float    x;
+  float    y;
+  float    z;
+  uint32_t reserved;
+};
+
+/**
+ * Read-only, memory-mapped view of a mobility trace file.
+ *
+ * Opening maps the file and checks the node table; waypoint pages are
+ * only read from disk when a node's position is first asked for around
+ * that time.  Like FlowStatsReader this header does not depend on the
+ * simulator.
+ */
+class MobilityTraceReader
+{
+public:
+  MobilityTraceReader ()
+    : m_base (0),
+      m_length (0),
+      m_nodes (0),
+      m_waypoints (0),
+      m_nNodes (0),
+      m_maxSpeed (0)
+  {
+  }
+
+  ~MobilityTraceReader ()
+  {
+    Close ();
+  }
+
+  /// \return false if the file is missing, truncated or not a mobility trace
+  bool
+  Open (std::string fileName)
+  {
+    Close ();
+    int fd = open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return false;
+      }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || static_cast<std::size_t> (st.st_size) < sizeof (MobilityTraceFileHeader))
+      {
+        close (fd);
+        return false;
+      }
+    void *base = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+      {
+        return false;
+      }
+    m_base = base;
+    m_length = st.st_size;
+
+    const MobilityTraceFileHeader *h = static_cast<const MobilityTraceFileHeader *> (m_base);
+    uint64_t expected = sizeof (MobilityTraceFileHeader)
+      + uint64_t (h->nNodes) * sizeof (MobilityTraceNodeEntry)
+      + h->nWaypoints * sizeof (MobilityTraceWaypoint);
+    if (std::memcmp (h->magic, "NS3MOBT2", 8) != 0 || h->waypointSize != sizeof (MobilityTraceWaypoint)
+        || m_length < expected)
+      {
+        Close ();
+        return false;
+      }
+    m_nodes = reinterpret_cast<const MobilityTraceNodeEntry *> (h + 1);
+    m_waypoints = reinterpret_cast<const MobilityTraceWaypoint *> (m_nodes + h->nNodes);
+    m_nNodes = h->nNodes;
+    m_maxSpeed = h->maxSpeed;
+    for (uint32_t i = 0; i < m_nNodes; ++i)
+      {
+        if (m_nodes[i].first + m_nodes[i].count > h->nWaypoints)
+          {
+            Close ();
+            return false;
+          }
+      }
+    return true;
+  }
+
+  void
+  Close (void)
+  {
+    if (m_base != 0)
+      {
+        munmap (m_base, m_length);
+      }
+    m_base = 0;
+    m_length = 0;
+    m_nodes = 0;
+    m_waypoints = 0;
+    m_nNodes = 0;
+    m_maxSpeed = 0;
+  }
+
+  uint32_t GetNNodes (void) const { return m_nNodes; }
+  /// No node is ever faster than this (m/s); infinite if one jumps
+  double GetMaxSpeed (void) const { return m_maxSpeed; }
+
+  /// Waypoints of trace node \p node; \p count is set to their number
+  const MobilityTraceWaypoint *
+  GetWaypoints (uint32_t node, uint64_t &count) const
+  {
+    count = m_nodes[node].count;
+    return m_waypoints + m_nodes[node].first;
+  }
+
+private:
+  MobilityTraceReader (const MobilityTraceReader &);
+  MobilityTraceReader &operator= (const MobilityTraceReader &);
+
+  void                         *m_base;
+  std::size_t                   m_length;
+  const MobilityTraceNodeEntry *m_nodes;
+  const MobilityTraceWaypoint  *m_waypoints;
+  uint32_t                      m_nNodes;
+  double                        m_maxSpeed;
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TRACE_FORMAT_H */
@@ -0,0 +1,180 @@
+#ifndef MOBILITY_TRACE_PLAYBACK_H
+#define MOBILITY_TRACE_PLAYBACK_H
+
+#include <algorithm>
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+#include "mobility-trace-format.h"
+
+namespace ns3 {
+
+/// A mapped mobility trace file, shared by the models that play it back
+class MobilityTraceFile : public SimpleRefCount<MobilityTraceFile>
+{
+public:
+  MobilityTraceReader reader;
+};
+
+/**
+ * Mobility model that plays back one node of a precomputed trajectory
+ * file (see mobility-trace-format.h).
+ *
+ * The position is interpolated from the trace whenever it is asked for,
+ * so playback schedules no events, however many nodes and waypoints the
+ * trace has.  The last segment used is remembered, so the usual queries
+ * at increasing times find their segment in constant time.
+ *
+ * Since nothing happens at waypoints, no CourseChange is fired, and
+ * SetPosition is an error.  A GridSpectrumChannel therefore cannot see a
+ * node start moving between rebins: give it the trace's speed bound
+ * (returned by MobilityTracePlayback::Install) with SetSpeedBound.
+ */
+class TracePlaybackMobilityModel : public MobilityModel
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::TracePlaybackMobilityModel")
+      .SetParent<MobilityModel> ()
+      .SetGroupName ("Mobility")
+      .AddConstructor<TracePlaybackMobilityModel> ()
+    ;
+    return tid;
+  }
+
+  TracePlaybackMobilityModel ()
+    : m_waypoints (0),
+      m_count (0),
+      m_hint (0)
+  {
+  }
+
+  void
+  SetTrace (Ptr<MobilityTraceFile> file, uint32_t node)
+  {
+    NS_ABORT_MSG_UNLESS (node < file->reader.GetNNodes (), "Mobility trace has no node " << node);
+    m_file = file;
+    m_waypoints = file->reader.GetWaypoints (node, m_count);
+    m_hint = 0;
+  }
+
+private:
+  // Index i of the segment [i, i + 1] holding now, or m_count if now is
+  // before the first or after the last waypoint.
+  uint64_t
+  FindSegment (int64_t now) const
+  {
+    if (m_count < 2 || now < m_waypoints[0].timeNs || now >= m_waypoints[m_count - 1].timeNs)
+      {
+        return m_count;
+      }
+    for (uint64_t i = m_hint; i < m_hint + 2 && i + 1 < m_count; ++i)
+      {
+        if (m_waypoints[i].timeNs <= now && now < m_waypoints[i + 1].timeNs)
+          {
+            m_hint = i;
+            return i;
+          }
+      }
+    const MobilityTraceWaypoint *next = std::upper_bound (m_waypoints, m_waypoints + m_count, now, LaterThan ());
+    m_hint = (next - m_waypoints) - 1;
+    return m_hint;
+  }
+
+  struct LaterThan
+  {
+    bool operator() (int64_t now, const MobilityTraceWaypoint &w) const { return now < w.timeNs; }
+  };
+
+  static Vector
+  At (const MobilityTraceWaypoint &w)
+  {
+    return Vector (w.x, w.y, w.z);
+  }
+
+  virtual Vector
+  DoGetPosition (void) const
+  {
+    if (m_count == 0)
+      {
+        return Vector (0, 0, 0);
+      }
+    int64_t now = Simulator::Now ().GetNanoSeconds ();
+    uint64_t i = FindSegment (now);
+    if (i == m_count)
+      {
+        return At (now < m_waypoints[0].timeNs ? m_waypoints[0] : m_waypoints[m_count - 1]);
+      }
+    const MobilityTraceWaypoint &a = m_waypoints[i];
+    const MobilityTraceWaypoint &b = m_waypoints[i + 1];
+    double f = double (now - a.timeNs) / (b.timeNs - a.timeNs);
+    return Vector (a.x + f * (b.x - a.x), a.y + f * (b.y - a.y), a.z + f * (b.z - a.z));
+  }
+
+  virtual Vector
+  DoGetVelocity (void) const
+  {
+    uint64_t i = FindSegment (Simulator::Now ().GetNanoSeconds ());
+    if (i == m_count)
+      {
+        return Vector (0, 0, 0);
+      }
+    const MobilityTraceWaypoint &a = m_waypoints[i];
+    const MobilityTraceWaypoint &b = m_waypoints[i + 1];
+    double dt = (b.timeNs - a.timeNs) / 1e9;
+    return Vector ((b.x - a.x) / dt, (b.y - a.y) / dt, (b.z - a.z) / dt);
+  }
+
+  virtual void
+  DoSetPosition (const Vector &position)
+  {
+    NS_FATAL_ERROR ("TracePlaybackMobilityModel positions come from the trace");
+  }
+
+  Ptr<MobilityTraceFile>       m_file;
+  const MobilityTraceWaypoint *m_waypoints;
+  uint64_t                     m_count;
+  mutable uint64_t             m_hint;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TracePlaybackMobilityModel);
+
+/**
+ * Gives each node a TracePlaybackMobilityModel playing back the trace
+ * node with the same index in the container, and returns the trace's
+ * speed bound (m/s, infinite if a node jumps):
+ *
+ * \code
+ *   double maxSpeed = MobilityTracePlayback::Install ("manet-1000.mobt", nodes);
+ *   gridChannel->SetSpeedBound (maxSpeed);
+ * \endcode
+ */
+class MobilityTracePlayback
+{
+public:
+  static double
+  Install (std::string fileName, NodeContainer nodes)
+  {
+    Ptr<MobilityTraceFile> file = Create<MobilityTraceFile> ();
+    NS_ABORT_MSG_UNLESS (file->reader.Open (fileName), fileName << " is not a mobility trace file");
+    NS_ABORT_MSG_IF (nodes.GetN () > file->reader.GetNNodes (),
+                     fileName << " has " << file->reader.GetNNodes () << " nodes, " << nodes.GetN () << " needed");
+    for (uint32_t i = 0; i < nodes.GetN (); ++i)
+      {
+        NS_ABORT_MSG_IF (nodes.Get (i)->GetObject<MobilityModel> (), "Node " << nodes.Get (i)->GetId ()
+                         << " already has a mobility model");
+        Ptr<TracePlaybackMobilityModel> model = CreateObject<TracePlaybackMobilityModel> ();
+        model->SetTrace (file, i);
+        nodes.Get (i)->AggregateObject (model);
+      }
+    return file->reader.GetMaxSpeed ();
+  }
+};
+
+} // namespace ns3
+
+#endif /* MOBILITY_TRACE_PLAYBACK_H */
@@ -0,0 +1,226 @@
+#ifndef MY_APP_H
+#define MY_APP_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "packet-pool.h"
+
+namespace ns3 {
+
+/**
+ * Constant bit rate sender shared by the lab scenarios.
+ *
+ * Sends nPackets packets of packetSize bytes on an already created socket
+ * at dataRate.  Payload packets come from a PacketPool, so once the pool
+ * has warmed up a send does not allocate a new Packet or Buffer.
+ *
+ * The inter-packet interval is kept in integer nanoseconds and only
+ * recomputed by Setup and ChangeRate; the sub-nanosecond remainder is
+ * carried from packet to packet so the long-run rate is exact.  With a
+ * burst size k > 1 one event sends k packets back to back and the next
+ * event is scheduled k intervals later, cutting the number of simulator
+ * events by a factor of k at the same average rate.
+ */
+class MyApp : public Application
+{
+public:
+
+  MyApp ();
+  virtual ~MyApp();
+
+  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
+  void ChangeRate(DataRate newrate);
+
+  /// Number of packets that may be held by the stack before the pool creates new ones.
+  void SetPoolCapacity (uint32_t capacity);
+  const PacketPool &GetPool (void) const;
+
+  /// Number of packets sent back to back per send event (default 1).
+  void SetBurstSize (uint32_t burstSize);
+
+  /// Packets handed to the socket since the application started.
+  uint32_t GetPacketsSent (void) const;
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void ScheduleTx (void);
+  void SendPacket (void);
+  void UpdateTxInterval (void);
+
+  Ptr<Socket>     m_socket;
+  Address         m_peer;
+  uint32_t        m_packetSize;
+  uint32_t        m_nPackets;
+  DataRate        m_dataRate;
+  EventId         m_sendEvent;
+  bool            m_running;
+  uint32_t        m_packetsSent;
+  uint32_t        m_poolCapacity;
+  PacketPool      m_pool;
+  uint32_t        m_burstSize;
+  uint32_t        m_burstSent;      //!< packets sent by the current send event
+  uint64_t        m_txIntervalNs;   //!< whole nanoseconds per packet
+  uint64_t        m_txIntervalRem;  //!< remainder of (bits * 1e9) / bitRate
+  uint64_t        m_txRemAcc;       //!< accumulated remainder, < bitRate
+};
+
+inline
+MyApp::MyApp ()
+  : m_socket (0),
+    m_peer (),
+    m_packetSize (0),
+    m_nPackets (0),
+    m_dataRate (0),
+    m_sendEvent (),
+    m_running (false),
+    m_packetsSent (0),
+    m_poolCapacity (256),
+    m_burstSize (1),
+    m_burstSent (0),
+    m_txIntervalNs (0),
+    m_txIntervalRem (0),
+    m_txRemAcc (0)
+{
+}
+
+inline
+MyApp::~MyApp()
+{
+  m_socket = 0;
+}
+
+inline void
+MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
+{
+  m_socket = socket;
+  m_peer = address;
+  m_packetSize = packetSize;
+  m_nPackets = nPackets;
+  m_dataRate = dataRate;
+  m_pool.Setup (m_packetSize, m_poolCapacity);
+  UpdateTxInterval ();
+}
+
+inline void
+MyApp::SetPoolCapacity (uint32_t capacity)
+{
+  m_poolCapacity = capacity;
+  m_pool.Setup (m_packetSize, m_poolCapacity);
+}
+
+inline const PacketPool &
+MyApp::GetPool (void) const
+{
+  return m_pool;
+}
+
+inline void
+MyApp::SetBurstSize (uint32_t burstSize)
+{
+  NS_ASSERT (burstSize > 0);
+  m_burstSize = burstSize;
+}
+
+inline uint32_t
+MyApp::GetPacketsSent (void) const
+{
+  return m_packetsSent;
+}
+
+inline void
+MyApp::UpdateTxInterval (void)
+{
+  uint64_t bitRate = m_dataRate.GetBitRate ();
+  if (bitRate == 0)
+    {
+      m_txIntervalNs = 0;
+      m_txIntervalRem = 0;
+      m_txRemAcc = 0;
+      return;
+    }
+  uint64_t bitNs = static_cast<uint64_t> (m_packetSize) * 8 * 1000000000ULL;
+  m_txIntervalNs = bitNs / bitRate;
+  m_txIntervalRem = bitNs % bitRate;
+  m_txRemAcc = 0;
+}
+
+inline void
+MyApp::StartApplication (void)
+{
+  m_running = true;
+  m_packetsSent = 0;
+  m_socket->Bind ();
+  m_socket->Connect (m_peer);
+  SendPacket ();
+}
+
+inline void
+MyApp::StopApplication (void)
+{
+  m_running = false;
+
+  if (m_sendEvent.IsRunning ())
+    {
+      Simulator::Cancel (m_sendEvent);
+    }
+
+  if (m_socket)
+    {
+      m_socket->Close ();
+    }
+}
+
+inline void
+MyApp::SendPacket (void)
+{
+  m_burstSent = 0;
+  do
+    {
+      m_socket->Send (m_pool.Get ());
+      ++m_burstSent;
+    }
+  while (++m_packetsSent < m_nPackets && m_burstSent < m_burstSize);
+
+  if (m_packetsSent < m_nPackets)
+    {
+      ScheduleTx ();
+    }
+}
+
+inline void
+MyApp::ScheduleTx (void)
+{
+  if (m_running)
+    {
+      uint64_t bitRate = m_dataRate.GetBitRate ();
+      if (bitRate == 0)
+        {
+          // Paused until ChangeRate gives a rate again
+          return;
+        }
+      uint64_t delayNs = m_txIntervalNs * m_burstSent;
+      m_txRemAcc += m_txIntervalRem * m_burstSent;
+      delayNs += m_txRemAcc / bitRate;
+      m_txRemAcc %= bitRate;
+      m_sendEvent = Simulator::Schedule (NanoSeconds (delayNs), &MyApp::SendPacket, this);
+    }
+}
+
+inline void
+MyApp::ChangeRate(DataRate newrate)
+{
+   m_dataRate = newrate;
+   UpdateTxInterval ();
+   // Resume a sender paused at a rate of zero
+   if (m_running && !m_sendEvent.IsRunning () && m_packetsSent < m_nPackets)
+     {
+       ScheduleTx ();
+     }
+   return;
+}
+
+} // namespace ns3
+
+#endif /* MY_APP_H */
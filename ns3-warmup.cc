@@ -12,6 +12,10 @@
 #include "ns3/internet-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "flow-stats-export.h"
+#include "flow-query.h"
+#include "compressed-pcap.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Lab1");
@@ -22,11 +26,21 @@ int main (int argc, char *argv[])
   double lat = 2.0;
   uint64_t rate = 5000000; // Data rate in bps
   double interval = 0.05;
+  std::string flowmonFormat = "bin";
+  bool compressedPcap = false;
+  uint32_t snapLen = 96;
+  std::string pcapCompressor = "gzip";
+  uint32_t pcapRotateMB = 0;
 
   CommandLine cmd;
   cmd.AddValue ("latency", "P2P link Latency in miliseconds", lat);
   cmd.AddValue ("rate", "P2P data rate in bps", rate);
   cmd.AddValue ("interval", "UDP client packet interval", interval);
+  cmd.AddValue ("flowmonFormat", "Flow monitor output format: bin, csv or xml", flowmonFormat);
+  cmd.AddValue ("compressedPcap", "Write truncated, compressed pcap files from a background thread", compressedPcap);
+  cmd.AddValue ("snapLen", "Bytes kept per frame with --compressedPcap (0 for whole frames)", snapLen);
+  cmd.AddValue ("pcapCompressor", "Compressor for --compressedPcap: gzip, bzip2, xz, zstd or none", pcapCompressor);
+  cmd.AddValue ("pcapRotateMB", "Start a new --compressedPcap file every this many MB (0 to disable)", pcapRotateMB);
 
   cmd.Parse (argc, argv);
 
@@ -120,7 +134,18 @@ int main (int argc, char *argv[])
 //
   AsciiTraceHelper ascii;
   p2p.EnableAscii(ascii.CreateFileStream ("lab-1.tr"), dev);
-  p2p.EnablePcap("lab-1", dev, false);
+  CompressedPcap pcap;
+  if (compressedPcap)
+    {
+      pcap.SetSnapLen (snapLen);
+      pcap.SetCompressor (pcapCompressor);
+      pcap.SetMaxFileBytes (uint64_t (pcapRotateMB) << 20);
+      pcap.EnablePointToPoint ("lab-1", dev);
+    }
+  else
+    {
+      p2p.EnablePcap("lab-1", dev, false);
+    }
 
 //
 // Calculate Throughput using Flowmonitor
@@ -135,26 +160,27 @@ int main (int argc, char *argv[])
   NS_LOG_INFO ("Run Simulation.");
   Simulator::Stop (Seconds(11.0));
   Simulator::Run ();
+  pcap.Close ();
 
   monitor->CheckForLostPackets ();
 
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i)
+  FlowQuery query (monitor, flowmon.GetClassifier ());
+  FlowFilter n1ToN2 = FlowFilter ().Source (Ipv4Address ("10.1.1.1")).Destination (Ipv4Address ("10.1.2.2"));
+  std::vector<uint32_t> flows = query.Select (n1ToN2);
+  for (std::size_t i = 0; i < flows.size (); ++i)
     {
-	  Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-      if ((t.sourceAddress=="10.1.1.1" && t.destinationAddress == "10.1.2.2"))
-      {
-          std::cout << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-          std::cout << "  Tx Bytes:   " << i->second.txBytes << "\n";
-          std::cout << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-      	  std::cout << "  Throughput: " << i->second.rxBytes * 8.0 / (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps\n";
-      }
-     }
-
-
-
-  monitor->SerializeToXmlFile("lab-1.flowmon", true, true);
+      const FlowMonitor::FlowStats &st = query.GetStats (flows[i]);
+      std::cout << "Flow " << query.GetFlowId (flows[i]) << " (" << query.GetSource (flows[i]) << " -> " << query.GetDestination (flows[i]) << ")\n";
+      std::cout << "  Tx Bytes:   " << st.txBytes << "\n";
+      std::cout << "  Rx Bytes:   " << st.rxBytes << "\n";
+      std::cout << "  Throughput: " << st.rxBytes * 8.0 / (st.timeLastRxPacket.GetSeconds() - st.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps\n";
+    }
+  FlowGroupSummary summary = query.Summarize (n1ToN2);
+  std::cout << "  Loss:       " << summary.lossRatio * 100 << " %\n";
+  std::cout << "  Delay p50/p95/p99:  " << summary.delayP50 * 1000 << " / " << summary.delayP95 * 1000 << " / " << summary.delayP99 * 1000 << " ms\n";
+  std::cout << "  Jitter p50/p95/p99: " << summary.jitterP50 * 1000 << " / " << summary.jitterP95 * 1000 << " / " << summary.jitterP99 * 1000 << " ms\n";
+
+  FlowStatsExporter::Write (monitor, flowmon.GetClassifier (), "lab-1", flowmonFormat);
 
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
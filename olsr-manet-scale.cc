@@ -0,0 +1,367 @@
+// Scalable OLSR MANET benchmark
+//
+// The olsr-manet.cc setup (802.11b ad hoc, two-ray ground, OLSR) with
+// --nodes nodes placed at random in an --area x --area square, moving
+// with the chosen --mobility model, and --flows constant bit rate UDP
+// flows between random node pairs.  Reports:
+//
+// - OLSR control overhead: HELLO and TC bytes sent, from the OLSR Tx trace
+// - route convergence: the last routing table change before the tables
+//   stay unchanged for --quiet seconds
+// - packet delivery ratio of the UDP flows
+// - wall clock time and simulator events per second
+//
+// --channel=grid runs the PHYs on a GridSpectrumChannel, which only
+// delivers each transmission to nodes within radio range.
+//
+//   ./waf --run "olsr-manet-scale --nodes=100 --area=1500 --flows=20"
+//   ./waf --run "olsr-manet-scale --nodes=200 --mobility=waypoint --speed=5"
+//   ./waf --run "olsr-manet-scale --nodes=500 --area=5000 --channel=grid"
+//   ./waf --run "olsr-manet-scale --nodes=1000 --mobility=trace --mobilityTrace=manet-1000.mobt"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/olsr-module.h"
+#include "ns3/spectrum-module.h"
+
+#include "my-app.h"
+#include "trace-attach.h"
+#include "grid-spectrum-channel.h"
+#include "mobility-trace-playback.h"
+#include "simulator-profiler.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("OlsrManetScale");
+
+struct OlsrOverhead
+{
+  OlsrOverhead () : packets (0), packetBytes (0), helloMessages (0), helloBytes (0),
+                    tcMessages (0), tcBytes (0), otherBytes (0) {}
+  uint64_t packets;
+  uint64_t packetBytes;     //!< whole OLSR packets, without UDP/IP headers
+  uint64_t helloMessages;
+  uint64_t helloBytes;
+  uint64_t tcMessages;
+  uint64_t tcBytes;
+  uint64_t otherBytes;      //!< MID and HNA messages
+};
+
+static OlsrOverhead g_overhead;
+static std::vector<double> g_tableChanges;
+static uint64_t g_rxPackets = 0;
+
+static void
+OlsrTx (const olsr::PacketHeader &header, const olsr::MessageList &messages)
+{
+  ++g_overhead.packets;
+  g_overhead.packetBytes += header.GetPacketLength ();
+  for (olsr::MessageList::const_iterator m = messages.begin (); m != messages.end (); ++m)
+    {
+      uint32_t bytes = m->GetSerializedSize ();
+      switch (m->GetMessageType ())
+        {
+        case olsr::MessageHeader::HELLO_MESSAGE:
+          ++g_overhead.helloMessages;
+          g_overhead.helloBytes += bytes;
+          break;
+        case olsr::MessageHeader::TC_MESSAGE:
+          ++g_overhead.tcMessages;
+          g_overhead.tcBytes += bytes;
+          break;
+        default:
+          g_overhead.otherBytes += bytes;
+          break;
+        }
+    }
+}
+
+static void
+TableChanged (uint32_t size)
+{
+  g_tableChanges.push_back (Simulator::Now ().GetSeconds ());
+}
+
+static void
+SinkRx (Ptr<const Packet> p, const Address &from)
+{
+  ++g_rxPackets;
+}
+
+// Time of the last table change followed by at least quiet seconds without
+// one, or a negative value if the tables never settle.
+static double
+ConvergenceTime (std::vector<double> changes, double quiet, double end)
+{
+  std::sort (changes.begin (), changes.end ());
+  for (std::size_t i = 0; i < changes.size (); ++i)
+    {
+      double next = i + 1 < changes.size () ? changes[i + 1] : end;
+      if (next - changes[i] >= quiet)
+        {
+          return changes[i];
+        }
+    }
+  return -1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nNodes = 50;
+  double area = 1000.0;
+  std::string mobilityModel = "static";
+  std::string mobilityTrace = "";
+  double speed = 2.0;
+  double pause = 5.0;
+  uint32_t nFlows = 10;
+  std::string flowRate = "64Kbps";
+  uint32_t packetSize = 512;
+  double flowStart = 15.0;
+  double duration = 60.0;
+  double quiet = 10.0;
+  std::string phyMode ("DsssRate1Mbps");
+  std::string channelType = "yans";
+  bool profile = false;
+  std::string profileFlameGraph = "";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nodes", "Number of nodes", nNodes);
+  cmd.AddValue ("area", "Side of the square area in meters", area);
+  cmd.AddValue ("mobility", "static, waypoint, walk or trace", mobilityModel);
+  cmd.AddValue ("mobilityTrace", "Trajectory file for --mobility=trace (see mobility-trace-convert)", mobilityTrace);
+  cmd.AddValue ("speed", "Node speed in m/s for waypoint and walk", speed);
+  cmd.AddValue ("pause", "Pause time in seconds for waypoint", pause);
+  cmd.AddValue ("flows", "Number of UDP flows between random node pairs", nFlows);
+  cmd.AddValue ("flowRate", "Data rate of each flow", flowRate);
+  cmd.AddValue ("packetSize", "UDP payload size in bytes", packetSize);
+  cmd.AddValue ("flowStart", "Time the flows start, to let OLSR converge first", flowStart);
+  cmd.AddValue ("duration", "Simulated time in seconds", duration);
+  cmd.AddValue ("quiet", "Seconds without table changes that count as converged", quiet);
+  cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
+  cmd.AddValue ("channel", "yans, spectrum, or grid (spectrum with range culling)", channelType);
+  cmd.AddValue ("profile", "Report wall time per event type at the end of the run", profile);
+  cmd.AddValue ("profileFlameGraph", "With --profile, also write folded flame graph stacks to this file", profileFlameGraph);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (nNodes < 2, "Need at least two nodes");
+  if (profile)
+    {
+      SimulatorProfiler::Enable (profileFlameGraph);
+    }
+
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+
+  // Same PHY, channel and MAC as olsr-manet.cc
+  WifiMacHelper wifiMac;
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  WifiHelper wifi;
+  wifi.SetStandard (WIFI_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager", "DataMode", StringValue (phyMode),
+                                "ControlMode", StringValue (phyMode));
+  NetDeviceContainer devices;
+  Ptr<GridSpectrumChannel> gridChannel;
+  if (channelType == "yans")
+    {
+      YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+      YansWifiChannelHelper wifiChannel;
+      wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+      wifiChannel.AddPropagationLoss ("ns3::TwoRayGroundPropagationLossModel", "SystemLoss",
+                                      DoubleValue (1), "HeightAboveZ", DoubleValue (1.5));
+      wifiPhy.Set ("TxGain", DoubleValue (1));
+      wifiPhy.Set ("RxGain", DoubleValue (1));
+      wifiPhy.SetChannel (wifiChannel.Create ());
+      devices = wifi.Install (wifiPhy, wifiMac, nodes);
+    }
+  else if (channelType == "spectrum" || channelType == "grid")
+    {
+      Ptr<TwoRayGroundPropagationLossModel> loss = CreateObject<TwoRayGroundPropagationLossModel> ();
+      loss->SetAttribute ("SystemLoss", DoubleValue (1));
+      loss->SetAttribute ("HeightAboveZ", DoubleValue (1.5));
+      Ptr<SpectrumChannel> channel;
+      if (channelType == "grid")
+        {
+          // Default TxPowerEnd, both antenna gains and RxSensitivity
+          gridChannel = CreateObject<GridSpectrumChannel> ();
+          gridChannel->SetMaxRange (GridSpectrumChannel::GetRange (loss, 16.0206 + 2, -101));
+          channel = gridChannel;
+        }
+      else
+        {
+          channel = CreateObject<SingleModelSpectrumChannel> ();
+        }
+      channel->AddPropagationLossModel (loss);
+      channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+      SpectrumWifiPhyHelper spectrumPhy = SpectrumWifiPhyHelper::Default ();
+      spectrumPhy.Set ("TxGain", DoubleValue (1));
+      spectrumPhy.Set ("RxGain", DoubleValue (1));
+      spectrumPhy.SetChannel (channel);
+      devices = wifi.Install (spectrumPhy, wifiMac, nodes);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown channel " << channelType);
+    }
+
+  // Mobility
+  std::ostringstream bound;
+  bound << "ns3::UniformRandomVariable[Min=0.0|Max=" << area << "]";
+  ObjectFactory positions;
+  positions.SetTypeId ("ns3::RandomRectanglePositionAllocator");
+  positions.Set ("X", StringValue (bound.str ()));
+  positions.Set ("Y", StringValue (bound.str ()));
+  Ptr<PositionAllocator> positionAlloc = positions.Create ()->GetObject<PositionAllocator> ();
+
+  std::ostringstream speedValue;
+  speedValue << "ns3::ConstantRandomVariable[Constant=" << speed << "]";
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (positionAlloc);
+  if (mobilityModel == "static")
+    {
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    }
+  else if (mobilityModel == "waypoint")
+    {
+      std::ostringstream pauseValue;
+      pauseValue << "ns3::ConstantRandomVariable[Constant=" << pause << "]";
+      mobility.SetMobilityModel ("ns3::RandomWaypointMobilityModel",
+                                 "Speed", StringValue (speedValue.str ()),
+                                 "Pause", StringValue (pauseValue.str ()),
+                                 "PositionAllocator", PointerValue (positionAlloc));
+    }
+  else if (mobilityModel == "walk")
+    {
+      mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                 "Speed", StringValue (speedValue.str ()),
+                                 "Bounds", RectangleValue (Rectangle (0, area, 0, area)));
+    }
+  else if (mobilityModel != "trace")
+    {
+      NS_FATAL_ERROR ("Unknown mobility model " << mobilityModel);
+    }
+  if (mobilityModel == "trace")
+    {
+      double maxSpeed = MobilityTracePlayback::Install (mobilityTrace, nodes);
+      if (gridChannel)
+        {
+          // Playback fires no CourseChange: the channel must assume every
+          // node may be moving at the trace's top speed
+          NS_ABORT_MSG_IF (std::isinf (maxSpeed), mobilityTrace << " has nodes that jump; "
+                           "use --channel=spectrum");
+          gridChannel->SetSpeedBound (maxSpeed);
+        }
+    }
+  else
+    {
+      mobility.Install (nodes);
+    }
+
+  // OLSR and the internet stack
+  OlsrHelper olsr;
+  Ipv4ListRoutingHelper list;
+  list.Add (olsr, 10);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (list);
+  internet.Install (nodes);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.0.0", "255.255.0.0");
+  Ipv4InterfaceContainer interfaces = ipv4.Assign (devices);
+
+  // A sink on every node and flows between random distinct pairs
+  uint16_t sinkPort = 9;
+  PacketSinkHelper packetSinkHelper ("ns3::UdpSocketFactory",
+                                     InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
+  ApplicationContainer sinkApps = packetSinkHelper.Install (nodes);
+  sinkApps.Start (Seconds (0.));
+  sinkApps.Stop (Seconds (duration));
+
+  Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable> ();
+  std::vector<Ptr<MyApp> > apps;
+  for (uint32_t f = 0; f < nFlows; ++f)
+    {
+      uint32_t src = pick->GetInteger (0, nNodes - 1);
+      uint32_t dst = pick->GetInteger (0, nNodes - 2);
+      if (dst >= src)
+        {
+          ++dst;
+        }
+      Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (src), UdpSocketFactory::GetTypeId ());
+      Ptr<MyApp> app = CreateObject<MyApp> ();
+      app->Setup (socket, InetSocketAddress (interfaces.GetAddress (dst), sinkPort), packetSize,
+                  0xffffffff, DataRate (flowRate));
+      nodes.Get (src)->AddApplication (app);
+      // Stop sending a second early so packets in flight can still arrive
+      app->SetStartTime (Seconds (flowStart + pick->GetValue (0, 1)));
+      app->SetStopTime (Seconds (duration - 1));
+      apps.push_back (app);
+    }
+
+  // Traces
+  TraceAttach::Aggregated<olsr::RoutingProtocol> (nodes, "Tx", MakeCallback (&OlsrTx));
+  TraceAttach::Aggregated<olsr::RoutingProtocol> (nodes, "RoutingTableChanged", MakeCallback (&TableChanged));
+  TraceAttach::Applications<PacketSink> (sinkApps, "Rx", MakeCallback (&SinkRx));
+
+  NS_LOG_INFO ("Run Simulation.");
+  Simulator::Stop (Seconds (duration));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now () - start;
+  uint64_t events = Simulator::GetEventCount ();
+
+  uint64_t txPackets = 0;
+  for (std::size_t i = 0; i < apps.size (); ++i)
+    {
+      txPackets += apps[i]->GetPacketsSent ();
+    }
+  double converged = ConvergenceTime (g_tableChanges, quiet, duration);
+  // UDP (8) and IPv4 (20) headers of every OLSR packet
+  uint64_t olsrWireBytes = g_overhead.packetBytes + g_overhead.packets * 28;
+
+  std::cout << std::fixed << std::setprecision (3);
+  std::cout << "Nodes:              " << nNodes << " in " << area << " x " << area << " m, "
+            << mobilityModel << "\n";
+  std::cout << "Flows:              " << nFlows << " x " << flowRate << "\n";
+  std::cout << "OLSR packets:       " << g_overhead.packets << " (" << olsrWireBytes << " bytes with UDP/IP, "
+            << olsrWireBytes * 8.0 / duration / 1000 << " kbps)\n";
+  std::cout << "  HELLO:            " << g_overhead.helloMessages << " messages, " << g_overhead.helloBytes << " bytes\n";
+  std::cout << "  TC:               " << g_overhead.tcMessages << " messages, " << g_overhead.tcBytes << " bytes\n";
+  std::cout << "  MID/HNA:          " << g_overhead.otherBytes << " bytes\n";
+  std::cout << "Table changes:      " << g_tableChanges.size () << "\n";
+  if (converged >= 0)
+    {
+      std::cout << "Converged at:       " << converged << " s\n";
+    }
+  else
+    {
+      std::cout << "Converged at:       never (no " << quiet << " s without table changes)\n";
+    }
+  std::cout << "Delivery ratio:     " << (txPackets > 0 ? double (g_rxPackets) / txPackets : 0)
+            << " (" << g_rxPackets << " / " << txPackets << ")\n";
+  if (gridChannel)
+    {
+      std::cout << "Channel deliveries: " << gridChannel->GetNDeliveries () << " for "
+                << gridChannel->GetNTransmissions () << " transmissions (range "
+                << gridChannel->GetMaxRange () << " m)\n";
+    }
+  std::cout << "Wall clock:         " << wall.count () << " s\n";
+  std::cout << "Events:             " << events << " (" << std::setprecision (0)
+            << (wall.count () > 0 ? events / wall.count () : 0) << " per second)\n";
+
+  Simulator::Destroy ();
+  NS_LOG_INFO ("Done.");
+  return 0;
+}
@@ -17,113 +17,17 @@
 #include "ns3/wifi-module.h"
 #include "ns3/olsr-module.h"
 
+#include "my-app.h"
+#include "trace-attach.h"
+#include "simulator-profiler.h"
+#include "steady-state-detector.h"
+#include "time-bin-aggregator.h"
+
 
 NS_LOG_COMPONENT_DEFINE ("Problem 2");
 
 using namespace ns3;
 
-class MyApp : public Application
-{
-public:
-  MyApp ();
-  virtual ~MyApp ();
-
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets,
-              DataRate dataRate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-
-  Ptr<Socket> m_socket;
-  Address m_peer;
-  uint32_t m_packetSize;
-  uint32_t m_nPackets;
-  DataRate m_dataRate;
-  EventId m_sendEvent;
-  bool m_running;
-  uint32_t m_packetsSent;
-};
-
-MyApp::MyApp ()
-    : m_socket (0),
-      m_peer (),
-      m_packetSize (0),
-      m_nPackets (0),
-      m_dataRate (0),
-      m_sendEvent (),
-      m_running (false),
-      m_packetsSent (0)
-{
-}
-
-MyApp::~MyApp ()
-{
-  m_socket = 0;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets,
-              DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void
-MyApp::StartApplication (void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  m_socket->Bind ();
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
-
-void
-MyApp::StopApplication (void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
-    {
-      Simulator::Cancel (m_sendEvent);
-    }
-
-  if (m_socket)
-    {
-      m_socket->Close ();
-    }
-}
-
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
-
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
-}
-
-void
-MyApp::ScheduleTx (void)
-{
-  if (m_running)
-    {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
-    }
-}
-
 static void
 SetPosition (Ptr<Node> node, double x)
 {
@@ -144,11 +48,26 @@ main (int argc, char *argv[])
 {
 
   std::string phyMode ("DsssRate1Mbps");
+  bool profile = false;
+  std::string profileFlameGraph = "";
+  double steadyState = 0;
+  double binInterval = 0;
+  std::string binMode = "sum";
 
   CommandLine cmd;
   cmd.AddValue ("phyMode", "Wifi Phy mode", phyMode);
+  cmd.AddValue ("profile", "Report wall time per event type at the end of the run", profile);
+  cmd.AddValue ("profileFlameGraph", "With --profile, also write folded flame graph stacks to this file", profileFlameGraph);
+  cmd.AddValue ("steadyState", "Stop once the goodput node 2 relays to node 3 is known to this relative precision (0 to run 60 s)", steadyState);
+  cmd.AddValue ("binInterval", "Plot and file output per bin of this many seconds instead of per packet (0 to disable)", binInterval);
+  cmd.AddValue ("binMode", "Value of each bin: sum, count, min, max or mean of the packet sizes", binMode);
   cmd.Parse (argc, argv);
 
+  if (profile)
+    {
+      SimulatorProfiler::Enable (profileFlameGraph);
+    }
+
   //
   // Explicitly create the nodes required by the topology (shown above).
   //
@@ -242,8 +161,7 @@ main (int argc, char *argv[])
   Simulator::Schedule (Seconds (35.0), &SetPosition, nodeGroup.Get (1), 1000.0);
 
   // Trace Received Packets
-  Config::ConnectWithoutContext ("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx",
-                                 MakeCallback (&ReceivePacket));
+  TraceAttach::Applications<PacketSink> (sinkApps, "Rx", MakeCallback (&ReceivePacket));
 
   // Trace devices (pcap)
   wifiPhy.EnablePcap ("prob-2-new", devices, true);
@@ -253,22 +171,65 @@ main (int argc, char *argv[])
   probeType = "ns3::ApplicationPacketProbe";
   tracePath = "/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx";
   GnuplotHelper plotHelper;
-  plotHelper.ConfigurePlot ("olsr-manet", "the number of bytes received versus time at Node 3",
-                            "Time (Seconds", "the number of bytes");
-  plotHelper.PlotProbe (probeType, tracePath, "OutputBytes", "Packet Byte Count",
-                        GnuplotAggregator::KEY_BELOW);
-
   FileHelper fileHelper;
-  fileHelper.ConfigureFile("olsr-manet", FileAggregator::FORMATTED);
-  fileHelper.Set2dFormat ("Time (Seconds) = %.3e\tPacket Byte Count = %.0f");
-  fileHelper.WriteProbe (probeType,
-                         tracePath,
-                         "OutputBytes");
+  Ptr<GnuplotAggregator> binnedPlot;
+  Ptr<FileAggregator> binnedFile;
+  TimeBinAggregator bins (Seconds (binInterval), TimeBinAggregator::ParseMode (binMode));
+  if (binInterval > 0)
+    {
+      // One point and one line per bin instead of per packet
+      binnedPlot = CreateObject<GnuplotAggregator> ("olsr-manet");
+      binnedPlot->SetTerminal ("png");
+      binnedPlot->SetTitle ("the number of bytes received versus time at Node 3");
+      binnedPlot->SetLegend ("Time (Seconds)", "the number of bytes (" + binMode + " per bin)");
+      binnedPlot->SetKeyLocation (GnuplotAggregator::KEY_BELOW);
+      binnedPlot->Add2dDataset ("bytes", "Packet Byte Count");
+      binnedFile = CreateObject<FileAggregator> ("olsr-manet.txt", FileAggregator::FORMATTED);
+      binnedFile->Set2dFormat ("Time (Seconds) = %.3e\tPacket Byte Count = %.0f");
+      bins.ConnectProbe (probeType, tracePath, "OutputBytes");
+      bins.AddAggregator (binnedPlot, "bytes");
+      bins.AddAggregator (binnedFile, "bytes");
+      bins.Start ();
+    }
+  else
+    {
+      plotHelper.ConfigurePlot ("olsr-manet", "the number of bytes received versus time at Node 3",
+                                "Time (Seconds", "the number of bytes");
+      plotHelper.PlotProbe (probeType, tracePath, "OutputBytes", "Packet Byte Count",
+                            GnuplotAggregator::KEY_BELOW);
+
+      fileHelper.ConfigureFile("olsr-manet", FileAggregator::FORMATTED);
+      fileHelper.Set2dFormat ("Time (Seconds) = %.3e\tPacket Byte Count = %.0f");
+      fileHelper.WriteProbe (probeType,
+                             tracePath,
+                             "OutputBytes");
+    }
 
 
+  // Early stop once the goodput relayed by node 2 settles.  Node 2 arrives
+  // at 20 s and OLSR needs a few HELLO and TC rounds to route through it.
+  // Nodes 1 and 3 are out of range of each other, so without node 2 (before
+  // 20 s and after 35 s) the goodput is zero and cannot settle.
+  SteadyStateDetector detector;
+  if (steadyState > 0)
+    {
+      detector.AddSinkGoodput ("goodput n3", DynamicCast<PacketSink> (sinkApps.Get (0)));
+      detector.SetWarmup (Seconds (25.0));
+      detector.SetRelativeWidth (steadyState);
+      detector.Start ();
+    }
+
   NS_LOG_INFO ("Run Simulation.");
   Simulator::Stop (Seconds (60.0));
   Simulator::Run ();
+  if (binInterval > 0)
+    {
+      bins.Flush ();
+    }
+  if (steadyState > 0)
+    {
+      detector.Report (std::cerr);
+    }
 
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
@@ -0,0 +1,101 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <vector>
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * Fixed-capacity pool of equally sized payload packets.
+ *
+ * Packets are handed out round-robin from a ring of slots.  A slot is
+ * recycled when the pool holds the last reference to its packet and the
+ * packet still has its original size, i.e. the stack is done with it and
+ * did not fragment or coalesce it in place.  Otherwise the slot is refilled
+ * with a copy-on-write clone of a prototype packet, which shares the
+ * prototype's zero-filled buffer instead of allocating a new one.
+ *
+ * A recycled packet keeps its packet uid, so pcap/ascii traces show the
+ * same uid for every reuse of a slot.
+ */
+class PacketPool
+{
+public:
+  PacketPool ()
+    : m_packetSize (0),
+      m_next (0),
+      m_reused (0),
+      m_created (0)
+  {
+  }
+
+  /**
+   * \param packetSize payload size of every packet handed out
+   * \param capacity number of packets that may be outstanding before the
+   *        pool falls back to creating new ones
+   */
+  void
+  Setup (uint32_t packetSize, uint32_t capacity)
+  {
+    NS_ASSERT (capacity > 0);
+    m_packetSize = packetSize;
+    m_prototype = Create<Packet> (packetSize);
+    m_slots.assign (capacity, Ptr<Packet> ());
+    m_next = 0;
+  }
+
+  Ptr<Packet>
+  Get (void)
+  {
+    Ptr<Packet> &slot = m_slots[m_next];
+    if (++m_next == m_slots.size ())
+      {
+        m_next = 0;
+      }
+
+    if (slot && slot->GetReferenceCount () == 1 && slot->GetSize () == m_packetSize)
+      {
+        slot->RemoveAllPacketTags ();
+        slot->RemoveAllByteTags ();
+        ++m_reused;
+        return slot;
+      }
+
+    slot = m_prototype->Copy ();
+    ++m_created;
+    return slot;
+  }
+
+  uint32_t
+  GetPacketSize (void) const
+  {
+    return m_packetSize;
+  }
+
+  /// \return number of Get () calls served by recycling a slot
+  uint64_t
+  GetReused (void) const
+  {
+    return m_reused;
+  }
+
+  /// \return number of Get () calls that had to create a packet
+  uint64_t
+  GetCreated (void) const
+  {
+    return m_created;
+  }
+
+private:
+  uint32_t                 m_packetSize;
+  Ptr<Packet>              m_prototype;
+  std::vector<Ptr<Packet> > m_slots;
+  std::size_t              m_next;
+  uint64_t                 m_reused;
+  uint64_t                 m_created;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_POOL_H */
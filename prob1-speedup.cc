@@ -0,0 +1,309 @@
+// Speedup curve for the distributed mode of prob1_new.cc.
+//
+// ns-3 has no shared-memory multithreaded engine, so the partitions are
+// MPI ranks (one process each, normally on the same host) under the
+// conservative distributed or null-message scheduler, not threads.
+//
+// Runs prob1_new once per rank count under mpirun, one run at a time so
+// the timings do not disturb each other, and reports the wall-clock time
+// of each run relative to the first one.  A rank count of 1 runs the
+// scenario directly on the default sequential simulator, which is the
+// baseline the statistics of the distributed runs are compared with.
+//
+// Each rank writes its own flow table; they are merged by five-tuple,
+// tx counters from the senders' rank and rx counters from the sinks'
+// rank, into <run>/flow-stats-merged.tsv.  The stats column reports
+// whether every flow's tx and rx packets and bytes match the sequential
+// run.  Loss and delay are not compared: a rank cannot time a packet
+// another rank sent.
+//
+//   ./waf build
+//   ./waf --run "prob1-speedup --program=build/scratch/prob1_new --ranks=1,2
+//                --args=--bottleneckBandwidth=100Mbps"
+//
+// The six-node dumbbell has two natural partitions (cut at the bottleneck);
+// --partition maps nodes n1..n6 to ranks for finer cuts, which also cut
+// the 5ms access links and so shrink the lookahead.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("Prob1Speedup");
+
+static std::vector<std::string>
+SplitList (const std::string &list, char separator)
+{
+  std::vector<std::string> values;
+  std::stringstream ss (list);
+  std::string value;
+  while (std::getline (ss, value, separator))
+    {
+      if (!value.empty ())
+        {
+          values.push_back (value);
+        }
+    }
+  return values;
+}
+
+// Run argv to completion with stdout/stderr in logFile; return its exit status.
+static int
+RunLogged (const std::vector<std::string> &args, const std::string &logFile)
+{
+  std::cout.flush ();
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("fork failed: " << std::strerror (errno));
+    }
+  if (pid == 0)
+    {
+      int fd = open (logFile.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0)
+        {
+          dup2 (fd, STDOUT_FILENO);
+          dup2 (fd, STDERR_FILENO);
+          close (fd);
+        }
+      std::vector<char *> argv;
+      for (std::size_t i = 0; i < args.size (); ++i)
+        {
+          argv.push_back (const_cast<char *> (args[i].c_str ()));
+        }
+      argv.push_back (0);
+      execvp (argv[0], argv.data ());
+      std::cerr << "exec " << argv[0] << " failed: " << std::strerror (errno) << "\n";
+      _exit (127);
+    }
+  int status;
+  waitpid (pid, &status, 0);
+  return WIFEXITED (status) ? WEXITSTATUS (status) : 128 + WTERMSIG (status);
+}
+
+// The scenario prints "Wall clock: <ms> ms" from rank 0.
+static int64_t
+ReadWallClock (const std::string &logFile)
+{
+  std::ifstream in (logFile.c_str ());
+  std::string line;
+  while (std::getline (in, line))
+    {
+      if (line.compare (0, 11, "Wall clock:") == 0)
+        {
+          return std::atoll (line.c_str () + 11);
+        }
+    }
+  return -1;
+}
+
+struct FlowCounters
+{
+  uint64_t txPackets;
+  uint64_t txBytes;
+  uint64_t rxPackets;
+  uint64_t rxBytes;
+};
+
+// Flows by "source destination sourcePort destinationPort"
+typedef std::map<std::string, FlowCounters> FlowTable;
+
+// Add the rows of a prob1_new flow table to \p table; false if unreadable.
+static bool
+ReadFlowTable (const std::string &fileName, FlowTable &table)
+{
+  std::ifstream in (fileName.c_str ());
+  if (!in)
+    {
+      return false;
+    }
+  std::string line;
+  std::getline (in, line);        // header
+  while (std::getline (in, line))
+    {
+      std::istringstream row (line);
+      std::string flowId, source, destination, sourcePort, destinationPort;
+      FlowCounters c;
+      if (!(row >> flowId >> source >> destination >> sourcePort >> destinationPort
+                >> c.txPackets >> c.txBytes >> c.rxPackets >> c.rxBytes))
+        {
+          return false;
+        }
+      // At most one rank has non-zero tx and one non-zero rx counters
+      FlowCounters &merged = table[source + " " + destination + " " + sourcePort + " " + destinationPort];
+      merged.txPackets += c.txPackets;
+      merged.txBytes += c.txBytes;
+      merged.rxPackets += c.rxPackets;
+      merged.rxBytes += c.rxBytes;
+    }
+  return true;
+}
+
+static void
+WriteFlowTable (const std::string &fileName, const FlowTable &table)
+{
+  std::ofstream out (fileName.c_str ());
+  out << "source\tdestination\tsourcePort\tdestinationPort\ttxPackets\ttxBytes\trxPackets\trxBytes\n";
+  for (FlowTable::const_iterator i = table.begin (); i != table.end (); ++i)
+    {
+      std::string key = i->first;
+      std::replace (key.begin (), key.end (), ' ', '\t');
+      out << key << "\t" << i->second.txPackets << "\t" << i->second.txBytes
+          << "\t" << i->second.rxPackets << "\t" << i->second.rxBytes << "\n";
+    }
+}
+
+// Number of flows whose counters differ between the two tables
+static uint32_t
+CountMismatches (const FlowTable &a, const FlowTable &b)
+{
+  uint32_t mismatches = 0;
+  for (FlowTable::const_iterator i = a.begin (); i != a.end (); ++i)
+    {
+      FlowTable::const_iterator j = b.find (i->first);
+      if (j == b.end () || i->second.txPackets != j->second.txPackets || i->second.txBytes != j->second.txBytes
+          || i->second.rxPackets != j->second.rxPackets || i->second.rxBytes != j->second.rxBytes)
+        {
+          ++mismatches;
+        }
+    }
+  for (FlowTable::const_iterator j = b.begin (); j != b.end (); ++j)
+    {
+      if (a.find (j->first) == a.end ())
+        {
+          ++mismatches;
+        }
+    }
+  return mismatches;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string program = "";
+  std::string mpirun = "mpirun";
+  std::string ranks = "1,2";
+  std::string partition = "0,0,1,1,0,1";
+  std::string extraArgs = "";
+  std::string outputRoot = "prob1-speedup";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("program", "Path to the built prob1_new executable", program);
+  cmd.AddValue ("mpirun", "MPI launcher", mpirun);
+  cmd.AddValue ("ranks", "Comma-separated rank counts to time", ranks);
+  cmd.AddValue ("partition", "Rank of nodes n1..n6, passed to prob1_new", partition);
+  cmd.AddValue ("args", "Space-separated extra prob1_new arguments", extraArgs);
+  cmd.AddValue ("outputRoot", "Directory that receives one subdirectory per run", outputRoot);
+  cmd.Parse (argc, argv);
+
+  if (program.empty ())
+    {
+      NS_FATAL_ERROR ("--program=<path to prob1_new executable> is required");
+    }
+  mkdir (outputRoot.c_str (), 0755);
+
+  std::vector<std::string> rankList = SplitList (ranks, ',');
+  std::vector<std::string> extra = SplitList (extraArgs, ' ');
+  int64_t baseMs = -1;
+  bool haveBaseline = false;
+  FlowTable baseline;
+  std::cout << "ranks\twallMs\tspeedup\tstats\n";
+  for (std::size_t r = 0; r < rankList.size (); ++r)
+    {
+      std::string dir = outputRoot + "/ranks-" + rankList[r];
+      mkdir (dir.c_str (), 0755);
+      std::vector<std::string> args;
+      if (rankList[r] != "1")
+        {
+          args.push_back (mpirun);
+          args.push_back ("-np");
+          args.push_back (rankList[r]);
+        }
+      args.push_back (program);
+      if (rankList[r] != "1")
+        {
+          args.push_back ("--distributed=1");
+          args.push_back ("--partition=" + partition);
+        }
+      args.push_back ("--outputDir=" + dir);
+      args.push_back ("--flowStatsFile=" + dir + "/flow-stats.tsv");
+      args.insert (args.end (), extra.begin (), extra.end ());
+
+      std::string logFile = dir + "/run.log";
+      int status = RunLogged (args, logFile);
+      int64_t wallMs = ReadWallClock (logFile);
+      if (status != 0 || wallMs < 0)
+        {
+          std::cout << rankList[r] << "\tFAILED (see " << logFile << ")\n";
+          continue;
+        }
+      if (baseMs < 0)
+        {
+          baseMs = wallMs;
+        }
+
+      FlowTable table;
+      bool readable = true;
+      uint32_t nRanks = std::atoi (rankList[r].c_str ());
+      if (nRanks == 1)
+        {
+          readable = ReadFlowTable (dir + "/flow-stats.tsv", table);
+        }
+      for (uint32_t i = 0; i < nRanks && nRanks > 1; ++i)
+        {
+          std::ostringstream rankFile;
+          rankFile << dir << "/flow-stats.tsv.rank" << i;
+          readable = ReadFlowTable (rankFile.str (), table) && readable;
+        }
+      std::string verdict;
+      if (!readable)
+        {
+          verdict = "no flow table";
+        }
+      else if (nRanks == 1 && !haveBaseline)
+        {
+          baseline = table;
+          haveBaseline = true;
+          verdict = "baseline";
+        }
+      else if (!haveBaseline)
+        {
+          verdict = "no sequential run";
+        }
+      else
+        {
+          uint32_t mismatches = CountMismatches (baseline, table);
+          std::ostringstream v;
+          v << "match";
+          if (mismatches > 0)
+            {
+              v.str ("");
+              v << "MISMATCH (" << mismatches << " of " << baseline.size () << " flows)";
+            }
+          verdict = v.str ();
+        }
+      if (readable)
+        {
+          WriteFlowTable (dir + "/flow-stats-merged.tsv", table);
+        }
+      std::cout << rankList[r] << "\t" << wallMs << "\t" << std::fixed << std::setprecision (2)
+                << (wallMs > 0 ? double (baseMs) / wallMs : 0) << "\t" << verdict << "\n";
+    }
+  return 0;
+}
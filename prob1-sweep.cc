@@ -0,0 +1,262 @@
+// Parameter sweep driver for the prob1_new.cc pacing dumbbell.
+//
+// Every parameter takes a comma-separated list of values.  The driver
+// expands the cartesian product of all lists and runs one prob1_new
+// process per grid point, keeping up to --jobs of them running at once.
+// Each run gets its own directory under --outputRoot, so the
+// tcp-dynamic-pacing-*.dat files of concurrent runs do not collide, and
+// its stdout/stderr go to run.log in that directory.  When all runs are
+// done the per-flow FlowMonitor tables are merged into
+// <outputRoot>/sweep-results.tsv, one row per (run, flow).
+//
+//   ./waf build
+//   ./waf --run "prob1-sweep --program=build/scratch/prob1_new
+//                --isPacingEnabled=0,1 --useEcn=0,1
+//                --bottleneckBandwidth=10Mbps,20Mbps --bottleneckDelay=20ms,40ms"
+//
+// Running the driver through waf gives the workers the library path they
+// need; they inherit the driver's environment.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("Prob1Sweep");
+
+struct SweepParameter
+{
+  std::string name;
+  std::vector<std::string> values;
+};
+
+static std::vector<std::string>
+SplitList (const std::string &list)
+{
+  std::vector<std::string> values;
+  std::stringstream ss (list);
+  std::string value;
+  while (std::getline (ss, value, ','))
+    {
+      if (!value.empty ())
+        {
+          values.push_back (value);
+        }
+    }
+  return values;
+}
+
+// Fork and exec one worker with stdout/stderr redirected to its run.log.
+static pid_t
+StartWorker (const std::string &program, const std::vector<std::string> &args, const std::string &logFile)
+{
+  std::cout.flush ();
+  pid_t pid = fork ();
+  if (pid != 0)
+    {
+      return pid;
+    }
+
+  int fd = open (logFile.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0)
+    {
+      dup2 (fd, STDOUT_FILENO);
+      dup2 (fd, STDERR_FILENO);
+      close (fd);
+    }
+  std::vector<char *> argv;
+  argv.push_back (const_cast<char *> (program.c_str ()));
+  for (std::size_t i = 0; i < args.size (); ++i)
+    {
+      argv.push_back (const_cast<char *> (args[i].c_str ()));
+    }
+  argv.push_back (0);
+  execv (program.c_str (), argv.data ());
+  std::cerr << "exec " << program << " failed: " << std::strerror (errno) << "\n";
+  _exit (127);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string program = "";
+  std::string outputRoot = "prob1-sweep";
+  uint32_t jobs = std::thread::hardware_concurrency ();
+
+  // Defaults are the prob1_new.cc defaults, so a parameter that is not
+  // swept runs at its usual value.
+  std::string isPacingEnabled = "false";
+  std::string useEcn = "true";
+  std::string useQueueDisc = "true";
+  std::string shouldPaceInitialWindow = "false";
+  std::string maxPacingRate = "4Gbps";
+  std::string bottleneckBandwidth = "10Mbps";
+  std::string bottleneckDelay = "40ms";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("program", "Path to the built prob1_new executable", program);
+  cmd.AddValue ("outputRoot", "Directory that receives one subdirectory per run", outputRoot);
+  cmd.AddValue ("jobs", "Maximum number of concurrent worker processes", jobs);
+  cmd.AddValue ("isPacingEnabled", "Comma-separated values to sweep", isPacingEnabled);
+  cmd.AddValue ("useEcn", "Comma-separated values to sweep", useEcn);
+  cmd.AddValue ("useQueueDisc", "Comma-separated values to sweep", useQueueDisc);
+  cmd.AddValue ("shouldPaceInitialWindow", "Comma-separated values to sweep", shouldPaceInitialWindow);
+  cmd.AddValue ("maxPacingRate", "Comma-separated values to sweep", maxPacingRate);
+  cmd.AddValue ("bottleneckBandwidth", "Comma-separated values to sweep", bottleneckBandwidth);
+  cmd.AddValue ("bottleneckDelay", "Comma-separated values to sweep", bottleneckDelay);
+  cmd.Parse (argc, argv);
+
+  if (program.empty ())
+    {
+      NS_FATAL_ERROR ("--program=<path to prob1_new executable> is required");
+    }
+  if (jobs == 0)
+    {
+      jobs = 1;
+    }
+
+  std::vector<SweepParameter> grid;
+  const char *names[] = { "isPacingEnabled", "useEcn", "useQueueDisc", "shouldPaceInitialWindow",
+                          "maxPacingRate", "bottleneckBandwidth", "bottleneckDelay" };
+  const std::string *lists[] = { &isPacingEnabled, &useEcn, &useQueueDisc, &shouldPaceInitialWindow,
+                                 &maxPacingRate, &bottleneckBandwidth, &bottleneckDelay };
+  uint32_t nRuns = 1;
+  for (std::size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+    {
+      SweepParameter p;
+      p.name = names[i];
+      p.values = SplitList (*lists[i]);
+      if (p.values.empty ())
+        {
+          NS_FATAL_ERROR ("No values given for " << p.name);
+        }
+      nRuns *= p.values.size ();
+      grid.push_back (p);
+    }
+
+  mkdir (outputRoot.c_str (), 0755);
+
+  // Expand the grid: run r uses value (r / stride) % size of each parameter.
+  std::vector<std::vector<std::string> > runValues (nRuns);
+  std::vector<std::string> runDirs (nRuns);
+  for (uint32_t r = 0; r < nRuns; ++r)
+    {
+      uint32_t stride = 1;
+      for (std::size_t i = grid.size (); i-- > 0; )
+        {
+          runValues[r].push_back (grid[i].values[(r / stride) % grid[i].values.size ()]);
+          stride *= grid[i].values.size ();
+        }
+      std::reverse (runValues[r].begin (), runValues[r].end ());
+      std::ostringstream dir;
+      dir << outputRoot << "/run-" << std::setw (4) << std::setfill ('0') << r;
+      runDirs[r] = dir.str ();
+    }
+
+  std::cout << "Running " << nRuns << " configurations with " << jobs << " workers\n";
+  std::map<pid_t, uint32_t> running;
+  std::vector<int> exitStatus (nRuns, -1);
+  uint32_t next = 0;
+  while (next < nRuns || !running.empty ())
+    {
+      while (next < nRuns && running.size () < jobs)
+        {
+          mkdir (runDirs[next].c_str (), 0755);
+          std::vector<std::string> args;
+          for (std::size_t i = 0; i < grid.size (); ++i)
+            {
+              args.push_back ("--" + grid[i].name + "=" + runValues[next][i]);
+            }
+          args.push_back ("--outputDir=" + runDirs[next]);
+          args.push_back ("--flowStatsFile=" + runDirs[next] + "/flow-stats.tsv");
+          pid_t pid = StartWorker (program, args, runDirs[next] + "/run.log");
+          if (pid < 0)
+            {
+              NS_FATAL_ERROR ("fork failed: " << std::strerror (errno));
+            }
+          running[pid] = next++;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          break;
+        }
+      std::map<pid_t, uint32_t>::iterator it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+      uint32_t r = it->second;
+      running.erase (it);
+      exitStatus[r] = WIFEXITED (status) ? WEXITSTATUS (status) : 128 + WTERMSIG (status);
+      std::cout << runDirs[r] << (exitStatus[r] == 0 ? " done" : " FAILED") << "\n";
+    }
+
+  // Merge the per-run flow tables, prefixed by the run's parameter values.
+  std::string resultsFile = outputRoot + "/sweep-results.tsv";
+  std::ofstream results (resultsFile.c_str (), std::ios::out);
+  results << "run";
+  for (std::size_t i = 0; i < grid.size (); ++i)
+    {
+      results << "\t" << grid[i].name;
+    }
+  bool haveHeader = false;
+  uint32_t failed = 0;
+  for (uint32_t r = 0; r < nRuns; ++r)
+    {
+      std::string flowFile = runDirs[r] + "/flow-stats.tsv";
+      std::ifstream in (flowFile.c_str ());
+      if (exitStatus[r] != 0 || !in)
+        {
+          ++failed;
+          continue;
+        }
+      std::string line;
+      std::getline (in, line);
+      if (!haveHeader)
+        {
+          results << "\t" << line << "\n";
+          haveHeader = true;
+        }
+      while (std::getline (in, line))
+        {
+          results << r;
+          for (std::size_t i = 0; i < grid.size (); ++i)
+            {
+              results << "\t" << runValues[r][i];
+            }
+          results << "\t" << line << "\n";
+        }
+    }
+  if (!haveHeader)
+    {
+      results << "\n";
+    }
+  results.close ();
+
+  std::cout << "Merged results of " << nRuns - failed << " runs into " << resultsFile << "\n";
+  if (failed > 0)
+    {
+      std::cout << failed << " runs failed; see run.log in their directories\n";
+      return 1;
+    }
+  return 0;
+}
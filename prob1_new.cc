@@ -1,6 +1,9 @@
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <fstream>
 #include "ns3/core-module.h"
 #include "ns3/point-to-point-module.h"
@@ -11,6 +14,22 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+#include "binary-trace-sink.h"
+#include "topology-builder.h"
+#include "compressed-pcap.h"
+#include "trace-attach.h"
+#include "tcp-socket-hook.h"
+#include "simulator-profiler.h"
+#include "memory-accounting.h"
+#include "steady-state-detector.h"
+#include "replication-engine.h"
+#include "queue-telemetry.h"
+#include "ipv4-interface-counters.h"
+#include "simulation-checkpoint.h"
 
 using namespace ns3;
 
@@ -22,50 +41,242 @@ std::ofstream pacingRateStream;
 std::ofstream ssThreshStream;
 std::ofstream packetTraceStream;
 
+// With --binaryTrace the tracers append records to traceSink instead of
+// formatting text; binary-trace-convert recreates the .dat files.
+bool binaryTrace = false;
+BinaryTraceSink traceSink;
+
+// False when --packetCounterInterval replaces the per-packet IP trace
+bool packetTrace = true;
+
+// Per-flow cwnd, ssthresh, RTT and pacing rate of every sender socket
+TcpFlowTracer flowTracer;
+bool n1Traced = false;
+bool n2Traced = false;
+
+// Packets and bytes delivered per flow where they arrive.  FlowMonitor
+// ignores the arrival of a packet it did not see leave, so in a
+// distributed run each rank's flow table takes its rx columns from here.
+struct DeliveredCount
+{
+  uint64_t packets;
+  uint64_t bytes;
+};
+std::map<Ipv4FlowClassifier::FiveTuple, DeliveredCount> delivered;
+
+enum TraceStreamId
+{
+  CWND_STREAM,
+  CWND2_STREAM,
+  PACING_RATE_STREAM,
+  SSTHRESH_STREAM,
+  PACKET_TRACE_STREAM
+};
+
 static void
 CwndTracer (uint32_t oldval, uint32_t newval)
 {
-  cwndStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), CWND_STREAM, 0, newval);
+      return;
+    }
+  cwndStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << "\n";
 }
 static void
 CwndTracer2 (uint32_t oldval, uint32_t newval)
 {
-  cwndStream2 << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), CWND2_STREAM, 0, newval);
+      return;
+    }
+  cwndStream2 << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << "\n";
 }
 
 static void
 PacingRateTracer (DataRate oldval, DataRate newval)
 {
-  pacingRateStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval.GetBitRate () / 1e6 << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), PACING_RATE_STREAM, 0, newval.GetBitRate () / 1e6);
+      return;
+    }
+  pacingRateStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval.GetBitRate () / 1e6 << "\n";
 }
 
 static void
 SsThreshTracer (uint32_t oldval, uint32_t newval)
 {
-  ssThreshStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), SSTHRESH_STREAM, 0, newval);
+      return;
+    }
+  ssThreshStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << "\n";
 }
 
 static void
 TxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " tx " << p->GetSize () << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), PACKET_TRACE_STREAM, BinaryTraceSink::KIND_TX, p->GetSize ());
+      return;
+    }
+  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " tx " << p->GetSize () << "\n";
 }
 
 static void
 RxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " rx " << p->GetSize () << std::endl;
+  if (binaryTrace)
+    {
+      traceSink.Append (Simulator::Now ().GetNanoSeconds (), PACKET_TRACE_STREAM, BinaryTraceSink::KIND_RX, p->GetSize ());
+      return;
+    }
+  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " rx " << p->GetSize () << "\n";
+}
+
+// The per-metric text traces, named <filePrefix>-cwnd.dat and so on
+static void
+OpenTraces (std::string filePrefix)
+{
+  cwndStream.close ();
+  cwndStream.open (filePrefix + "-cwnd.dat", std::ios::out);
+  cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
+  cwndStream2.close ();
+  cwndStream2.open (filePrefix + "-cwnd2.dat", std::ios::out);
+  cwndStream2 << "#Time(s) Congestion Window (B)" << std::endl;
+
+  pacingRateStream.close ();
+  pacingRateStream.open (filePrefix + "-pacing-rate.dat", std::ios::out);
+  pacingRateStream << "#Time(s) Pacing Rate (Mb/s)" << std::endl;
+
+  ssThreshStream.close ();
+  ssThreshStream.open (filePrefix + "-ssthresh.dat", std::ios::out);
+  ssThreshStream << "#Time(s) Slow Start threshold (B)" << std::endl;
+
+  if (packetTrace)
+    {
+      packetTraceStream.close ();
+      packetTraceStream.open (filePrefix + "-packet-trace.dat", std::ios::out);
+      packetTraceStream << "#Time(s) tx/rx size (B)" << std::endl;
+    }
+}
+
+// Runs just before the checkpoint, so that no branch inherits buffered lines
+static void
+FlushTraces (void)
+{
+  cwndStream.flush ();
+  cwndStream2.flush ();
+  pacingRateStream.flush ();
+  ssThreshStream.flush ();
+  packetTraceStream.flush ();
+  flowTracer.Flush ();
 }
 
-void
-ConnectSocketTraces (void)
+// Branch of the checkpoint at 15 s: n2's flow to n4 starts with this TCP
+// variant.  n2's flow to n3 has run since 0 s and keeps the default one.
+// The files opened before keep the warm-up; the branch's traces continue
+// in files of its own.
+static void
+StartBranch (Ptr<Node> n2, TypeId tcp, std::string filePrefix)
 {
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", MakeCallback (&CwndTracer));
-  Config::ConnectWithoutContext ("/NodeList/1/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", MakeCallback (&CwndTracer2));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/PacingRate", MakeCallback (&PacingRateTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/SlowStartThreshold", MakeCallback (&SsThreshTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::Ipv4L3Protocol/Tx", MakeCallback (&TxTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::Ipv4L3Protocol/Rx", MakeCallback (&RxTracer));
+  n2->GetObject<TcpL4Protocol> ()->SetAttribute ("SocketType", TypeIdValue (tcp));
+  OpenTraces (filePrefix);
+  flowTracer.Close ();
+  flowTracer.Open (filePrefix + "-flows.dat");
+}
+
+// In a distributed run every rank builds the whole topology but only
+// runs the applications, monitors and tracers of the nodes it owns.
+static bool
+IsLocal (Ptr<Node> node)
+{
+#ifdef NS3_MPI
+  return node->GetSystemId () == MpiInterface::GetSystemId ();
+#else
+  return true;
+#endif
+}
+
+static std::vector<uint32_t>
+ParsePartition (const std::string &list)
+{
+  std::vector<uint32_t> ids;
+  std::stringstream ss (list);
+  std::string id;
+  while (std::getline (ss, id, ','))
+    {
+      ids.push_back (std::atoi (id.c_str ()));
+    }
+  return ids;
+}
+
+static void
+CountDelivered (const Ipv4Header &header, Ptr<const Packet> payload, uint32_t interface)
+{
+  // TCP and UDP both start with the source and destination ports
+  uint8_t ports[4] = { 0, 0, 0, 0 };
+  payload->CopyData (ports, 4);
+  Ipv4FlowClassifier::FiveTuple t;
+  t.sourceAddress = header.GetSource ();
+  t.destinationAddress = header.GetDestination ();
+  t.protocol = header.GetProtocol ();
+  t.sourcePort = (ports[0] << 8) | ports[1];
+  t.destinationPort = (ports[2] << 8) | ports[3];
+  DeliveredCount &c = delivered[t];
+  ++c.packets;
+  c.bytes += payload->GetSize () + header.GetSerializedSize ();   // as FlowMonitor counts them
+}
+
+// Called by the socket hook for every TCP socket of n1 and n2 as soon as
+// it is created.  The first socket of each node also feeds the original
+// per-metric files.
+static void
+NewSocketTracer (uint32_t flowId, Ptr<TcpSocketBase> socket)
+{
+  flowTracer.Attach (flowId, socket);
+  uint32_t node = socket->GetNode ()->GetId ();
+  if (node == 0 && !n1Traced)
+    {
+      socket->TraceConnectWithoutContext ("CongestionWindow", MakeCallback (&CwndTracer));
+      socket->TraceConnectWithoutContext ("PacingRate", MakeCallback (&PacingRateTracer));
+      socket->TraceConnectWithoutContext ("SlowStartThreshold", MakeCallback (&SsThreshTracer));
+      n1Traced = true;
+    }
+  else if (node == 1 && !n2Traced)
+    {
+      socket->TraceConnectWithoutContext ("CongestionWindow", MakeCallback (&CwndTracer2));
+      n2Traced = true;
+    }
+}
+
+// Queueing delay at the bottleneck in ms: the queue disc backlog plus the
+// device queue, drained at the link rate.
+static double
+BottleneckQueueDelay (Ptr<NetDevice> dev, DataRate rate)
+{
+  uint32_t bytes = DynamicCast<PointToPointNetDevice> (dev)->GetQueue ()->GetNBytes ();
+  Ptr<QueueDisc> qdisc = dev->GetNode ()->GetObject<TrafficControlLayer> ()->GetRootQueueDiscOnDevice (dev);
+  if (qdisc)
+    {
+      bytes += qdisc->GetNBytes ();
+    }
+  return bytes * 8000.0 / rate.GetBitRate ();
+}
+
+// Prepares a --replications worker: the start jitter and the stacks'
+// random variables were seeded with the parent's run.
+static void
+ReseedReplication (Ptr<UniformRandomVariable> uniformRv, ApplicationContainer sourceApps13, NodeContainer nodes, uint32_t run)
+{
+  uniformRv->SetStream (0);
+  sourceApps13.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
+  InternetStackHelper stack;
+  stack.AssignStreams (nodes, 1);
 }
 
 int
@@ -78,7 +289,6 @@ main (int argc, char *argv[])
   Time simulationEndTime = Seconds (30);
   DataRate bottleneckBandwidth ("10Mbps");
   Time bottleneckDelay = MilliSeconds (40);
-  DataRate regLinkBandwidth = DataRate (4 * bottleneckBandwidth.GetBitRate ());
   Time regLinkDelay = MilliSeconds (5);
   DataRate maxPacingRate ("4Gbps");
 
@@ -86,6 +296,27 @@ main (int argc, char *argv[])
   bool useEcn = true;
   bool useQueueDisc = true;
   bool shouldPaceInitialWindow = false;
+  std::string outputDir = "";
+  std::string flowStatsFile = "";
+  bool distributed = false;
+  bool nullMessage = false;
+  std::string partition = "0,0,1,1,0,1";
+  bool compressedPcap = false;
+  uint32_t snapLen = 96;
+  std::string pcapCompressor = "gzip";
+  uint32_t pcapRotateMB = 0;
+  bool profile = false;
+  std::string profileFlameGraph = "";
+  Time memoryInterval = Seconds (0);
+  double steadyState = 0;
+  uint32_t replications = 0;
+  uint32_t replicationParallel = 0;
+  Time queueInterval = Seconds (0);
+  bool queueFlows = false;
+  Time packetCounterInterval = Seconds (0);
+  uint32_t packetSample = 0;
+  std::string branchTcp = "";
+  uint32_t branchParallel = 1;
 
   // Configure defaults that are not based on explicit command-line arguments
   // They may be overridden by general attribute configuration of command line
@@ -100,7 +331,93 @@ main (int argc, char *argv[])
   cmd.AddValue ("useEcn", "Flag to enable/disable ECN", useEcn);
   cmd.AddValue ("useQueueDisc", "Flag to enable/disable queue disc on bottleneck", useQueueDisc);
   cmd.AddValue ("shouldPaceInitialWindow", "Flag to enable/disable pacing of TCP initial window", shouldPaceInitialWindow);
+  cmd.AddValue ("bottleneckBandwidth", "Bottleneck link data rate", bottleneckBandwidth);
+  cmd.AddValue ("bottleneckDelay", "Bottleneck link delay", bottleneckDelay);
+  cmd.AddValue ("outputDir", "Directory for trace and pcap output (must exist)", outputDir);
+  cmd.AddValue ("flowStatsFile", "If set, write per-flow FlowMonitor results as a tab-separated table", flowStatsFile);
+  cmd.AddValue ("binaryTrace", "Write tracer output to tcp-dynamic-pacing.btrc instead of .dat files", binaryTrace);
+  cmd.AddValue ("distributed", "Run partitioned over MPI ranks (start with mpirun)", distributed);
+  cmd.AddValue ("nullMessage", "Use the null message instead of the granted-time-window distributed scheduler", nullMessage);
+  cmd.AddValue ("compressedPcap", "Write truncated, compressed pcap files from a background thread", compressedPcap);
+  cmd.AddValue ("snapLen", "Bytes kept per frame with --compressedPcap (0 for whole frames)", snapLen);
+  cmd.AddValue ("pcapCompressor", "Compressor for --compressedPcap: gzip, bzip2, xz, zstd or none", pcapCompressor);
+  cmd.AddValue ("pcapRotateMB", "Start a new --compressedPcap file every this many MB (0 to disable)", pcapRotateMB);
+  cmd.AddValue ("partition", "Rank of nodes n1,n2,n3,n4,n5,n6 when distributed (default cuts the bottleneck)", partition);
+  cmd.AddValue ("profile", "Report wall time per event type at the end of the run", profile);
+  cmd.AddValue ("profileFlameGraph", "With --profile, also write folded flame graph stacks to this file", profileFlameGraph);
+  cmd.AddValue ("memoryInterval", "Sample queue, socket and in-flight memory use this often (0 to disable)", memoryInterval);
+  cmd.AddValue ("simulationEndTime", "Simulated time to run, an upper bound with --steadyState", simulationEndTime);
+  cmd.AddValue ("steadyState", "Stop once goodput and queue delay are known to this relative precision (0 to run to the end)", steadyState);
+  cmd.AddValue ("replications", "Build once, then run this many replications with consecutive RngRun values", replications);
+  cmd.AddValue ("replicationParallel", "Replications run at the same time (0 for one per core)", replicationParallel);
+  cmd.AddValue ("queueInterval", "Write bottleneck queue counters and sojourn times this often (0 to disable)", queueInterval);
+  cmd.AddValue ("queueFlows", "With --queueInterval, also break FqCoDel down by flow queue", queueFlows);
+  cmd.AddValue ("packetCounterInterval", "Replace the per-packet IP trace with per-interface counters written this often (0 to disable)", packetCounterInterval);
+  cmd.AddValue ("packetSample", "With --packetCounterInterval, also log one IP packet in this many (0 to disable)", packetSample);
+  cmd.AddValue ("branchTcp", "Comma-separated TCP variants for n2's flow to n4, which starts at 15 s (e.g. TcpNewReno,TcpCubic); each one is a branch of a single warm-up.  No left-side pcap is written", branchTcp);
+  cmd.AddValue ("branchParallel", "Branches run at the same time with --branchTcp", branchParallel);
   cmd.Parse (argc, argv);
+  packetTrace = !packetCounterInterval.IsStrictlyPositive ();
+
+  if (profile)
+    {
+      NS_ABORT_MSG_IF (distributed, "--profile cannot wrap the distributed simulator");
+      SimulatorProfiler::Enable (profileFlameGraph);
+    }
+  NS_ABORT_MSG_IF (steadyState > 0 && distributed, "--steadyState cannot stop all ranks at once");
+  // The replications would share every trace file opened during setup
+  NS_ABORT_MSG_IF (replications > 0 && (distributed || tracing || binaryTrace || compressedPcap || memoryInterval.IsStrictlyPositive ()
+                                       || queueInterval.IsStrictlyPositive () || packetCounterInterval.IsStrictlyPositive ()),
+                   "--replications cannot be combined with --distributed or per-run traces");
+  // A branch is a fork of this process, and fork copies only the calling
+  // thread: the writer threads of these two would be missing in every branch
+  NS_ABORT_MSG_IF (!branchTcp.empty () && (binaryTrace || compressedPcap),
+                   "--branchTcp cannot be used with --binaryTrace or --compressedPcap");
+  NS_ABORT_MSG_IF (!branchTcp.empty () && (distributed || replications > 0),
+                   "--branchTcp cannot be used with --distributed or --replications");
+  // The branches would all append to the files these open before the checkpoint
+  NS_ABORT_MSG_IF (!branchTcp.empty () && (tracing || memoryInterval.IsStrictlyPositive ()
+                                          || queueInterval.IsStrictlyPositive () || packetCounterInterval.IsStrictlyPositive ()),
+                   "--branchTcp cannot be used with --tracing or the interval traces");
+
+  uint32_t nRanks = 1;
+  uint32_t rank = 0;
+  if (distributed)
+    {
+#ifdef NS3_MPI
+      // Conservative synchronization: the lookahead is the smallest delay
+      // of the links cut by the partition, 40ms for the bottleneck.
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue (nullMessage ? "ns3::NullMessageSimulatorImpl"
+                                                  : "ns3::DistributedSimulatorImpl"));
+      MpiInterface::Enable (&argc, &argv);
+      nRanks = MpiInterface::GetSize ();
+      rank = MpiInterface::GetSystemId ();
+#else
+      NS_FATAL_ERROR ("--distributed needs ns-3 built with --enable-mpi");
+#endif
+    }
+  std::vector<uint32_t> systemIds = ParsePartition (partition);
+  if (systemIds.size () != 6)
+    {
+      NS_FATAL_ERROR ("--partition needs six ranks, one per node");
+    }
+  for (std::size_t i = 0; i < systemIds.size (); ++i)
+    {
+      if (systemIds[i] >= nRanks)
+        {
+          systemIds[i] = 0;
+        }
+    }
+
+  DataRate regLinkBandwidth = DataRate (4 * bottleneckBandwidth.GetBitRate ());
+  std::string prefix = outputDir.empty () ? "" : outputDir + "/";
+  if (nRanks > 1)
+    {
+      std::ostringstream rankPrefix;
+      rankPrefix << prefix << "rank" << rank << "-";
+      prefix = rankPrefix.str ();
+    }
 
   // Configure defaults based on command-line arguments
   Config::SetDefault ("ns3::TcpSocketState::EnablePacing", BooleanValue (isPacingEnabled));
@@ -108,71 +425,53 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::TcpSocketBase::UseEcn", (useEcn ? EnumValue (TcpSocketState::On) : EnumValue (TcpSocketState::Off)));
   Config::SetDefault ("ns3::TcpSocketState::MaxPacingRate", DataRateValue (maxPacingRate));
 
-  NS_LOG_INFO ("Create nodes.");
-  NodeContainer nodes;
-  nodes.Create (6);
-
-  NS_LOG_INFO ("Create channels.");
-  NodeContainer n1n5 = NodeContainer (nodes.Get (0), nodes.Get (2));
-  NodeContainer n2n5 = NodeContainer (nodes.Get (1), nodes.Get (2));
-
-  NodeContainer n5n6 = NodeContainer (nodes.Get (2), nodes.Get (3));
-
-  NodeContainer n6n3 = NodeContainer (nodes.Get (3), nodes.Get (4));
-  NodeContainer n6n4 = NodeContainer (nodes.Get (3), nodes.Get (5));
-
   //Define Node link properties
   PointToPointHelper leftAccessLink;
   leftAccessLink.SetDeviceAttribute ("DataRate", DataRateValue (regLinkBandwidth));
   leftAccessLink.SetChannelAttribute ("Delay", TimeValue (regLinkDelay));
   leftAccessLink.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("100p"));
-  NetDeviceContainer d1d5 = leftAccessLink.Install (n1n5);
-  NetDeviceContainer d2d5 = leftAccessLink.Install (n2n5);
 
   PointToPointHelper rightAccessLink;
   rightAccessLink.SetDeviceAttribute ("DataRate", DataRateValue (regLinkBandwidth));
   rightAccessLink.SetChannelAttribute ("Delay", TimeValue (regLinkDelay));
 
-  NetDeviceContainer d6d3 = rightAccessLink.Install (n6n3);
-  NetDeviceContainer d6d4 = rightAccessLink.Install (n6n4);
-
   PointToPointHelper bottleNeckLink;
   bottleNeckLink.SetDeviceAttribute ("DataRate", DataRateValue (bottleneckBandwidth));
   bottleNeckLink.SetChannelAttribute ("Delay", TimeValue (bottleneckDelay));
   bottleNeckLink.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("50p"));
 
-  NetDeviceContainer d5d6 = bottleNeckLink.Install (n5n6);
+  // As the scenario was first built by hand: senders n1, n2 are nodes 0
+  // and 1, routers n5, n6 nodes 2 and 3 and sinks n3, n4 nodes 4 and 5,
+  // with the same devices and addresses.
+  NS_LOG_INFO ("Create nodes and channels.");
+  TopologyBuilder topo;
+  topo.SetLayout (TopologyBuilder::LAYOUT_RECEIVERS_LAST);
+  if (nRanks > 1)
+    {
+      // --partition lists n1 to n6, the builder wants node id order
+      uint32_t byNodeId[] = { systemIds[0], systemIds[1], systemIds[4], systemIds[5], systemIds[2], systemIds[3] };
+      topo.SetSystemIds (std::vector<uint32_t> (byNodeId, byNodeId + 6));
+    }
+  topo.BuildDumbbell (2, 2, leftAccessLink, bottleNeckLink, rightAccessLink);
+  NodeContainer nodes = topo.GetAll ();
+  NodeContainer sinks = topo.GetRight ();
 
   //Install Internet stack
   InternetStackHelper stack;
-  stack.Install (nodes);
+  topo.InstallStack (stack);
 
   // Install traffic control
   if (useQueueDisc)
     {
       TrafficControlHelper tchQ;
       tchQ.SetRootQueueDisc ("ns3::FqCoDelQueueDisc");
-      tchQ.Install (d1d5);
-      tchQ.Install (d2d5);
-      tchQ.Install (d5d6);
+      tchQ.Install (topo.GetLeftDevices (0));
+      tchQ.Install (topo.GetLeftDevices (1));
+      tchQ.Install (topo.GetCoreDevices (0));
     }
 
   NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface0 = ipv4.Assign (d1d5);
-
-  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface1 = ipv4.Assign (d2d5);
-
-  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer bottleneckInterface = ipv4.Assign (d5d6);
-
-  ipv4.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface4 = ipv4.Assign (d6d3);
-
-  ipv4.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface5 = ipv4.Assign (d6d4);
+  topo.AssignIpv4Addresses (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"));
 
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
@@ -180,11 +479,19 @@ main (int argc, char *argv[])
 
   // Two Sink Applications at n4 and n5
   uint16_t sinkPort = 8080;
-  Address sinkAddress3 (InetSocketAddress (regLinkInterface4.GetAddress (1), sinkPort)); // interface of n3
-  Address sinkAddress4 (InetSocketAddress (regLinkInterface5.GetAddress (1), sinkPort)); // interface of n4
+  Address sinkAddress3 (InetSocketAddress (topo.GetRightAddress (0), sinkPort)); // interface of n3
+  Address sinkAddress4 (InetSocketAddress (topo.GetRightAddress (1), sinkPort)); // interface of n4
   PacketSinkHelper packetSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
-  ApplicationContainer sinkApps3 = packetSinkHelper.Install (nodes.Get (4)); //n3 as sink
-  ApplicationContainer sinkApps4 = packetSinkHelper.Install (nodes.Get (5)); //n4 as sink
+  ApplicationContainer sinkApps3;
+  ApplicationContainer sinkApps4;
+  if (IsLocal (sinks.Get (0)))
+    {
+      sinkApps3 = packetSinkHelper.Install (sinks.Get (0)); //n3 as sink
+    }
+  if (IsLocal (sinks.Get (1)))
+    {
+      sinkApps4 = packetSinkHelper.Install (sinks.Get (1)); //n4 as sink
+    }
 
   sinkApps3.Start (Seconds (0));
   sinkApps3.Stop (simulationEndTime);
@@ -195,58 +502,255 @@ main (int argc, char *argv[])
   Ptr<UniformRandomVariable> uniformRv = CreateObject<UniformRandomVariable> ();
   uniformRv->SetStream (0);
 
-  // Two Source Applications at n1 and n2
-  BulkSendHelper source13 ("ns3::TcpSocketFactory", sinkAddress3);
-  BulkSendHelper source23 ("ns3::TcpSocketFactory", sinkAddress3);
-  BulkSendHelper source24 ("ns3::TcpSocketFactory", sinkAddress4);
+  // The tracers follow the sockets of n1, so only its rank writes them
+  bool traceLocal = IsLocal (nodes.Get (0)) && replications == 0;
+
+  // Two Source Applications at n1 and n2.  When traced, their sockets come
+  // from the factory the socket hook installs below.
+  std::string senderFactory = traceLocal ? "ns3::HookedTcpSocketFactory" : "ns3::TcpSocketFactory";
+  BulkSendHelper source13 (senderFactory, sinkAddress3);
+  BulkSendHelper source23 (senderFactory, sinkAddress3);
+  BulkSendHelper source24 (senderFactory, sinkAddress4);
   // Set the amount of data to send in bytes.  Zero is unlimited.
   source13.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
   source23.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
   source24.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
-  ApplicationContainer sourceApps13 = source13.Install (nodes.Get (0));
-  ApplicationContainer sourceApps23 = source23.Install (nodes.Get (1));
-  ApplicationContainer sourceApps24 = source24.Install (nodes.Get (1));
+  ApplicationContainer sourceApps13;
+  ApplicationContainer sourceApps23;
+  ApplicationContainer sourceApps24;
+  if (IsLocal (nodes.Get (0)))
+    {
+      sourceApps13 = source13.Install (nodes.Get (0));
+    }
+  if (IsLocal (nodes.Get (1)))
+    {
+      sourceApps23 = source23.Install (nodes.Get (1));
+      sourceApps24 = source24.Install (nodes.Get (1));
+    }
 
   sourceApps13.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
   sourceApps13.Stop (simulationEndTime);
+  // sourceApps23 is given no start or stop time, so n2's flow to n3 runs
+  // from 0 s to the end alongside n1's; only the flow to n4 starts at 15 s.
   sourceApps24.Start (Seconds (15));
   sourceApps24.Stop (simulationEndTime);
   sourceApps24.Start (Seconds (15));
   sourceApps24.Stop (simulationEndTime);
 
+  CompressedPcap pcap;
+  if (compressedPcap)
+    {
+      pcap.SetSnapLen (snapLen);
+      pcap.SetCompressor (pcapCompressor);
+      pcap.SetMaxFileBytes (uint64_t (pcapRotateMB) << 20);
+    }
+
   if (tracing)
     {
       AsciiTraceHelper ascii;
-      leftAccessLink.EnableAsciiAll (ascii.CreateFileStream ("tcp-dynamic-pacing.tr"));
-      leftAccessLink.EnablePcapAll ("tcp-dynamic-pacing", false);
+      leftAccessLink.EnableAsciiAll (ascii.CreateFileStream (prefix + "tcp-dynamic-pacing.tr"));
+      if (compressedPcap)
+        {
+          for (uint32_t l = 0; l < topo.GetNLinks (); ++l)
+            {
+              pcap.EnablePointToPoint (prefix + "tcp-dynamic-pacing", topo.GetLinkDevices (l));
+            }
+        }
+      else
+        {
+          leftAccessLink.EnablePcapAll (prefix + "tcp-dynamic-pacing", false);
+        }
     }
 
-  cwndStream.open ("tcp-dynamic-pacing-cwnd.dat", std::ios::out);
-  cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
-  cwndStream2.open ("tcp-dynamic-pacing-cwnd2.dat", std::ios::out);
-  cwndStream2 << "#Time(s) Congestion Window (B)" << std::endl;
+  if (traceLocal && binaryTrace)
+    {
+      traceSink.AddStream (CWND_STREAM, prefix + "tcp-dynamic-pacing-cwnd.dat", "#Time(s) Congestion Window (B)", BinaryTraceSink::FORMAT_INTEGER);
+      traceSink.AddStream (CWND2_STREAM, prefix + "tcp-dynamic-pacing-cwnd2.dat", "#Time(s) Congestion Window (B)", BinaryTraceSink::FORMAT_INTEGER);
+      traceSink.AddStream (PACING_RATE_STREAM, prefix + "tcp-dynamic-pacing-pacing-rate.dat", "#Time(s) Pacing Rate (Mb/s)", BinaryTraceSink::FORMAT_REAL);
+      traceSink.AddStream (SSTHRESH_STREAM, prefix + "tcp-dynamic-pacing-ssthresh.dat", "#Time(s) Slow Start threshold (B)", BinaryTraceSink::FORMAT_INTEGER);
+      if (packetTrace)
+        {
+          traceSink.AddStream (PACKET_TRACE_STREAM, prefix + "tcp-dynamic-pacing-packet-trace.dat", "#Time(s) tx/rx size (B)", BinaryTraceSink::FORMAT_PACKET);
+        }
+      if (!traceSink.Open (prefix + "tcp-dynamic-pacing.btrc"))
+        {
+          NS_FATAL_ERROR ("Cannot open " << prefix << "tcp-dynamic-pacing.btrc");
+        }
+    }
+  else if (traceLocal)
+    {
+      OpenTraces (prefix + "tcp-dynamic-pacing");
+    }
 
+  TcpSocketHook socketHook;
+  if (traceLocal)
+    {
+      flowTracer.Open (prefix + "tcp-dynamic-pacing-flows.dat");
+      NodeContainer senders;
+      for (uint32_t i = 0; i < 2; ++i)
+        {
+          if (IsLocal (nodes.Get (i)))
+            {
+              senders.Add (nodes.Get (i));
+            }
+        }
+      socketHook.SetNewSocketCallback (MakeCallback (&NewSocketTracer));
+      socketHook.Install (senders);
+      if (packetTrace)
+        {
+          TraceAttach::Aggregated<Ipv4L3Protocol> (nodes.Get (0), "Tx", MakeCallback (&TxTracer));
+          TraceAttach::Aggregated<Ipv4L3Protocol> (nodes.Get (0), "Rx", MakeCallback (&RxTracer));
+        }
+    }
 
-  pacingRateStream.open ("tcp-dynamic-pacing-pacing-rate.dat", std::ios::out);
-  pacingRateStream << "#Time(s) Pacing Rate (Mb/s)" << std::endl;
+  NodeContainer localNodes;
+  for (uint32_t i = 0; i < nodes.GetN (); ++i)
+    {
+      if (IsLocal (nodes.Get (i)))
+        {
+          localNodes.Add (nodes.Get (i));
+        }
+    }
+  FlowMonitorHelper flowmon;
+  Ptr<FlowMonitor> monitor = flowmon.Install (localNodes);
+  if (nRanks > 1)
+    {
+      TraceAttach::Aggregated<Ipv4L3Protocol> (localNodes, "LocalDeliver", MakeCallback (&CountDelivered));
+    }
 
-  ssThreshStream.open ("tcp-dynamic-pacing-ssthresh.dat", std::ios::out);
-  ssThreshStream << "#Time(s) Slow Start threshold (B)" << std::endl;
+  MemoryAccounting memory;
+  if (memoryInterval.IsStrictlyPositive ())
+    {
+      memory.Install (localNodes);
+      memory.SetFlowMonitor (monitor);
+      memory.Start (Seconds (0), memoryInterval, prefix + "tcp-dynamic-pacing");
+    }
 
-  packetTraceStream.open ("tcp-dynamic-pacing-packet-trace.dat", std::ios::out);
-  packetTraceStream << "#Time(s) tx/rx size (B)" << std::endl;
+  // IP Tx/Rx/Drop of every local node as one row of counters per interval
+  Ipv4InterfaceCounters packetCounters;
+  if (packetCounterInterval.IsStrictlyPositive ())
+    {
+      packetCounters.Install (localNodes);
+      packetCounters.SetSampling (packetSample, prefix + "tcp-dynamic-pacing-packet-sample.dat");
+      packetCounters.Start (Seconds (0), packetCounterInterval, prefix + "tcp-dynamic-pacing-packet-counters.dat");
+    }
 
-  Simulator::Schedule (MicroSeconds (1001), &ConnectSocketTraces);
+  // The bottleneck's device queue and, with --useQueueDisc, its FqCoDel
+  QueueTelemetry queueTelemetry;
+  Ptr<NetDevice> bottleneckDevice = topo.GetCoreDevices (0).Get (0);
+  if (queueInterval.IsStrictlyPositive () && IsLocal (bottleneckDevice->GetNode ()))
+    {
+      queueTelemetry.Add (bottleneckDevice, "bottleneck", queueFlows);
+      queueTelemetry.Start (Seconds (0), queueInterval, prefix + "tcp-dynamic-pacing");
+    }
 
-  FlowMonitorHelper flowmon;
-  Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
 
+  if (compressedPcap)
+    {
+      pcap.EnablePointToPoint (prefix + "left-side", topo.GetLeftDevices (0));
+    }
+  else if (replications == 0 && branchTcp.empty ())
+    {
+      // Not with --branchTcp: the pcap file is written as packets arrive,
+      // so the branches would all append to the one opened here
+      leftAccessLink.EnablePcap(prefix + "left-side", topo.GetLeftDevices (0));
+    }
 
-  leftAccessLink.EnablePcap("left-side", d1d5);
+  // Simulate the warm-up (n1's flow and n2's flow to n3) once, and branch
+  // when n2's flow to n4 starts
+  SimulationCheckpoint checkpoint;
+  if (!branchTcp.empty ())
+    {
+      std::istringstream variants (branchTcp);
+      std::string v;
+      while (std::getline (variants, v, ','))
+        {
+          TypeId tcp;
+          NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe (v.find ("ns3::") == 0 ? v : "ns3::" + v, &tcp),
+                               "Unknown TCP variant " << v);
+          checkpoint.AddBranch (v, MakeBoundCallback (&StartBranch, nodes.Get (1), tcp,
+                                                      prefix + "tcp-dynamic-pacing-" + v));
+        }
+      checkpoint.SetParallel (branchParallel);
+      if (branchParallel > 1)
+        {
+          checkpoint.SetOutputPrefix (prefix + "tcp-dynamic-pacing-");
+        }
+      Simulator::Schedule (Seconds (15), &FlushTraces);
+      checkpoint.Schedule (Seconds (15));
+    }
+
+  // Early stop once both flows' goodput and the bottleneck delay settle;
+  // n2's second flow starts at 15 s.
+  SteadyStateDetector detector;
+  if (steadyState > 0)
+    {
+      detector.AddSinkGoodput ("goodput n3", DynamicCast<PacketSink> (sinkApps3.Get (0)));
+      detector.AddSinkGoodput ("goodput n4", DynamicCast<PacketSink> (sinkApps4.Get (0)));
+      detector.AddLevel ("queue delay ms", MakeBoundCallback (&BottleneckQueueDelay, bottleneckDevice, bottleneckBandwidth));
+      detector.SetWarmup (Seconds (16));
+      detector.SetRelativeWidth (steadyState);
+      detector.Start ();
+    }
 
   NS_LOG_INFO ("Run Simulation.");
   Simulator::Stop (simulationEndTime);
+  if (replications > 0)
+    {
+      ReplicationEngine engine;
+      engine.SetReplications (replications);
+      engine.SetParallel (replicationParallel > 0 ? replicationParallel : sysconf (_SC_NPROCESSORS_ONLN));
+      engine.SetFirstRun (RngSeedManager::GetRun ());
+      engine.SetPrepareCallback (MakeBoundCallback (&ReseedReplication, uniformRv, sourceApps13, nodes));
+      engine.SetFlowMonitor (monitor, DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ()));
+      engine.Run ();
+      engine.Report (std::cout);
+      if (!flowStatsFile.empty ())
+        {
+          engine.WriteTable (flowStatsFile);
+        }
+      Simulator::Destroy ();
+      return 0;
+    }
+  SystemWallClockMs wallClock;
+  wallClock.Start ();
   Simulator::Run ();
+  int64_t wallMs = wallClock.End ();
+  Time runTime = Simulator::Now ();
+  pcap.Close ();
+  queueTelemetry.Stop ();
+  packetCounters.Stop ();
+  if (steadyState > 0)
+    {
+      detector.Report (std::cout);
+    }
+  if (memoryInterval.IsStrictlyPositive ())
+    {
+      memory.Stop ();
+      memory.Report (std::cout);
+    }
+  if (rank == 0)
+    {
+      std::cerr << "Ranks:      " << nRanks << "\n";
+      std::cerr << "Wall clock: " << wallMs << " ms\n";
+    }
+  if (!checkpoint.GetBranch ().empty () && !flowStatsFile.empty ())
+    {
+      flowStatsFile += "." + checkpoint.GetBranch ();
+    }
+  if (nRanks > 1)
+    {
+      // Each rank only monitors its own nodes: tx counters come from the
+      // senders' rank and rx counters from the sinks' rank, and
+      // prob1-speedup merges the tables by five-tuple.
+      std::cout << "Rank " << rank << " of " << nRanks << "\n";
+      if (!flowStatsFile.empty ())
+        {
+          std::ostringstream rankFile;
+          rankFile << flowStatsFile << ".rank" << rank;
+          flowStatsFile = rankFile.str ();
+        }
+    }
 
   monitor->CheckForLostPackets ();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
@@ -258,16 +762,68 @@ main (int argc, char *argv[])
       std::cout << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
       std::cout << "  Tx Packets: " << i->second.txPackets << "\n";
       std::cout << "  Tx Bytes:   " << i->second.txBytes << "\n";
-      std::cout << "  TxOffered:  " << i->second.txBytes * 8.0 / simulationEndTime.GetSeconds () / 1000000  << " Mbps\n";
+      std::cout << "  TxOffered:  " << i->second.txBytes * 8.0 / runTime.GetSeconds () / 1000000  << " Mbps\n";
       std::cout << "  Rx Packets: " << i->second.rxPackets << "\n";
       std::cout << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-      std::cout << "  Throughput: " << i->second.rxBytes * 8.0 / simulationEndTime.GetSeconds () / 1000000  << " Mbps\n";
+      std::cout << "  Throughput: " << i->second.rxBytes * 8.0 / runTime.GetSeconds () / 1000000  << " Mbps\n";
     }
 
+  if (!flowStatsFile.empty ())
+    {
+      std::ofstream flowStatsStream (flowStatsFile.c_str (), std::ios::out);
+      flowStatsStream << "flowId\tsource\tdestination\tsourcePort\tdestinationPort\ttxPackets\ttxBytes\trxPackets\trxBytes\tlostPackets\tthroughputMbps\tmeanDelayMs\n";
+      for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i)
+        {
+          Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
+          uint64_t rxPackets = i->second.rxPackets;
+          uint64_t rxBytes = i->second.rxBytes;
+          if (nRanks > 1)
+            {
+              DeliveredCount c = delivered[t];
+              rxPackets = c.packets;
+              rxBytes = c.bytes;
+              delivered.erase (t);
+            }
+          double meanDelayMs = i->second.rxPackets ? i->second.delaySum.GetSeconds () * 1000 / i->second.rxPackets : 0;
+          flowStatsStream << i->first << "\t" << t.sourceAddress << "\t" << t.destinationAddress
+                          << "\t" << t.sourcePort << "\t" << t.destinationPort
+                          << "\t" << i->second.txPackets << "\t" << i->second.txBytes
+                          << "\t" << rxPackets << "\t" << rxBytes
+                          << "\t" << i->second.lostPackets
+                          << "\t" << rxBytes * 8.0 / runTime.GetSeconds () / 1000000
+                          << "\t" << meanDelayMs << "\n";
+        }
+      // Flows sent from another rank: rx counters only, flow id 0
+      for (std::map<Ipv4FlowClassifier::FiveTuple, DeliveredCount>::const_iterator i = delivered.begin ();
+           i != delivered.end (); ++i)
+        {
+          flowStatsStream << 0 << "\t" << i->first.sourceAddress << "\t" << i->first.destinationAddress
+                          << "\t" << i->first.sourcePort << "\t" << i->first.destinationPort
+                          << "\t0\t0\t" << i->second.packets << "\t" << i->second.bytes
+                          << "\t0\t" << i->second.bytes * 8.0 / runTime.GetSeconds () / 1000000
+                          << "\t0\n";
+        }
+    }
 
-  cwndStream.close ();
-  cwndStream2.close ();
-  pacingRateStream.close ();
-  ssThreshStream.close ();
+
+  if (binaryTrace)
+    {
+      traceSink.Close ();
+    }
+  else
+    {
+      cwndStream.close ();
+      cwndStream2.close ();
+      pacingRateStream.close ();
+      ssThreshStream.close ();
+      packetTraceStream.close ();
+    }
+  flowTracer.Close ();
   Simulator::Destroy ();
+#ifdef NS3_MPI
+  if (distributed)
+    {
+      MpiInterface::Disable ();
+    }
+#endif
 }
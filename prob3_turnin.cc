@@ -10,23 +10,14 @@
 #include "ns3/csma-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 
+#include "throughput-sampler.h"
+#include "compressed-pcap.h"
+#include "flow-trace-replay.h"
+
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp");
 
 using namespace ns3;
 
-// Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
-// uint64_t lastTotalRx = 0;                     /* The value of the last total received bytes */
-
-// void
-// CalculateThroughput ()
-// {
-//   Time now = Simulator::Now ();                                         /* Return the simulator's virtual time. */
-//   double cur = (sink->GetTotalRx () - lastTotalRx) * (double) 8 / 1e6;     /* Convert Application RX Packets to MBits. */
-//   std::cout << now.GetSeconds () << "s: \t" << cur << " Mbit/s" << std::endl;
-//   lastTotalRx = sink->GetTotalRx ();
-//   Simulator::Schedule (MilliSeconds (100), &CalculateThroughput);
-// }
-
 int
 main (int argc, char *argv[])
 {
@@ -36,6 +27,12 @@ main (int argc, char *argv[])
   std::string phyRate = "HtMcs7";                    /* Physical layer bitrate. */
   double simulationTime = 10;                        /* Simulation time in seconds. */
   bool pcapTracing = true;                          /* PCAP Tracing is enabled or not. */
+  double throughputInterval = 0.1;                   /* Goodput sampling interval in seconds, 0 to disable. */
+  bool compressedPcap = false;                       /* Truncated, compressed PCAP instead of full frames. */
+  uint32_t snapLen = 128;                            /* Bytes kept per frame with compressedPcap. */
+  std::string pcapCompressor = "gzip";               /* Compressor for compressedPcap. */
+  uint32_t pcapRotateMB = 0;                         /* Rotate compressedPcap files every this many MB. */
+  std::string flowTrace = "";                        /* Flow arrival file replayed instead of the OnOff senders. */
 
   /* Command line argument parser setup. */
   CommandLine cmd (__FILE__);
@@ -44,6 +41,12 @@ main (int argc, char *argv[])
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
+  cmd.AddValue ("throughputInterval", "Sink goodput sampling interval in seconds (0 disables)", throughputInterval);
+  cmd.AddValue ("compressedPcap", "Write truncated, compressed pcap files from a background thread", compressedPcap);
+  cmd.AddValue ("snapLen", "Bytes kept per frame with --compressedPcap (0 for whole frames)", snapLen);
+  cmd.AddValue ("pcapCompressor", "Compressor for --compressedPcap: gzip, bzip2, xz, zstd or none", pcapCompressor);
+  cmd.AddValue ("pcapRotateMB", "Start a new --compressedPcap file every this many MB (0 to disable)", pcapRotateMB);
+  cmd.AddValue ("flowTrace", "Replay this flow arrival file (see flow-trace-convert) instead of the constant-rate senders", flowTrace);
   cmd.Parse (argc, argv);
 
 
@@ -158,20 +161,58 @@ main (int argc, char *argv[])
   server2.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
   server2.SetAttribute ("DataRate", DataRateValue (DataRate (dataRate)));
 
-  ApplicationContainer sendApp13 = server.Install (staWifiNodes.Get(0));
-  ApplicationContainer sendApp25 = server2.Install (staWifiNodes.Get(1));
-
+  ApplicationContainer sendApp13;
+  ApplicationContainer sendApp25;
+  if (flowTrace.empty ())
+    {
+      sendApp13 = server.Install (staWifiNodes.Get(0));
+      sendApp25 = server2.Install (staWifiNodes.Get(1));
+    }
 
+  /* Or replay logged flows between sta0, sta1, the AP, node4 and node5 (endpoints 0-4) */
+  FlowTraceReplay replay;
+  if (!flowTrace.empty ())
+    {
+      replay.AddEndpoint (staWifiNodes.Get (0), staInterface.GetAddress (0));
+      replay.AddEndpoint (staWifiNodes.Get (1), staInterface.GetAddress (1));
+      replay.AddEndpoint (apWifiNode.Get (0), apInterface.GetAddress (0));
+      replay.AddEndpoint (csmaNodes.Get (1), csmaInterface.GetAddress (1));
+      replay.AddEndpoint (csmaNodes.Get (2), csmaInterface.GetAddress (2));
+      replay.SetPacketSize (payloadSize);
+      replay.SetUdpRate (DataRate (dataRate));
+      replay.Start (flowTrace);
+    }
 
   /* Start Applications */
   sinkApp.Start (Seconds (0.0));
   sinkApp2.Start (Seconds (0.0));
   sendApp13.Start (Seconds (1.0));
   sendApp25.Start (Seconds (1.0));
-  // Simulator::Schedule (Seconds (1.1), &CalculateThroughput);
+
+  /* Sample the goodput of every sink from one periodic event */
+  ThroughputSampler throughputSampler;
+  if (throughputInterval > 0)
+    {
+      throughputSampler.Add (sinkApp);
+      throughputSampler.Add (sinkApp2);
+      for (uint32_t i = 0; i < replay.GetNEndpoints (); ++i)
+        {
+          throughputSampler.Add (replay.GetRxCounter (i), "endpoint" + std::to_string (i));
+        }
+      throughputSampler.Start (Seconds (1.1), Seconds (throughputInterval), "wifi-tcp-throughput.dat");
+    }
 
   /* Enable Traces */
-  if (pcapTracing)
+  CompressedPcap pcap;
+  if (pcapTracing && compressedPcap)
+    {
+      pcap.SetSnapLen (snapLen);
+      pcap.SetCompressor (pcapCompressor);
+      pcap.SetMaxFileBytes (uint64_t (pcapRotateMB) << 20);
+      pcap.EnableWifi ("AccessPoint", apDevice);
+      pcap.EnableWifi ("Station", staDevices);
+    }
+  else if (pcapTracing)
     {
       wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
       wifiPhy.EnablePcap ("AccessPoint", apDevice);
@@ -182,6 +223,12 @@ main (int argc, char *argv[])
   /* Start Simulation */
   Simulator::Stop (Seconds (simulationTime + 1));
   Simulator::Run ();
+  throughputSampler.Stop ();
+  pcap.Close ();
+  if (!flowTrace.empty ())
+    {
+      replay.Report (std::cout);
+    }
 
 
   Simulator::Destroy ();
@@ -0,0 +1,346 @@
+#ifndef QUEUE_TELEMETRY_H
+#define QUEUE_TELEMETRY_H
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+namespace ns3 {
+
+/**
+ * Interval counters and sojourn-time histograms for device queues and
+ * queue discs, without per-packet output.
+ *
+ * Each queue keeps, for the current interval, its peak backlog, the
+ * packets enqueued, dequeued, dropped and ECN-marked, and a histogram of
+ * sojourn times in power-of-two microsecond bins (32 counters, however
+ * long the run).  One periodic event writes a line per queue to
+ * \<prefix\>-queue.dat:
+ *
+ *   time  queue  pkts bytes maxPkts maxBytes enq deq drops marks sojournMean sojournP99 sojournMax
+ *
+ * with sojourn times in ms; the percentile is the upper edge of its bin.
+ * Stop writes the whole-run histograms to \<prefix\>-queue-sojourn.dat.
+ *
+ * Device queues are followed through their Enqueue, Dequeue and drop
+ * traces and, being FIFO, give sojourn times from a queue of enqueue
+ * times.  Queue discs are read from their statistics at each sample,
+ * with the Enqueue and Dequeue traces only used for the peak backlog and
+ * the sojourn time (from the item's time stamp).  With perFlow, the
+ * classes of a queue disc (FqCoDel's flow queues) also get a line each in
+ * \<prefix\>-queue-flows.dat whenever they hold or moved packets.
+ */
+class QueueTelemetry
+{
+public:
+  static const uint32_t N_BINS = 32;
+
+  /// Follow a point-to-point device queue
+  void
+  Add (Ptr<Queue<Packet> > queue, std::string name)
+  {
+    m_queues.push_back (State (name));
+    State *s = &m_queues.back ();
+    s->queue = queue;
+    queue->TraceConnectWithoutContext ("Enqueue", MakeBoundCallback (&QueueTelemetry::QueueEnqueue, s));
+    queue->TraceConnectWithoutContext ("Dequeue", MakeBoundCallback (&QueueTelemetry::QueueDequeue, s));
+    queue->TraceConnectWithoutContext ("DropBeforeEnqueue", MakeBoundCallback (&QueueTelemetry::QueueDrop, s));
+    queue->TraceConnectWithoutContext ("DropAfterDequeue", MakeBoundCallback (&QueueTelemetry::QueueDrop, s));
+  }
+
+  /// Follow a root queue disc, and its classes too if \p perFlow
+  void
+  Add (Ptr<QueueDisc> qdisc, std::string name, bool perFlow)
+  {
+    m_queues.push_back (State (name));
+    State *s = &m_queues.back ();
+    s->qdisc = qdisc;
+    s->perFlow = perFlow;
+    qdisc->TraceConnectWithoutContext ("Enqueue", MakeBoundCallback (&QueueTelemetry::DiscEnqueue, s));
+    qdisc->TraceConnectWithoutContext ("Dequeue", MakeBoundCallback (&QueueTelemetry::DiscDequeue, s));
+  }
+
+  /// Follow the queue of \p device and the root queue disc installed on it, if any
+  void
+  Add (Ptr<NetDevice> device, std::string name, bool perFlow)
+  {
+    Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice> (device);
+    NS_ABORT_MSG_UNLESS (p2p, "QueueTelemetry only knows point-to-point device queues");
+    Add (p2p->GetQueue (), name + "/device");
+    Ptr<TrafficControlLayer> tc = device->GetNode ()->GetObject<TrafficControlLayer> ();
+    Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice (device) : 0;
+    if (qdisc)
+      {
+        Add (qdisc, name + "/" + qdisc->GetInstanceTypeId ().GetName ().substr (5), perFlow);
+      }
+  }
+
+  void
+  Start (Time start, Time interval, std::string prefix)
+  {
+    m_interval = interval;
+    m_prefix = prefix;
+    m_out.open ((prefix + "-queue.dat").c_str (), std::ios::out);
+    m_out << "#Time(s)\tqueue\tpkts\tbytes\tmaxPkts\tmaxBytes\tenq\tdeq\tdrops\tmarks"
+          << "\tsojournMean(ms)\tsojournP99(ms)\tsojournMax(ms)\n" << std::fixed << std::setprecision (6);
+    for (std::deque<State>::iterator s = m_queues.begin (); s != m_queues.end (); ++s)
+      {
+        if (s->perFlow && !m_flowOut.is_open ())
+          {
+            m_flowOut.open ((prefix + "-queue-flows.dat").c_str (), std::ios::out);
+            m_flowOut << "#Time(s)\tqueue\tclass\tpkts\tbytes\tdeq\tdrops\tmarks\n" << std::fixed << std::setprecision (6);
+          }
+      }
+    m_event = Simulator::Schedule (start, &QueueTelemetry::Sample, this);
+  }
+
+  /// Stop sampling and write the whole-run sojourn histograms
+  void
+  Stop (void)
+  {
+    m_event.Cancel ();
+    if (!m_out.is_open ())
+      {
+        return;
+      }
+    m_out.close ();
+    m_flowOut.close ();
+    std::ofstream hist ((m_prefix + "-queue-sojourn.dat").c_str (), std::ios::out);
+    hist << "#queue\tfromUs\ttoUs\tpackets\n";
+    for (std::deque<State>::iterator s = m_queues.begin (); s != m_queues.end (); ++s)
+      {
+        for (uint32_t b = 0; b < N_BINS; ++b)
+          {
+            if (s->totalHist[b] > 0)
+              {
+                hist << s->name << "\t" << BinFrom (b) << "\t" << BinTo (b) << "\t" << s->totalHist[b] << "\n";
+              }
+          }
+      }
+  }
+
+private:
+  struct Counters
+  {
+    Counters () : dequeued (0), dropped (0), marked (0) {}
+    uint64_t dequeued;
+    uint64_t dropped;
+    uint64_t marked;
+  };
+
+  struct State
+  {
+    State (std::string n)
+      : name (n), perFlow (false), enq (0), deq (0), drops (0), marks (0),
+        maxPackets (0), maxBytes (0), sojournCount (0), sojournSum (0), sojournMax (0),
+        enqTotal (0)
+    {
+      std::fill (hist, hist + N_BINS, 0);
+      std::fill (totalHist, totalHist + N_BINS, 0);
+    }
+
+    std::string                   name;
+    Ptr<Queue<Packet> >           queue;
+    Ptr<QueueDisc>                qdisc;
+    bool                          perFlow;
+    std::deque<int64_t>           enqueueTimes;   //!< device queue only, in ns
+    uint64_t                      enq;
+    uint64_t                      deq;
+    uint64_t                      drops;
+    uint64_t                      marks;
+    uint32_t                      maxPackets;
+    uint32_t                      maxBytes;
+    uint64_t                      sojournCount;
+    int64_t                       sojournSum;     //!< ns
+    int64_t                       sojournMax;
+    uint64_t                      hist[N_BINS];
+    uint64_t                      totalHist[N_BINS];
+    uint64_t                      enqTotal;       //!< queue disc statistics at the last sample
+    Counters                      last;
+    std::map<uint32_t, Counters>  lastClass;
+  };
+
+  // Bin b holds [2^(b-1), 2^b) us; bin 0 is under 1 us
+  static uint32_t
+  Bin (int64_t ns)
+  {
+    uint64_t us = ns / 1000;
+    uint32_t b = 0;
+    while (us > 0 && b < N_BINS - 1)
+      {
+        us >>= 1;
+        ++b;
+      }
+    return b;
+  }
+
+  static uint64_t BinFrom (uint32_t b) { return b == 0 ? 0 : uint64_t (1) << (b - 1); }
+  static uint64_t BinTo (uint32_t b) { return uint64_t (1) << b; }
+
+  static void
+  Sojourn (State *s, int64_t ns)
+  {
+    ++s->sojournCount;
+    s->sojournSum += ns;
+    s->sojournMax = std::max (s->sojournMax, ns);
+    uint32_t b = Bin (ns);
+    ++s->hist[b];
+    ++s->totalHist[b];
+  }
+
+  static void
+  Backlog (State *s, uint32_t packets, uint32_t bytes)
+  {
+    s->maxPackets = std::max (s->maxPackets, packets);
+    s->maxBytes = std::max (s->maxBytes, bytes);
+  }
+
+  static void
+  QueueEnqueue (State *s, Ptr<const Packet> p)
+  {
+    ++s->enq;
+    s->enqueueTimes.push_back (Simulator::Now ().GetNanoSeconds ());
+    Backlog (s, s->queue->GetNPackets (), s->queue->GetNBytes ());
+  }
+
+  static void
+  QueueDequeue (State *s, Ptr<const Packet> p)
+  {
+    ++s->deq;
+    if (!s->enqueueTimes.empty ())
+      {
+        Sojourn (s, Simulator::Now ().GetNanoSeconds () - s->enqueueTimes.front ());
+        s->enqueueTimes.pop_front ();
+      }
+  }
+
+  static void
+  QueueDrop (State *s, Ptr<const Packet> p)
+  {
+    ++s->drops;
+  }
+
+  static void
+  DiscEnqueue (State *s, Ptr<const QueueDiscItem> item)
+  {
+    Backlog (s, s->qdisc->GetNPackets (), s->qdisc->GetNBytes ());
+  }
+
+  static void
+  DiscDequeue (State *s, Ptr<const QueueDiscItem> item)
+  {
+    Sojourn (s, (Simulator::Now () - item->GetTimeStamp ()).GetNanoSeconds ());
+  }
+
+  static double
+  Percentile (const uint64_t *hist, uint64_t count, double p)
+  {
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < N_BINS; ++b)
+      {
+        seen += hist[b];
+        if (seen >= p * count)
+          {
+            return BinTo (b) / 1000.0;
+          }
+      }
+    return BinTo (N_BINS - 1) / 1000.0;
+  }
+
+  // Interval counters of a queue disc, from its statistics
+  static void
+  ReadStats (State *s)
+  {
+    const QueueDisc::Stats &st = s->qdisc->GetStats ();
+    s->enq = st.nTotalEnqueuedPackets - s->enqTotal;
+    s->deq = st.nTotalDequeuedPackets - s->last.dequeued;
+    s->drops = st.nTotalDroppedPackets - s->last.dropped;
+    s->marks = st.nTotalMarkedPackets - s->last.marked;
+    s->enqTotal = st.nTotalEnqueuedPackets;
+    s->last.dequeued = st.nTotalDequeuedPackets;
+    s->last.dropped = st.nTotalDroppedPackets;
+    s->last.marked = st.nTotalMarkedPackets;
+  }
+
+  void
+  WriteClasses (State *s, double now)
+  {
+    for (std::size_t c = 0; c < s->qdisc->GetNQueueDiscClasses (); ++c)
+      {
+        Ptr<QueueDisc> child = s->qdisc->GetQueueDiscClass (c)->GetQueueDisc ();
+        const QueueDisc::Stats &st = child->GetStats ();
+        Counters &last = s->lastClass[c];
+        uint64_t deq = st.nTotalDequeuedPackets - last.dequeued;
+        uint64_t drops = st.nTotalDroppedPackets - last.dropped;
+        uint64_t marks = st.nTotalMarkedPackets - last.marked;
+        if (child->GetNPackets () > 0 || deq > 0 || drops > 0 || marks > 0)
+          {
+            m_flowOut << now << "\t" << s->name << "\t" << c << "\t" << child->GetNPackets ()
+                      << "\t" << child->GetNBytes () << "\t" << deq << "\t" << drops << "\t" << marks << "\n";
+          }
+        last.dequeued = st.nTotalDequeuedPackets;
+        last.dropped = st.nTotalDroppedPackets;
+        last.marked = st.nTotalMarkedPackets;
+      }
+  }
+
+  void
+  Sample (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    for (std::deque<State>::iterator i = m_queues.begin (); i != m_queues.end (); ++i)
+      {
+        State *s = &*i;
+        uint32_t packets, bytes;
+        if (s->qdisc)
+          {
+            ReadStats (s);
+            packets = s->qdisc->GetNPackets ();
+            bytes = s->qdisc->GetNBytes ();
+          }
+        else
+          {
+            packets = s->queue->GetNPackets ();
+            bytes = s->queue->GetNBytes ();
+          }
+        Backlog (s, packets, bytes);
+        double mean = s->sojournCount ? s->sojournSum / 1e6 / s->sojournCount : 0;
+        double p99 = s->sojournCount ? Percentile (s->hist, s->sojournCount, 0.99) : 0;
+        m_out << now << "\t" << s->name << "\t" << packets << "\t" << bytes
+              << "\t" << s->maxPackets << "\t" << s->maxBytes
+              << "\t" << s->enq << "\t" << s->deq << "\t" << s->drops << "\t" << s->marks
+              << "\t" << mean << "\t" << p99 << "\t" << s->sojournMax / 1e6 << "\n";
+        if (s->perFlow && s->qdisc)
+          {
+            WriteClasses (s, now);
+          }
+
+        s->enq = s->deq = s->drops = s->marks = 0;
+        s->maxPackets = packets;
+        s->maxBytes = bytes;
+        s->sojournCount = 0;
+        s->sojournSum = 0;
+        s->sojournMax = 0;
+        std::fill (s->hist, s->hist + N_BINS, 0);
+      }
+    m_event = Simulator::Schedule (m_interval, &QueueTelemetry::Sample, this);
+  }
+
+  std::deque<State> m_queues;     //!< a deque, so the traces' State pointers stay valid
+  Time              m_interval;
+  std::string       m_prefix;
+  EventId           m_event;
+  std::ofstream     m_out;
+  std::ofstream     m_flowOut;
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_TELEMETRY_H */
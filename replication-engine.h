@@ -0,0 +1,366 @@
+#ifndef REPLICATION_ENGINE_H
+#define REPLICATION_ENGINE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include "steady-state-detector.h"
+
+namespace ns3 {
+
+/// One flow of one replication, as sent from a worker to the parent
+struct ReplicationFlowRecord
+{
+  uint32_t run;
+  uint32_t flowId;
+  uint32_t source;                //!< Ipv4Address::Get ()
+  uint32_t destination;
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+  uint32_t protocol;
+  uint64_t txPackets;
+  uint64_t txBytes;
+  uint64_t rxPackets;
+  uint64_t rxBytes;
+  uint64_t lostPackets;
+  double   delaySum;              //!< seconds
+  double   duration;              //!< simulated seconds of the replication
+};
+
+/**
+ * Runs independent replications of a scenario that is built only once.
+ *
+ * The scenario is set up as usual up to, but not including,
+ * Simulator::Run.  ReplicationEngine::Run then forks one worker per
+ * replication, at most SetParallel at a time; the workers share the
+ * parent's topology, stacks, queue discs and routes copy-on-write.  Each
+ * worker sets RngRun to its run number, calls the prepare callback,
+ * simulates, and sends the FlowMonitor statistics back over a pipe.
+ *
+ * Random variables created during setup drew their seeds from the
+ * parent's run, so the prepare callback must give the ones the scenario
+ * depends on new streams (SetStream or the helpers' AssignStreams, which
+ * take the new run) and redraw any value already taken from them:
+ *
+ * \code
+ *   ReplicationEngine engine;
+ *   engine.SetReplications (30);
+ *   engine.SetPrepareCallback (MakeBoundCallback (&Reseed, uniformRv, sourceApps, nodes));
+ *   engine.SetFlowMonitor (monitor, classifier);
+ *   engine.Run ();           // only the parent returns
+ *   engine.Report (std::cout);
+ * \endcode
+ *
+ * Files opened during setup are shared by all workers, so per-run traces
+ * should be left off in this mode.
+ */
+class ReplicationEngine
+{
+public:
+  ReplicationEngine ()
+    : m_replications (1),
+      m_parallel (1),
+      m_firstRun (1),
+      m_failed (0)
+  {
+  }
+
+  void SetReplications (uint32_t n) { m_replications = n; }
+  /// Workers running at the same time (default 1)
+  void SetParallel (uint32_t parallel) { m_parallel = parallel > 0 ? parallel : 1; }
+  /// RngRun of the first replication; the others follow (default 1)
+  void SetFirstRun (uint32_t run) { m_firstRun = run; }
+  /// Called in each worker with its run number, just before Simulator::Run
+  void SetPrepareCallback (Callback<void, uint32_t> prepare) { m_prepare = prepare; }
+
+  void
+  SetFlowMonitor (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+  {
+    m_monitor = monitor;
+    m_classifier = classifier;
+  }
+
+  /// Run all replications; returns in the parent only
+  void
+  Run (void)
+  {
+    NS_ABORT_MSG_UNLESS (m_monitor && m_classifier, "ReplicationEngine needs a FlowMonitor");
+    std::cout.flush ();
+    std::cerr.flush ();
+    std::clog.flush ();
+    std::fflush (0);
+
+    std::map<int, Worker> running;   // by pipe read end
+    uint32_t next = 0;
+    while (next < m_replications || !running.empty ())
+      {
+        while (running.size () < m_parallel && next < m_replications)
+          {
+            int fds[2];
+            NS_ABORT_MSG_IF (pipe (fds) != 0, "Cannot create a replication pipe");
+            uint32_t run = m_firstRun + next++;
+            pid_t pid = fork ();
+            NS_ABORT_MSG_IF (pid < 0, "Cannot fork replication " << run);
+            if (pid == 0)
+              {
+                close (fds[0]);
+                for (std::map<int, Worker>::iterator i = running.begin (); i != running.end (); ++i)
+                  {
+                    close (i->first);
+                  }
+                RunWorker (run, fds[1]);
+              }
+            close (fds[1]);
+            Worker w;
+            w.pid = pid;
+            w.run = run;
+            running[fds[0]] = w;
+          }
+        Collect (running);
+      }
+    std::stable_sort (m_records.begin (), m_records.end (), EarlierRun);
+    std::cerr << m_replications << " replications, " << m_failed << " failed\n";
+  }
+
+  /// Flow records of all replications, by run
+  const std::vector<ReplicationFlowRecord> &GetRecords (void) const { return m_records; }
+
+  /// Mean and 95% confidence interval over the replications, per flow
+  void
+  Report (std::ostream &os) const
+  {
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<const ReplicationFlowRecord *> > flows;
+    for (std::size_t i = 0; i < m_records.size (); ++i)
+      {
+        std::string key = FlowName (m_records[i]);
+        if (flows.find (key) == flows.end ())
+          {
+            order.push_back (key);
+          }
+        flows[key].push_back (&m_records[i]);
+      }
+    for (std::size_t f = 0; f < order.size (); ++f)
+      {
+        const std::vector<const ReplicationFlowRecord *> &r = flows[order[f]];
+        std::vector<double> throughput, delay, loss;
+        for (std::size_t i = 0; i < r.size (); ++i)
+          {
+            throughput.push_back (r[i]->rxBytes * 8.0 / r[i]->duration / 1e6);
+            delay.push_back (r[i]->rxPackets ? r[i]->delaySum * 1000 / r[i]->rxPackets : 0);
+            loss.push_back (r[i]->txPackets ? double (r[i]->lostPackets) / r[i]->txPackets : 0);
+          }
+        os << "Flow " << order[f] << ", " << r.size () << " replications\n";
+        PrintInterval (os, "Throughput", throughput, "Mbps");
+        PrintInterval (os, "Mean delay", delay, "ms");
+        PrintInterval (os, "Loss ratio", loss, "");
+      }
+  }
+
+  /// One row per flow and replication, tab-separated
+  void
+  WriteTable (std::string fileName) const
+  {
+    std::ofstream out (fileName.c_str (), std::ios::out);
+    out << "run\tflowId\tsource\tdestination\tsourcePort\tdestinationPort\ttxPackets\ttxBytes\trxPackets\trxBytes\tlostPackets\tthroughputMbps\tmeanDelayMs\n";
+    for (std::size_t i = 0; i < m_records.size (); ++i)
+      {
+        const ReplicationFlowRecord &r = m_records[i];
+        out << r.run << "\t" << r.flowId << "\t" << Ipv4Address (r.source) << "\t" << Ipv4Address (r.destination)
+            << "\t" << r.sourcePort << "\t" << r.destinationPort
+            << "\t" << r.txPackets << "\t" << r.txBytes << "\t" << r.rxPackets << "\t" << r.rxBytes
+            << "\t" << r.lostPackets << "\t" << r.rxBytes * 8.0 / r.duration / 1e6
+            << "\t" << (r.rxPackets ? r.delaySum * 1000 / r.rxPackets : 0) << "\n";
+      }
+  }
+
+private:
+  struct Worker
+  {
+    pid_t             pid;
+    uint32_t          run;
+    std::vector<char> data;
+  };
+
+  static bool
+  EarlierRun (const ReplicationFlowRecord &a, const ReplicationFlowRecord &b)
+  {
+    return a.run < b.run;
+  }
+
+  static std::string
+  FlowName (const ReplicationFlowRecord &r)
+  {
+    std::ostringstream name;
+    name << Ipv4Address (r.source) << ":" << r.sourcePort << " -> "
+         << Ipv4Address (r.destination) << ":" << r.destinationPort << " (" << r.protocol << ")";
+    return name.str ();
+  }
+
+  static void
+  PrintInterval (std::ostream &os, const char *name, const std::vector<double> &x, const char *unit)
+  {
+    double mean = 0;
+    for (std::size_t i = 0; i < x.size (); ++i)
+      {
+        mean += x[i];
+      }
+    mean /= x.size ();
+    double half = 0;
+    if (x.size () > 1)
+      {
+        double var = 0;
+        for (std::size_t i = 0; i < x.size (); ++i)
+          {
+            var += (x[i] - mean) * (x[i] - mean);
+          }
+        var /= x.size () - 1;
+        half = SteadyStateDetector::StudentT (x.size () - 1) * std::sqrt (var / x.size ());
+      }
+    os << "  " << std::left << std::setw (12) << name << std::right << mean << " +/- " << half
+       << (*unit ? " " : "") << unit << "\n";
+  }
+
+  // In the worker: simulate, send the flow statistics and exit
+  void
+  RunWorker (uint32_t run, int fd)
+  {
+    RngSeedManager::SetRun (run);
+    if (!m_prepare.IsNull ())
+      {
+        m_prepare (run);
+      }
+    Simulator::Run ();
+    double duration = Simulator::Now ().GetSeconds ();
+    m_monitor->CheckForLostPackets ();
+    const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+    std::vector<ReplicationFlowRecord> records;
+    for (FlowMonitor::FlowStatsContainerCI i = stats.begin (); i != stats.end (); ++i)
+      {
+        Ipv4FlowClassifier::FiveTuple t = m_classifier->FindFlow (i->first);
+        ReplicationFlowRecord r;
+        r.run = run;
+        r.flowId = i->first;
+        r.source = t.sourceAddress.Get ();
+        r.destination = t.destinationAddress.Get ();
+        r.sourcePort = t.sourcePort;
+        r.destinationPort = t.destinationPort;
+        r.protocol = t.protocol;
+        r.txPackets = i->second.txPackets;
+        r.txBytes = i->second.txBytes;
+        r.rxPackets = i->second.rxPackets;
+        r.rxBytes = i->second.rxBytes;
+        r.lostPackets = i->second.lostPackets;
+        r.delaySum = i->second.delaySum.GetSeconds ();
+        r.duration = duration;
+        records.push_back (r);
+      }
+    const char *p = records.empty () ? 0 : reinterpret_cast<const char *> (&records[0]);
+    std::size_t left = records.size () * sizeof (ReplicationFlowRecord);
+    while (left > 0)
+      {
+        ssize_t n = write (fd, p, left);
+        if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+        if (n <= 0)
+          {
+            _exit (1);
+          }
+        p += n;
+        left -= n;
+      }
+    close (fd);
+    Simulator::Destroy ();
+    std::cout.flush ();
+    std::cerr.flush ();
+    std::clog.flush ();
+    std::fflush (0);
+    _exit (0);
+  }
+
+  // Read from the running workers until at least one finishes
+  void
+  Collect (std::map<int, Worker> &running)
+  {
+    std::vector<struct pollfd> fds;
+    for (std::map<int, Worker>::iterator i = running.begin (); i != running.end (); ++i)
+      {
+        struct pollfd p;
+        p.fd = i->first;
+        p.events = POLLIN;
+        p.revents = 0;
+        fds.push_back (p);
+      }
+    if (poll (&fds[0], fds.size (), -1) < 0)
+      {
+        NS_ABORT_MSG_IF (errno != EINTR, "poll failed while collecting replications");
+        return;
+      }
+    for (std::size_t f = 0; f < fds.size (); ++f)
+      {
+        if (fds[f].revents == 0)
+          {
+            continue;
+          }
+        Worker &w = running[fds[f].fd];
+        char buffer[65536];
+        ssize_t n = read (fds[f].fd, buffer, sizeof (buffer));
+        if (n > 0)
+          {
+            w.data.insert (w.data.end (), buffer, buffer + n);
+            continue;
+          }
+        if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+        // End of file: the worker is done
+        close (fds[f].fd);
+        int status;
+        waitpid (w.pid, &status, 0);
+        if (WIFEXITED (status) && WEXITSTATUS (status) == 0
+            && w.data.size () % sizeof (ReplicationFlowRecord) == 0)
+          {
+            const ReplicationFlowRecord *r = reinterpret_cast<const ReplicationFlowRecord *> (w.data.data ());
+            m_records.insert (m_records.end (), r, r + w.data.size () / sizeof (ReplicationFlowRecord));
+          }
+        else
+          {
+            std::cerr << "Replication " << w.run << " failed\n";
+            ++m_failed;
+          }
+        running.erase (fds[f].fd);
+      }
+  }
+
+  uint32_t                           m_replications;
+  uint32_t                           m_parallel;
+  uint32_t                           m_firstRun;
+  uint32_t                           m_failed;
+  Callback<void, uint32_t>           m_prepare;
+  Ptr<FlowMonitor>                   m_monitor;
+  Ptr<Ipv4FlowClassifier>            m_classifier;
+  std::vector<ReplicationFlowRecord> m_records;
+};
+
+} // namespace ns3
+
+#endif /* REPLICATION_ENGINE_H */
@@ -0,0 +1,275 @@
+// Link-failure route recomputation benchmark
+//
+// Builds a leaf-spine or dumbbell topology with TopologyBuilder, then
+// fails and restores random core links.  Each change is applied through
+// IncrementalRouting, which reruns only the affected shortest-path trees,
+// and is then also handled by a full
+// Ipv4GlobalRoutingHelper::RecomputeRoutingTables for comparison.
+// After every change the two are checked against each other for every
+// node and every interface address that is up (--verify, slow on large
+// topologies).  A differing next hop only counts as a mismatch when it
+// is not an equal-cost alternative; leaf-spine has many such ties.
+//
+//   ./waf --run "routing-failure-bench --hosts=2000 --leaves=32 --spines=8 --failures=20"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+
+#include "topology-builder.h"
+#include "incremental-routing.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RoutingFailureBench");
+
+// Same clock as IncrementalRouting::GetLastSeconds, so both paths compare
+static double
+SecondsSince (std::chrono::steady_clock::time_point start)
+{
+  std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+  return d.count ();
+}
+
+static Ptr<Ipv4GlobalRouting>
+GetGlobalRouting (Ptr<Ipv4> ipv4)
+{
+  Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ());
+  for (uint32_t i = 0; list && i < list->GetNRoutingProtocols (); ++i)
+    {
+      int16_t priority;
+      Ptr<Ipv4GlobalRouting> global = DynamicCast<Ipv4GlobalRouting> (list->GetRoutingProtocol (i, priority));
+      if (global)
+        {
+          return global;
+        }
+    }
+  NS_FATAL_ERROR ("Node " << ipv4->GetObject<Node> ()->GetId () << " has no Ipv4GlobalRouting");
+  return 0;
+}
+
+// True if dest is on an up interface of ipv4: static routing answers
+// those before either protocol is asked
+static bool
+IsConnected (Ptr<Ipv4> ipv4, Ipv4Address dest)
+{
+  for (uint32_t i = 0; i < ipv4->GetNInterfaces (); ++i)
+    {
+      for (uint32_t a = 0; a < ipv4->GetNAddresses (i); ++a)
+        {
+          Ipv4InterfaceAddress address = ipv4->GetAddress (i, a);
+          if (ipv4->IsUp (i) && address.GetLocal ().CombineMask (address.GetMask ())
+              == dest.CombineMask (address.GetMask ()))
+            {
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+/**
+ * Compare IncrementalRouting with global routing from every node to every
+ * interface address that is up.  Table indices follow the order of nodes,
+ * as in IncrementalRouting::Install.  Returns the mismatches; ties counts
+ * next hops that differ but have the same path metric.
+ */
+static uint32_t
+VerifyRoutes (const IncrementalRouting &routing, NodeContainer nodes, uint64_t &ties)
+{
+  std::map<uint32_t, uint32_t> owner; // address to table index
+  std::vector<Ipv4Address> destinations;
+  for (uint32_t n = 0; n < nodes.GetN (); ++n)
+    {
+      Ptr<Ipv4> ipv4 = nodes.Get (n)->GetObject<Ipv4> ();
+      for (uint32_t i = 1; i < ipv4->GetNInterfaces (); ++i)
+        {
+          for (uint32_t a = 0; a < ipv4->GetNAddresses (i); ++a)
+            {
+              owner[ipv4->GetAddress (i, a).GetLocal ().Get ()] = n;
+              if (ipv4->IsUp (i))
+                {
+                  destinations.push_back (ipv4->GetAddress (i, a).GetLocal ());
+                }
+            }
+        }
+    }
+
+  uint32_t mismatches = 0;
+  for (uint32_t s = 0; s < nodes.GetN (); ++s)
+    {
+      Ptr<Ipv4> ipv4 = nodes.Get (s)->GetObject<Ipv4> ();
+      Ptr<Ipv4GlobalRouting> global = GetGlobalRouting (ipv4);
+      for (std::size_t d = 0; d < destinations.size (); ++d)
+        {
+          Ipv4Address dest = destinations[d];
+          if (owner[dest.Get ()] == s || IsConnected (ipv4, dest))
+            {
+              continue;
+            }
+          Ipv4Header header;
+          header.SetDestination (dest);
+          Socket::SocketErrno sockerr;
+          Ptr<Ipv4Route> route = global->RouteOutput (0, header, 0, sockerr);
+          const IncrementalRouting::Hop *hop = routing.FindHop (s, dest);
+          if (hop && !ipv4->IsUp (hop->interface))
+            {
+              hop = 0;
+            }
+          if (!route && !hop)
+            {
+              continue;
+            }
+          if (route && hop && route->GetGateway () == hop->gateway)
+            {
+              continue;
+            }
+          if (route && hop && owner.count (route->GetGateway ().Get ()))
+            {
+              // Same cost through global routing's next hop
+              uint32_t via = routing.GetDistance (owner[route->GetGateway ().Get ()], dest);
+              uint32_t metric = ipv4->GetMetric (ipv4->GetInterfaceForDevice (route->GetOutputDevice ()));
+              if (via != IncrementalRouting::NO_ROUTE
+                  && static_cast<uint64_t> (via) + metric == routing.GetDistance (s, dest))
+                {
+                  ++ties;
+                  continue;
+                }
+            }
+          if (mismatches++ < 10)
+            {
+              std::cout << "  mismatch: node " << nodes.Get (s)->GetId () << " to " << dest
+                        << ": global via " << (route ? route->GetGateway () : Ipv4Address ())
+                        << ", incremental via " << (hop ? hop->gateway : Ipv4Address ()) << "\n";
+            }
+        }
+    }
+  return mismatches;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string topology = "leafspine";
+  uint32_t hosts = 500;
+  uint32_t leaves = 16;
+  uint32_t spines = 4;
+  uint32_t failures = 10;
+  bool global = true;
+  bool verify = true;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("topology", "leafspine or dumbbell", topology);
+  cmd.AddValue ("hosts", "Senders (and receivers)", hosts);
+  cmd.AddValue ("leaves", "Leaf switches for leafspine", leaves);
+  cmd.AddValue ("spines", "Spine switches for leafspine", spines);
+  cmd.AddValue ("failures", "Number of link failures to inject (each is restored)", failures);
+  cmd.AddValue ("global", "Also time Ipv4GlobalRoutingHelper::RecomputeRoutingTables", global);
+  cmd.AddValue ("verify", "Check incremental next hops against global routing after each change "
+                "(needs --global)", verify);
+  cmd.Parse (argc, argv);
+  verify = verify && global;
+
+  PointToPointHelper access;
+  access.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  access.SetChannelAttribute ("Delay", StringValue ("10us"));
+  PointToPointHelper core;
+  core.SetDeviceAttribute ("DataRate", StringValue ("10Gbps"));
+  core.SetChannelAttribute ("Delay", StringValue ("50us"));
+
+  TopologyBuilder topo;
+  if (topology == "leafspine")
+    {
+      topo.BuildLeafSpine (hosts, hosts, leaves, spines, access, core);
+    }
+  else if (topology == "dumbbell")
+    {
+      topo.BuildDumbbell (hosts, hosts, access, core, access);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown topology " << topology);
+    }
+  InternetStackHelper internet;
+  topo.InstallStack (internet);
+  topo.AssignIpv4Addresses (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.255.255.252"));
+  std::cout << topo.GetAll ().GetN () << " nodes, " << topo.GetNLinks () << " links\n";
+
+  IncrementalRouting routing;
+  routing.Install (topo.GetAll ());
+  std::cout << "Initial incremental tables: " << routing.GetLastSeconds () << " s\n";
+
+  if (global)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+      std::cout << "Initial global tables:      " << SecondsSince (start) << " s\n";
+    }
+
+  Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable> ();
+  double incrementalSeconds = 0;
+  double globalSeconds = 0;
+  uint64_t affected = 0;
+  uint32_t mismatches = 0;
+  uint64_t ties = 0;
+  if (verify)
+    {
+      mismatches += VerifyRoutes (routing, topo.GetAll (), ties);
+    }
+  for (uint32_t f = 0; f < failures; ++f)
+    {
+      NetDeviceContainer link = topo.GetCoreDevices (pick->GetInteger (0, topo.GetNCoreLinks () - 1));
+      for (int up = 0; up < 2; ++up)
+        {
+          if (up)
+            {
+              routing.SetLinkUp (link);
+            }
+          else
+            {
+              routing.SetLinkDown (link);
+            }
+          incrementalSeconds += routing.GetLastSeconds ();
+          affected += routing.GetLastAffected ();
+          if (global)
+            {
+              std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+              Ipv4GlobalRoutingHelper::RecomputeRoutingTables ();
+              globalSeconds += SecondsSince (start);
+            }
+          if (verify)
+            {
+              mismatches += VerifyRoutes (routing, topo.GetAll (), ties);
+            }
+        }
+    }
+
+  uint32_t changes = 2 * failures;
+  if (changes > 0)
+    {
+      std::cout << "Link changes:               " << changes << "\n";
+      std::cout << "Trees recomputed per change: " << double (affected) / changes
+                << " of " << routing.GetNNodes () << "\n";
+      std::cout << "Incremental per change:     " << incrementalSeconds / changes << " s\n";
+      if (global)
+        {
+          std::cout << "Global per change:          " << globalSeconds / changes << " s\n";
+        }
+    }
+
+  if (verify)
+    {
+      std::cout << "Route mismatches:           " << mismatches
+                << " (equal-cost ties: " << ties << ")\n";
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
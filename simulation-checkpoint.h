@@ -0,0 +1,157 @@
+#ifndef SIMULATION_CHECKPOINT_H
+#define SIMULATION_CHECKPOINT_H
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+
+namespace ns3 {
+
+/**
+ * Checkpoint a running simulation at a simulated time and branch it.
+ *
+ * ns-3 objects cannot be serialized, so the checkpoint is the process
+ * itself: at the checkpoint time it forks one child per branch.  Each
+ * child starts from an exact copy of the event queue, nodes, sockets,
+ * queues and random number streams, applies its branch's changes and runs
+ * to the end.  The parent holds the checkpoint, starting at most
+ * SetParallel children at a time, and exits when they are all done.  The
+ * warm-up before the checkpoint is therefore simulated once however many
+ * branches there are:
+ *
+ * \code
+ *   SimulationCheckpoint checkpoint;
+ *   checkpoint.AddBranch ("500kbps", MakeBoundCallback (&IncRate, app, DataRate ("500kbps")));
+ *   checkpoint.AddBranch ("1Mbps", MakeBoundCallback (&IncRate, app, DataRate ("1Mbps")));
+ *   checkpoint.Schedule (Seconds (30));
+ *   Simulator::Run ();       // returns in each branch; the parent never returns
+ *   ... write results named after checkpoint.GetBranch ()
+ * \endcode
+ *
+ * The checkpoint runs before the events scheduled for the same time
+ * after Schedule was called, which includes the applications' start
+ * events.  Standard output is flushed before forking; other open streams
+ * must be flushed by the scenario, or their buffers are written once per
+ * branch.  A process with helper threads (compressed pcap, binary trace
+ * sink) or MPI ranks cannot be forked this way.
+ */
+class SimulationCheckpoint
+{
+public:
+  SimulationCheckpoint ()
+    : m_parallel (1)
+  {
+  }
+
+  /// Run a branch that calls \p apply at the checkpoint
+  void
+  AddBranch (std::string name, Callback<void> apply)
+  {
+    Branch b;
+    b.name = name;
+    b.apply = apply;
+    m_branches.push_back (b);
+  }
+
+  /// Number of branches run at the same time (default 1)
+  void SetParallel (uint32_t parallel) { m_parallel = parallel > 0 ? parallel : 1; }
+
+  /**
+   * Redirect each branch's standard output to \<prefix\>\<name\>.out, so
+   * that parallel branches do not interleave.  By default branches share
+   * the parent's standard output.
+   */
+  void SetOutputPrefix (std::string prefix) { m_outputPrefix = prefix; }
+
+  /// Take the checkpoint at simulated time \p at (call before Simulator::Run)
+  void
+  Schedule (Time at)
+  {
+    NS_ABORT_MSG_IF (m_branches.empty (), "SimulationCheckpoint has no branches");
+    m_event = Simulator::Schedule (at, &SimulationCheckpoint::Fork, this);
+  }
+
+  /// Name of the branch this process runs, empty before the checkpoint
+  std::string GetBranch (void) const { return m_branch; }
+
+private:
+  struct Branch
+  {
+    std::string    name;
+    Callback<void> apply;
+  };
+
+  void
+  Fork (void)
+  {
+    std::cout.flush ();
+    std::cerr.flush ();
+    std::clog.flush ();
+    std::fflush (0);
+    std::cerr << "Checkpoint at " << Simulator::Now ().GetSeconds () << " s: "
+              << m_branches.size () << " branches\n";
+
+    std::map<pid_t, std::string> running;
+    bool failed = false;
+    for (std::size_t i = 0; i < m_branches.size (); ++i)
+      {
+        while (running.size () >= m_parallel)
+          {
+            failed |= !Reap (running);
+          }
+        pid_t pid = fork ();
+        NS_ABORT_MSG_IF (pid < 0, "Cannot fork branch " << m_branches[i].name);
+        if (pid == 0)
+          {
+            m_branch = m_branches[i].name;
+            if (!m_outputPrefix.empty ())
+              {
+                std::string file = m_outputPrefix + m_branch + ".out";
+                int fd = open (file.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                NS_ABORT_MSG_IF (fd < 0, "Cannot open " << file);
+                dup2 (fd, STDOUT_FILENO);
+                close (fd);
+              }
+            m_branches[i].apply ();
+            return;
+          }
+        running[pid] = m_branches[i].name;
+      }
+    while (!running.empty ())
+      {
+        failed |= !Reap (running);
+      }
+    // Nothing after the checkpoint belongs to the parent
+    _exit (failed ? 1 : 0);
+  }
+
+  // Wait for one branch to finish; false if it failed
+  static bool
+  Reap (std::map<pid_t, std::string> &running)
+  {
+    int status;
+    pid_t pid = wait (&status);
+    NS_ABORT_MSG_IF (pid < 0, "Lost track of the checkpoint branches");
+    bool ok = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+    std::cerr << "Branch " << running[pid] << (ok ? " done" : " failed") << "\n";
+    running.erase (pid);
+    return ok;
+  }
+
+  std::vector<Branch> m_branches;
+  uint32_t            m_parallel;
+  std::string         m_outputPrefix;
+  std::string         m_branch;
+  EventId             m_event;
+};
+
+} // namespace ns3
+
+#endif /* SIMULATION_CHECKPOINT_H */
@@ -0,0 +1,400 @@
+#ifndef SIMULATOR_PROFILER_H
+#define SIMULATOR_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include "ns3/core-module.h"
+
+namespace ns3 {
+
+/**
+ * Simulator implementation that runs DefaultSimulatorImpl and measures
+ * the wall time spent in each type of event.
+ *
+ * Every scheduled event is wrapped in a small forwarding event that
+ * remembers the type of the original one.  The type of an event is the
+ * type of the function it calls: "void (MyApp::*)()" for
+ * MyApp::SendPacket, "void (*)(Ptr<YansWifiPhy>, Ptr<WifiPpdu>, double)"
+ * for the YANS channel's receive.  Member functions of one class with the
+ * same signature, like TcpSocketBase's timers, therefore share a row.
+ * Rows are grouped by the ns-3 module (TypeId group) of the class, or of
+ * the first Ptr argument of a free function.
+ *
+ * At Simulator::Destroy the implementation prints a report ranked by
+ * total time to std::clog: events run, events per second of Run, and
+ * time per event type and per module.  With FlameGraphFile set it also
+ * writes "module;event microseconds" lines, the folded input of
+ * flamegraph.pl.
+ *
+ * It is only used when selected, so scenarios that do not enable it run
+ * exactly as before:
+ *
+ * \code
+ *   if (profile)
+ *     SimulatorProfiler::Enable ("prob1.folded");  // before anything is scheduled
+ * \endcode
+ */
+class ProfilingSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::ProfilingSimulatorImpl")
+      .SetParent<SimulatorImpl> ()
+      .SetGroupName ("Core")
+      .AddConstructor<ProfilingSimulatorImpl> ()
+      .AddAttribute ("FlameGraphFile",
+                     "File for folded flame graph stacks, empty for none",
+                     StringValue (""),
+                     MakeStringAccessor (&ProfilingSimulatorImpl::m_flameGraphFile),
+                     MakeStringChecker ())
+      .AddAttribute ("ReportRows",
+                     "Event types listed in the report",
+                     UintegerValue (25),
+                     MakeUintegerAccessor (&ProfilingSimulatorImpl::m_reportRows),
+                     MakeUintegerChecker<uint32_t> ())
+    ;
+    return tid;
+  }
+
+  ProfilingSimulatorImpl ()
+    : m_inner (CreateObject<DefaultSimulatorImpl> ()),
+      m_reportRows (25),
+      m_runSeconds (0)
+  {
+  }
+
+  virtual void
+  Destroy ()
+  {
+    m_inner->Destroy ();
+    Report (std::clog);
+    if (!m_flameGraphFile.empty ())
+      {
+        WriteFlameGraph (m_flameGraphFile);
+      }
+    for (std::size_t i = 0; i < m_types.size (); ++i)
+      {
+        delete m_types[i];
+      }
+    m_types.clear ();
+    m_typeIndex.clear ();
+  }
+
+  virtual bool IsFinished (void) const { return m_inner->IsFinished (); }
+  virtual void Stop (void) { m_inner->Stop (); }
+  virtual void Stop (const Time &delay) { m_inner->Stop (delay); }
+
+  virtual EventId
+  Schedule (const Time &delay, EventImpl *event)
+  {
+    return m_inner->Schedule (delay, Wrap (event));
+  }
+
+  virtual void
+  ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+  {
+    m_inner->ScheduleWithContext (context, delay, Wrap (event));
+  }
+
+  virtual EventId
+  ScheduleNow (EventImpl *event)
+  {
+    return m_inner->ScheduleNow (Wrap (event));
+  }
+
+  virtual EventId
+  ScheduleDestroy (EventImpl *event)
+  {
+    return m_inner->ScheduleDestroy (Wrap (event));
+  }
+
+  virtual void Remove (const EventId &id) { m_inner->Remove (id); }
+  virtual void Cancel (const EventId &id) { m_inner->Cancel (id); }
+  virtual bool IsExpired (const EventId &id) const { return m_inner->IsExpired (id); }
+
+  virtual void
+  Run (void)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    m_inner->Run ();
+    std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+    m_runSeconds += d.count ();
+  }
+
+  virtual Time Now (void) const { return m_inner->Now (); }
+  virtual Time GetDelayLeft (const EventId &id) const { return m_inner->GetDelayLeft (id); }
+  virtual Time GetMaximumSimulationTime (void) const { return m_inner->GetMaximumSimulationTime (); }
+  virtual void SetScheduler (ObjectFactory schedulerFactory) { m_inner->SetScheduler (schedulerFactory); }
+  virtual uint32_t GetSystemId (void) const { return m_inner->GetSystemId (); }
+  virtual uint32_t GetContext (void) const { return m_inner->GetContext (); }
+  virtual uint64_t GetEventCount (void) const { return m_inner->GetEventCount (); }
+
+protected:
+  virtual void
+  DoDispose (void)
+  {
+    m_inner = 0;
+    SimulatorImpl::DoDispose ();
+  }
+
+private:
+  struct EventType
+  {
+    EventType () : count (0), nanoseconds (0) {}
+    std::string mangled;
+    uint64_t    count;
+    uint64_t    nanoseconds;
+  };
+
+  // Forwards to the original event and charges its run time to its type
+  class ProfiledEvent : public EventImpl
+  {
+  public:
+    ProfiledEvent (EventImpl *event, EventType *type)
+      : m_event (event, false),
+        m_type (type)
+    {
+    }
+
+  protected:
+    virtual void
+    Notify (void)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      m_event->Invoke ();
+      std::chrono::nanoseconds d = std::chrono::duration_cast<std::chrono::nanoseconds> (
+          std::chrono::steady_clock::now () - start);
+      ++m_type->count;
+      m_type->nanoseconds += d.count ();
+    }
+
+  private:
+    Ptr<EventImpl> m_event;
+    EventType     *m_type;
+  };
+
+  EventImpl *
+  Wrap (EventImpl *event)
+  {
+    std::type_index key (typeid (*event));
+    std::unordered_map<std::type_index, EventType *>::iterator i = m_typeIndex.find (key);
+    if (i == m_typeIndex.end ())
+      {
+        EventType *type = new EventType;
+        type->mangled = key.name ();
+        m_types.push_back (type);
+        i = m_typeIndex.insert (std::make_pair (key, type)).first;
+      }
+    return new ProfiledEvent (event, i->second);
+  }
+
+  static void
+  ReplaceAll (std::string &s, const std::string &from, const std::string &to)
+  {
+    for (std::size_t p = s.find (from); p != std::string::npos; p = s.find (from, p + to.size ()))
+      {
+        s.replace (p, from.size (), to);
+      }
+  }
+
+  // The function type from "MakeEvent<function, args...>(...)::EventImpl"
+  // without the ns3:: prefixes, and the module of its class.
+  static void
+  Describe (const std::string &mangled, std::string &label, std::string &module)
+  {
+    int status;
+    char *demangled = abi::__cxa_demangle (mangled.c_str (), 0, 0, &status);
+    std::string name = status == 0 ? demangled : mangled;
+    std::free (demangled);
+
+    label = name;
+    std::size_t begin = name.find ("MakeEvent<");
+    if (begin != std::string::npos)
+      {
+        begin += 10;
+        int depth = 0;
+        std::size_t end = begin;
+        for (; end < name.size (); ++end)
+          {
+            char c = name[end];
+            if (c == '<' || c == '(')
+              {
+                ++depth;
+              }
+            else if (c == ')' || (c == '>' && depth > 0))
+              {
+                --depth;
+              }
+            else if ((c == ',' || c == '>') && depth == 0)
+              {
+                break;
+              }
+          }
+        label = name.substr (begin, end - begin);
+      }
+
+    // Class of a member function, else the first Ptr<> argument
+    std::string cls;
+    std::size_t member = label.find ("::*)");
+    if (member != std::string::npos)
+      {
+        std::size_t open = label.rfind ('(', member);
+        cls = label.substr (open + 1, member - open - 1);
+      }
+    else
+      {
+        std::size_t ptr = label.find ("ns3::Ptr<");
+        if (ptr != std::string::npos)
+          {
+            std::size_t close = label.find_first_of (">,", ptr + 9);
+            cls = label.substr (ptr + 9, close - ptr - 9);
+          }
+      }
+    ReplaceAll (cls, " const", "");
+    TypeId tid;
+    if (!cls.empty () && TypeId::LookupByNameFailSafe (cls, &tid))
+      {
+        module = tid.GetGroupName ();
+      }
+    else
+      {
+        module = member != std::string::npos ? "Scenario" : "Functions";
+      }
+    ReplaceAll (label, "ns3::", "");
+  }
+
+  struct Row
+  {
+    Row () : count (0), nanoseconds (0) {}
+    std::string label;
+    std::string module;
+    uint64_t    count;
+    uint64_t    nanoseconds;
+    bool operator< (const Row &o) const { return nanoseconds > o.nanoseconds; }
+  };
+
+  std::vector<Row>
+  Rows (void) const
+  {
+    std::vector<Row> rows;
+    for (std::size_t i = 0; i < m_types.size (); ++i)
+      {
+        if (m_types[i]->count == 0)
+          {
+            continue;
+          }
+        Row r;
+        Describe (m_types[i]->mangled, r.label, r.module);
+        r.count = m_types[i]->count;
+        r.nanoseconds = m_types[i]->nanoseconds;
+        rows.push_back (r);
+      }
+    std::sort (rows.begin (), rows.end ());
+    return rows;
+  }
+
+  void
+  Report (std::ostream &os) const
+  {
+    std::vector<Row> rows = Rows ();
+    uint64_t events = 0;
+    uint64_t nanoseconds = 0;
+    std::map<std::string, Row> modules;
+    for (std::size_t i = 0; i < rows.size (); ++i)
+      {
+        events += rows[i].count;
+        nanoseconds += rows[i].nanoseconds;
+        Row &m = modules[rows[i].module];
+        m.module = rows[i].module;
+        m.count += rows[i].count;
+        m.nanoseconds += rows[i].nanoseconds;
+      }
+    double total = nanoseconds > 0 ? nanoseconds : 1;
+
+    std::ios::fmtflags flags = os.flags ();
+    os << std::fixed << std::setprecision (1);
+    os << "Simulator profile: " << events << " events in " << m_runSeconds << " s of Run, "
+       << std::setprecision (0) << (m_runSeconds > 0 ? events / m_runSeconds : 0) << " events/s, "
+       << std::setprecision (1) << nanoseconds / 1e6 << " ms in event handlers\n";
+    os << "   ms       %     events   ns/event  module          event\n";
+    for (std::size_t i = 0; i < rows.size () && i < m_reportRows; ++i)
+      {
+        PrintRow (os, rows[i], total);
+        os << "  " << rows[i].label << "\n";
+      }
+    std::vector<Row> byModule;
+    for (std::map<std::string, Row>::iterator m = modules.begin (); m != modules.end (); ++m)
+      {
+        byModule.push_back (m->second);
+      }
+    std::sort (byModule.begin (), byModule.end ());
+    os << "By module:\n";
+    for (std::size_t i = 0; i < byModule.size (); ++i)
+      {
+        PrintRow (os, byModule[i], total);
+        os << "\n";
+      }
+    os.flags (flags);
+  }
+
+  static void
+  PrintRow (std::ostream &os, const Row &r, double total)
+  {
+    os << std::setw (8) << r.nanoseconds / 1e6
+       << std::setw (7) << 100.0 * r.nanoseconds / total
+       << std::setw (11) << r.count
+       << std::setw (11) << double (r.nanoseconds) / r.count
+       << "  " << std::left << std::setw (14) << r.module << std::right;
+  }
+
+  void
+  WriteFlameGraph (std::string fileName) const
+  {
+    std::ofstream out (fileName.c_str ());
+    std::vector<Row> rows = Rows ();
+    for (std::size_t i = 0; i < rows.size (); ++i)
+      {
+        std::string label = rows[i].label;
+        ReplaceAll (label, ";", ",");
+        out << rows[i].module << ";" << label << " " << rows[i].nanoseconds / 1000 << "\n";
+      }
+  }
+
+  Ptr<SimulatorImpl>                                m_inner;
+  std::string                                       m_flameGraphFile;
+  uint32_t                                          m_reportRows;
+  double                                            m_runSeconds;
+  std::vector<EventType *>                          m_types;
+  std::unordered_map<std::type_index, EventType *>  m_typeIndex;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ProfilingSimulatorImpl);
+
+/// Selects ProfilingSimulatorImpl; call before the first event is scheduled.
+class SimulatorProfiler
+{
+public:
+  static void
+  Enable (std::string flameGraphFile = "")
+  {
+    GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::ProfilingSimulatorImpl"));
+    Config::SetDefault ("ns3::ProfilingSimulatorImpl::FlameGraphFile", StringValue (flameGraphFile));
+  }
+};
+
+} // namespace ns3
+
+#endif /* SIMULATOR_PROFILER_H */
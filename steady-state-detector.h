@@ -0,0 +1,256 @@
+#ifndef STEADY_STATE_DETECTOR_H
+#define STEADY_STATE_DETECTOR_H
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/applications-module.h"
+
+namespace ns3 {
+
+/**
+ * Stops the simulation once the chosen metrics have settled.
+ *
+ * Every interval after the warm-up one event samples each metric: a rate
+ * is the increase of a counter over the interval (per second), a level
+ * the value of a probe.  Once every metric has k * minBatchSize samples
+ * they are split into k batches of equal size, and the 95% confidence
+ * interval of the mean is computed from the batch means with Student's t
+ * for k - 1 degrees of freedom.  As the run goes on the batches grow, and
+ * their means become nearly independent.  When the half width of every
+ * interval is within the target fraction of its mean, the simulation is
+ * stopped; the scenario's own Simulator::Stop remains the upper bound.
+ * A metric whose mean is within MinMean of zero never counts as settled:
+ * a relative width means nothing there, and a flow that has stopped
+ * altogether would otherwise look perfectly steady.
+ *
+ * \code
+ *   SteadyStateDetector detector;
+ *   detector.AddSinkGoodput ("n3", DynamicCast<PacketSink> (sinkApps.Get (0)));
+ *   detector.SetWarmup (Seconds (15));
+ *   detector.SetRelativeWidth (0.05);
+ *   detector.Start ();
+ *   Simulator::Run ();
+ *   detector.Report (std::cout);
+ * \endcode
+ */
+class SteadyStateDetector
+{
+public:
+  SteadyStateDetector ()
+    : m_interval (MilliSeconds (100)),
+      m_warmup (Seconds (0)),
+      m_batches (10),
+      m_minBatchSize (5),
+      m_relativeWidth (0.05),
+      m_minMean (0),
+      m_converged (false)
+  {
+  }
+
+  /// Metric is the increase of \p counter per second, times \p scale
+  void
+  AddRate (std::string name, Callback<double> counter, double scale = 1)
+  {
+    Metric m (name, counter, true, scale);
+    m_metrics.push_back (m);
+  }
+
+  /// Metric is the value of \p probe at each sample
+  void
+  AddLevel (std::string name, Callback<double> probe)
+  {
+    Metric m (name, probe, false, 1);
+    m_metrics.push_back (m);
+  }
+
+  /// Goodput of \p sink in Mb/s
+  void
+  AddSinkGoodput (std::string name, Ptr<PacketSink> sink)
+  {
+    AddRate (name, MakeBoundCallback (&SteadyStateDetector::SinkRx, sink), 8e-6);
+  }
+
+  void SetInterval (Time interval) { m_interval = interval; }
+  /// Samples before \p warmup are not used
+  void SetWarmup (Time warmup) { m_warmup = warmup; }
+  /// Number of batches k (at least 2) and samples per batch before testing
+  void
+  SetBatches (uint32_t batches, uint32_t minBatchSize)
+  {
+    NS_ABORT_MSG_IF (batches < 2 || minBatchSize < 1, "Batch means need two batches of at least one sample");
+    m_batches = batches;
+    m_minBatchSize = minBatchSize;
+  }
+  /// Target half width of each confidence interval, as a fraction of the mean
+  void SetRelativeWidth (double width) { m_relativeWidth = width; }
+  /// Means of at most \p minMean in magnitude do not settle (default 0)
+  void SetMinMean (double minMean) { m_minMean = minMean; }
+
+  void
+  Start (void)
+  {
+    NS_ABORT_MSG_IF (m_metrics.empty (), "SteadyStateDetector has no metrics");
+    m_event = Simulator::Schedule (m_warmup, &SteadyStateDetector::Sample, this);
+  }
+
+  bool HasConverged (void) const { return m_converged; }
+
+  void
+  Report (std::ostream &os) const
+  {
+    double end = m_converged ? m_stopTime.GetSeconds () : Simulator::Now ().GetSeconds ();
+    if (m_converged)
+      {
+        os << "Steady state after " << end << " s simulated\n";
+      }
+    else
+      {
+        os << "No steady state within " << end << " s simulated (target +/-"
+           << m_relativeWidth * 100 << "%)\n";
+      }
+    for (std::size_t i = 0; i < m_metrics.size (); ++i)
+      {
+        Interval ci = Estimate (m_metrics[i]);
+        os << "  " << std::left << std::setw (16) << m_metrics[i].name << std::right
+           << ci.mean << " +/- " << ci.halfWidth;
+        if (ci.mean != 0)
+          {
+            os << " (" << 100 * ci.halfWidth / std::fabs (ci.mean) << "%)";
+          }
+        os << ", " << m_batches << " batches of " << ci.batchSize << " samples\n";
+      }
+  }
+
+  /// Two-sided 95% quantile of Student's t with \p df degrees of freedom
+  static double
+  StudentT (uint32_t df)
+  {
+    static const double t[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    return df <= 30 ? t[df - 1] : 1.960 + 2.4 / df;
+  }
+
+private:
+  struct Metric
+  {
+    Metric (std::string n, Callback<double> p, bool r, double s)
+      : name (n), probe (p), rate (r), scale (s), last (0)
+    {
+    }
+    std::string         name;
+    Callback<double>    probe;
+    bool                rate;
+    double              scale;
+    double              last;      //!< counter at the previous sample
+    std::vector<double> samples;
+  };
+
+  struct Interval
+  {
+    Interval () : mean (0), halfWidth (0), batchSize (0) {}
+    double   mean;
+    double   halfWidth;
+    uint32_t batchSize;
+  };
+
+  static double
+  SinkRx (Ptr<PacketSink> sink)
+  {
+    return sink->GetTotalRx ();
+  }
+
+  // Batch means over the latest k * b samples
+  Interval
+  Estimate (const Metric &m) const
+  {
+    Interval ci;
+    ci.batchSize = m.samples.size () / m_batches;
+    if (ci.batchSize == 0)
+      {
+        return ci;
+      }
+    std::size_t first = m.samples.size () - ci.batchSize * m_batches;
+    std::vector<double> means (m_batches, 0);
+    for (uint32_t k = 0; k < m_batches; ++k)
+      {
+        for (uint32_t j = 0; j < ci.batchSize; ++j)
+          {
+            means[k] += m.samples[first + k * ci.batchSize + j];
+          }
+        means[k] /= ci.batchSize;
+        ci.mean += means[k];
+      }
+    ci.mean /= m_batches;
+    double var = 0;
+    for (uint32_t k = 0; k < m_batches; ++k)
+      {
+        var += (means[k] - ci.mean) * (means[k] - ci.mean);
+      }
+    var /= m_batches - 1;
+    ci.halfWidth = StudentT (m_batches - 1) * std::sqrt (var / m_batches);
+    return ci;
+  }
+
+  void
+  Sample (void)
+  {
+    bool ready = true;
+    for (std::size_t i = 0; i < m_metrics.size (); ++i)
+      {
+        Metric &m = m_metrics[i];
+        double value = m.probe ();
+        if (m.rate)
+          {
+            // The first call only reads the counter at the end of the warm-up
+            if (Simulator::Now () > m_warmup)
+              {
+                m.samples.push_back ((value - m.last) * m.scale / m_interval.GetSeconds ());
+              }
+            m.last = value;
+          }
+        else
+          {
+            m.samples.push_back (value);
+          }
+        ready = ready && m.samples.size () >= m_batches * m_minBatchSize;
+      }
+
+    if (ready)
+      {
+        bool settled = true;
+        for (std::size_t i = 0; i < m_metrics.size () && settled; ++i)
+          {
+            Interval ci = Estimate (m_metrics[i]);
+            settled = std::fabs (ci.mean) > m_minMean && ci.halfWidth <= m_relativeWidth * std::fabs (ci.mean);
+          }
+        if (settled)
+          {
+            m_converged = true;
+            m_stopTime = Simulator::Now ();
+            Simulator::Stop ();
+            return;
+          }
+      }
+    m_event = Simulator::Schedule (m_interval, &SteadyStateDetector::Sample, this);
+  }
+
+  std::vector<Metric> m_metrics;
+  Time                m_interval;
+  Time                m_warmup;
+  uint32_t            m_batches;
+  uint32_t            m_minBatchSize;
+  double              m_relativeWidth;
+  double              m_minMean;
+  bool                m_converged;
+  Time                m_stopTime;
+  EventId             m_event;
+};
+
+} // namespace ns3
+
+#endif /* STEADY_STATE_DETECTOR_H */
@@ -10,6 +10,7 @@
 // - TCP flow from n2 to n4
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -19,117 +20,20 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 
+#include "my-app.h"
+#include "topology-builder.h"
+#include "simulation-checkpoint.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("Problem 1");
 
-class MyApp : public Application
-{
-public:
-
-  MyApp ();
-  virtual ~MyApp();
-
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-  void ChangeRate(DataRate newrate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-};
-
-MyApp::MyApp ()
-  : m_socket (0),
-    m_peer (),
-    m_packetSize (0),
-    m_nPackets (0),
-    m_dataRate (0),
-    m_sendEvent (),
-    m_running (false),
-    m_packetsSent (0)
-{
-}
-
-MyApp::~MyApp()
-{
-  m_socket = 0;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void
-MyApp::StartApplication (void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  m_socket->Bind ();
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
-
-void
-MyApp::StopApplication (void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
-    {
-      Simulator::Cancel (m_sendEvent);
-    }
-
-  if (m_socket)
-    {
-      m_socket->Close ();
-    }
-}
-
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
-
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
-}
-
-void
-MyApp::ScheduleTx (void)
-{
-  if (m_running)
-    {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
-    }
-}
-
-void
-MyApp::ChangeRate(DataRate newrate)
+// Branch of the checkpoint at 15 s: n2's flows start at this rate
+static void
+SetSecondFlowRate (Ptr<MyApp> app2, Ptr<MyApp> app3, DataRate rate)
 {
-   m_dataRate = newrate;
-   return;
+  app2->ChangeRate (rate);
+  app3->ChangeRate (rate);
 }
 
 static void
@@ -144,60 +48,36 @@ int main (int argc, char *argv[])
   std::string lat = "2ms";
   std::string rate = "500kb/s"; // P2P link
   bool enableFlowMonitor = false;
+  std::string branchRates = "";
+  uint32_t branchParallel = 1;
 
 
   CommandLine cmd;
   cmd.AddValue ("latency", "P2P link Latency in miliseconds", lat);
   cmd.AddValue ("rate", "P2P data rate in bps", rate);
   cmd.AddValue ("EnableMonitor", "Enable Flow Monitor", enableFlowMonitor);
+  cmd.AddValue ("branchRates", "Comma-separated rates for n2's flows; each one is a branch of a single warm-up to 15 s", branchRates);
+  cmd.AddValue ("branchParallel", "Branches run at the same time with --branchRates", branchParallel);
 
   cmd.Parse (argc, argv);
 
-// Make Topology
-  NS_LOG_INFO ("Create nodes.");
-  NodeContainer nodeGroup; // ALL Nodes
-  nodeGroup.Create(6);
-
-  NodeContainer n1n5 = NodeContainer (nodeGroup.Get (0), nodeGroup.Get (4));
-  NodeContainer n2n5 = NodeContainer (nodeGroup.Get (1), nodeGroup.Get (4));
-  NodeContainer n3n6 = NodeContainer (nodeGroup.Get (2), nodeGroup.Get (5));
-  NodeContainer n4n6 = NodeContainer (nodeGroup.Get (3), nodeGroup.Get (5));
-  NodeContainer n5n6 = NodeContainer (nodeGroup.Get (4), nodeGroup.Get (5));
-
-
-
-// Install Internet Stack
-  InternetStackHelper internet;
-  internet.Install (nodeGroup);
-
-// Create the channels first without any IP addressing information
-  NS_LOG_INFO ("Create channels.");
+// Make Topology: n1, n2 on the left, n3, n4 on the right, routers n5, n6
+  NS_LOG_INFO ("Create topology.");
   PointToPointHelper p2p;
   p2p.SetDeviceAttribute ("DataRate", StringValue (rate));
   p2p.SetChannelAttribute ("Delay", StringValue (lat));
-  NetDeviceContainer d1d5 = p2p.Install (n1n5);
-  NetDeviceContainer d2d5 = p2p.Install (n2n5);
-  NetDeviceContainer d5d6 = p2p.Install (n5n6);
-  NetDeviceContainer d3d6 = p2p.Install (n3n6);
-  NetDeviceContainer d4d6 = p2p.Install (n4n6);
-
-// Assign IP addresses
-  NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer i1i5 = ipv4.Assign (d1d5);
-
-  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer i2i5 = ipv4.Assign (d2d5);
 
-  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer i5i6 = ipv4.Assign (d5d6);
+  TopologyBuilder topo;
+  topo.BuildDumbbell (2, 2, p2p, p2p, p2p);
+  NodeContainer nodeGroup = topo.GetAll (); // ALL Nodes
 
-  ipv4.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer i3i6 = ipv4.Assign (d3d6);
+// Install Internet Stack
+  InternetStackHelper internet;
+  topo.InstallStack (internet);
 
-  ipv4.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer i4i6 = ipv4.Assign (d4d6);
+// Assign IP addresses, one /24 per link from 10.1.1.0
+  NS_LOG_INFO ("Assign IP Addresses.");
+  topo.AssignIpv4Addresses (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"));
 
   NS_LOG_INFO ("Enable static global routing.");
 
@@ -211,7 +91,7 @@ int main (int argc, char *argv[])
 //////////////////////////////////////
   // TCP connfection from n1 to n3
   uint16_t sinkPort = 8080;
-  Address sinkAddress (InetSocketAddress (i3i6.GetAddress (0), sinkPort)); // interface of n3
+  Address sinkAddress (InetSocketAddress (topo.GetRightAddress (0), sinkPort)); // interface of n3
   PacketSinkHelper packetSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
   ApplicationContainer sinkApps = packetSinkHelper.Install (nodeGroup.Get (2)); //n3 as sink
   sinkApps.Start (Seconds (0.));
@@ -247,7 +127,7 @@ int main (int argc, char *argv[])
 ///////////////////////////////////////
   // TCP connfection from n2 to n4
 
-  Address sinkAddress2 (InetSocketAddress (i4i6.GetAddress (0), sinkPort)); // interface of n4
+  Address sinkAddress2 (InetSocketAddress (topo.GetRightAddress (1), sinkPort)); // interface of n4
   ApplicationContainer sinkApps2 = packetSinkHelper.Install (nodeGroup.Get (3)); //n4 as sink
   sinkApps2.Start (Seconds (0.));
   sinkApps2.Stop (Seconds (100.));
@@ -265,7 +145,23 @@ int main (int argc, char *argv[])
   app3->SetStopTime (Seconds (100.));
 ////////////////////////////////////////////
 
-
+  // Simulate the single-flow warm-up once and branch when n2's flows start
+  SimulationCheckpoint checkpoint;
+  if (!branchRates.empty ())
+    {
+      std::istringstream rates (branchRates);
+      std::string r;
+      while (std::getline (rates, r, ','))
+        {
+          checkpoint.AddBranch (r, MakeBoundCallback (&SetSecondFlowRate, app2, app3, DataRate (r)));
+        }
+      checkpoint.SetParallel (branchParallel);
+      if (branchParallel > 1)
+        {
+          checkpoint.SetOutputPrefix ("tcp-queue-");
+        }
+      checkpoint.Schedule (Seconds (15.));
+    }
 
 
   // Flow Monitor
@@ -285,7 +181,8 @@ int main (int argc, char *argv[])
   if (enableFlowMonitor)
     {
 	  flowmon->CheckForLostPackets ();
-	  flowmon->SerializeToXmlFile("lab-2.flowmon", true, true);
+	  std::string name = checkpoint.GetBranch ().empty () ? "lab-2" : "lab-2-" + checkpoint.GetBranch ();
+	  flowmon->SerializeToXmlFile(name + ".flowmon", true, true);
     }
   Simulator::Destroy ();
   NS_LOG_INFO ("Done.");
@@ -0,0 +1,232 @@
+#ifndef TCP_SOCKET_HOOK_H
+#define TCP_SOCKET_HOOK_H
+
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+class TcpSocketHook;
+
+/**
+ * SocketFactory for TCP sockets that reports every socket it creates to a
+ * TcpSocketHook.  Installed by TcpSocketHook::Install.  It is not a
+ * TcpSocketFactory, so only applications that ask for it by TypeId get
+ * hooked sockets.
+ */
+class HookedTcpSocketFactory : public SocketFactory
+{
+public:
+  static TypeId
+  GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::HookedTcpSocketFactory")
+      .SetParent<SocketFactory> ()
+      .SetGroupName ("Internet")
+      .AddConstructor<HookedTcpSocketFactory> ()
+    ;
+    return tid;
+  }
+
+  HookedTcpSocketFactory ()
+    : m_hook (0)
+  {
+  }
+
+  void
+  Setup (TcpSocketHook *hook, Ptr<TcpL4Protocol> tcp)
+  {
+    m_hook = hook;
+    m_tcp = tcp;
+  }
+
+  virtual Ptr<Socket> CreateSocket (void);
+
+protected:
+  virtual void
+  DoDispose (void)
+  {
+    m_tcp = 0;
+    SocketFactory::DoDispose ();
+  }
+
+private:
+  TcpSocketHook     *m_hook;
+  Ptr<TcpL4Protocol> m_tcp;
+};
+
+/**
+ * Notification of every TCP socket created on a set of nodes, from the
+ * moment it exists.
+ *
+ * TcpL4Protocol has no socket-creation trace, and BulkSend and PacketSink
+ * create their sockets lazily, so the hook sits where applications get
+ * their sockets: Install aggregates a HookedTcpSocketFactory to each node,
+ * and applications that name "ns3::HookedTcpSocketFactory" instead of
+ * "ns3::TcpSocketFactory" get their sockets from it.  It creates the
+ * socket through TcpL4Protocol as usual and hands it to the callback
+ * before returning it, so tracers are attached before the socket binds or
+ * connects.  Nothing is polled, scanned or scheduled, and no socket is
+ * referenced after the callback returns.
+ *
+ * \code
+ *   BulkSendHelper source ("ns3::HookedTcpSocketFactory", sinkAddress);
+ *   ...
+ *   TcpSocketHook hook;
+ *   hook.SetNewSocketCallback (MakeCallback (&OnNewSocket));
+ *   hook.Install (senders);    // after InternetStackHelper::Install
+ * \endcode
+ *
+ * The callback gets a flow id, numbered from 0 in order of creation.
+ * Listening sockets are reported too; the sockets a listener forks for
+ * the connections it accepts are copies made inside the stack and are
+ * not, so hook the connecting side of a flow.  The hook must outlive
+ * Simulator::Run.
+ */
+class TcpSocketHook
+{
+public:
+  typedef Callback<void, uint32_t, Ptr<TcpSocketBase> > NewSocketCallback;
+
+  TcpSocketHook ()
+    : m_nextFlowId (0)
+  {
+  }
+
+  void
+  SetNewSocketCallback (NewSocketCallback cb)
+  {
+    m_newSocket = cb;
+  }
+
+  void
+  Install (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        Ptr<Node> node = *i;
+        Ptr<TcpL4Protocol> tcp = node->GetObject<TcpL4Protocol> ();
+        NS_ABORT_MSG_UNLESS (tcp, "TcpSocketHook needs the internet stack on node " << node->GetId ());
+        NS_ABORT_MSG_IF (node->GetObject<HookedTcpSocketFactory> (), "TcpSocketHook already installed on node " << node->GetId ());
+        Ptr<HookedTcpSocketFactory> factory = CreateObject<HookedTcpSocketFactory> ();
+        factory->Setup (this, tcp);
+        node->AggregateObject (factory);
+      }
+  }
+
+  uint32_t
+  GetNSockets (void) const
+  {
+    return m_nextFlowId;
+  }
+
+private:
+  friend class HookedTcpSocketFactory;
+
+  void
+  Created (Ptr<Socket> socket)
+  {
+    Ptr<TcpSocketBase> tcpSocket = DynamicCast<TcpSocketBase> (socket);
+    if (!tcpSocket)
+      {
+        return;
+      }
+    uint32_t flowId = m_nextFlowId++;
+    if (!m_newSocket.IsNull ())
+      {
+        m_newSocket (flowId, tcpSocket);
+      }
+  }
+
+  NewSocketCallback m_newSocket;
+  uint32_t          m_nextFlowId;
+};
+
+inline Ptr<Socket>
+HookedTcpSocketFactory::CreateSocket (void)
+{
+  Ptr<Socket> socket = m_tcp->CreateSocket ();
+  m_hook->Created (socket);
+  return socket;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (HookedTcpSocketFactory);
+
+/**
+ * Writes congestion window, slow start threshold, RTT and pacing rate
+ * changes of any number of TCP sockets to one file, one line per change:
+ *
+ *   time  flow  metric  value
+ *
+ * Pass Attach to TcpSocketHook::SetNewSocketCallback (via MakeCallback
+ * with this object) to trace every flow from the moment its socket exists.
+ */
+class TcpFlowTracer
+{
+public:
+  bool
+  Open (std::string fileName)
+  {
+    m_out.open (fileName.c_str (), std::ios::out);
+    m_out << "#Time(s)\tflow\tmetric\tvalue\n" << std::fixed << std::setprecision (6);
+    return m_out.good ();
+  }
+
+  void
+  Close (void)
+  {
+    m_out.close ();
+  }
+
+  void Flush (void) { m_out.flush (); }
+
+  void
+  Attach (uint32_t flowId, Ptr<TcpSocketBase> socket)
+  {
+    socket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&TcpFlowTracer::Cwnd, this, flowId));
+    socket->TraceConnectWithoutContext ("SlowStartThreshold", MakeBoundCallback (&TcpFlowTracer::SsThresh, this, flowId));
+    socket->TraceConnectWithoutContext ("RTT", MakeBoundCallback (&TcpFlowTracer::Rtt, this, flowId));
+    socket->TraceConnectWithoutContext ("PacingRate", MakeBoundCallback (&TcpFlowTracer::PacingRate, this, flowId));
+  }
+
+private:
+  void
+  Write (uint32_t flowId, const char *metric, double value)
+  {
+    m_out << Simulator::Now ().GetSeconds () << "\t" << flowId << "\t" << metric << "\t" << value << "\n";
+  }
+
+  static void
+  Cwnd (TcpFlowTracer *t, uint32_t flowId, uint32_t oldval, uint32_t newval)
+  {
+    t->Write (flowId, "cwnd", newval);
+  }
+
+  static void
+  SsThresh (TcpFlowTracer *t, uint32_t flowId, uint32_t oldval, uint32_t newval)
+  {
+    t->Write (flowId, "ssthresh", newval);
+  }
+
+  static void
+  Rtt (TcpFlowTracer *t, uint32_t flowId, Time oldval, Time newval)
+  {
+    t->Write (flowId, "rtt", newval.GetSeconds ());
+  }
+
+  static void
+  PacingRate (TcpFlowTracer *t, uint32_t flowId, DataRate oldval, DataRate newval)
+  {
+    t->Write (flowId, "pacingRate", newval.GetBitRate () / 1e6);
+  }
+
+  std::ofstream m_out;
+};
+
+} // namespace ns3
+
+#endif /* TCP_SOCKET_HOOK_H */
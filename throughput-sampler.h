@@ -0,0 +1,180 @@
+#ifndef THROUGHPUT_SAMPLER_H
+#define THROUGHPUT_SAMPLER_H
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+
+namespace ns3 {
+
+/**
+ * Periodic goodput sampler for any number of PacketSinks, or of other
+ * receivers that count the bytes they have received.
+ *
+ * All registered sinks are read from one self-rescheduling event, so a
+ * scenario with N sinks costs one event per interval rather than N.  Each
+ * sample is one line of the output file:
+ *
+ *   time  aggregate  sink0  sink1 ...
+ *
+ * with goodput in Mb/s over the preceding interval.  The header line names
+ * each sink by node id and application index.
+ */
+class ThroughputSampler
+{
+public:
+  ThroughputSampler ()
+    : m_interval (MilliSeconds (100))
+  {
+  }
+
+  void
+  Add (Ptr<PacketSink> sink, std::string name)
+  {
+    Add (MakeCallback (&PacketSink::GetTotalRx, sink), name);
+  }
+
+  /// Register a receiver whose \p totalRx returns the bytes received so far.
+  void
+  Add (Callback<uint64_t> totalRx, std::string name)
+  {
+    m_counters.push_back (totalRx);
+    m_names.push_back (name);
+    m_lastRx.push_back (0);
+  }
+
+  /// Register every PacketSink in \p apps; other applications are skipped.
+  void
+  Add (ApplicationContainer apps)
+  {
+    for (ApplicationContainer::Iterator i = apps.Begin (); i != apps.End (); ++i)
+      {
+        Ptr<PacketSink> sink = DynamicCast<PacketSink> (*i);
+        if (sink)
+          {
+            Add (sink, SinkName (sink));
+          }
+      }
+  }
+
+  /// Register every PacketSink installed on \p nodes.
+  void
+  Add (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        for (uint32_t a = 0; a < (*n)->GetNApplications (); ++a)
+          {
+            Ptr<PacketSink> sink = DynamicCast<PacketSink> ((*n)->GetApplication (a));
+            if (sink)
+              {
+                Add (sink, SinkName (sink));
+              }
+          }
+      }
+  }
+
+  /**
+   * \param start beginning of the first interval; its row is written at
+   *        start + interval
+   * \param interval sampling period
+   * \param fileName output file
+   */
+  void
+  Start (Time start, Time interval, std::string fileName)
+  {
+    m_interval = interval;
+    m_out.open (fileName.c_str (), std::ios::out);
+    m_out << "#Time(s)\taggregate(Mb/s)";
+    for (std::size_t i = 0; i < m_names.size (); ++i)
+      {
+        m_out << "\t" << m_names[i];
+      }
+    m_out << "\n" << std::fixed << std::setprecision (6);
+    m_row.resize (m_counters.size ());
+    m_event = Simulator::Schedule (start, &ThroughputSampler::Begin, this);
+  }
+
+  void
+  Stop (void)
+  {
+    m_event.Cancel ();
+    if (m_out.is_open ())
+      {
+        m_out.close ();
+      }
+  }
+
+  std::size_t
+  GetNSinks (void) const
+  {
+    return m_counters.size ();
+  }
+
+private:
+  static std::string
+  SinkName (Ptr<PacketSink> sink)
+  {
+    Ptr<Node> node = sink->GetNode ();
+    std::ostringstream name;
+    name << "node" << node->GetId ();
+    for (uint32_t a = 0; a < node->GetNApplications (); ++a)
+      {
+        if (node->GetApplication (a) == sink)
+          {
+            name << "/app" << a;
+            break;
+          }
+      }
+    return name.str ();
+  }
+
+  // Read every counter at the start, so the first row covers one interval
+  void
+  Begin (void)
+  {
+    for (std::size_t i = 0; i < m_counters.size (); ++i)
+      {
+        m_lastRx[i] = m_counters[i] ();
+      }
+    m_event = Simulator::Schedule (m_interval, &ThroughputSampler::Sample, this);
+  }
+
+  void
+  Sample (void)
+  {
+    double scale = 8.0 / m_interval.GetSeconds () / 1e6;
+    double aggregate = 0;
+    for (std::size_t i = 0; i < m_counters.size (); ++i)
+      {
+        uint64_t rx = m_counters[i] ();
+        m_row[i] = (rx - m_lastRx[i]) * scale;
+        m_lastRx[i] = rx;
+        aggregate += m_row[i];
+      }
+    m_out << Simulator::Now ().GetSeconds () << "\t" << aggregate;
+    for (std::size_t i = 0; i < m_row.size (); ++i)
+      {
+        m_out << "\t" << m_row[i];
+      }
+    m_out << "\n";
+    m_event = Simulator::Schedule (m_interval, &ThroughputSampler::Sample, this);
+  }
+
+  std::vector<Callback<uint64_t> > m_counters;   //!< total bytes received, per sink
+  std::vector<std::string>         m_names;
+  std::vector<uint64_t>            m_lastRx;
+  std::vector<double>              m_row;
+  Time                             m_interval;
+  EventId                          m_event;
+  std::ofstream                    m_out;
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SAMPLER_H */
@@ -0,0 +1,245 @@
+#ifndef TIME_BIN_AGGREGATOR_H
+#define TIME_BIN_AGGREGATOR_H
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/stats-module.h"
+
+namespace ns3 {
+
+/**
+ * Bins probe output by simulated time before it reaches the aggregators.
+ *
+ * GnuplotHelper::PlotProbe and FileHelper::WriteProbe turn every probe
+ * value into a plot point and a formatted line.  This stage instead
+ * connects the probes itself (one per match of a wildcard path, as the
+ * helpers do) and reduces their values to one number per interval, the
+ * sum, count, minimum, maximum or mean, which one periodic event writes
+ * at the bin's start time to each GnuplotAggregator and FileAggregator
+ * added.  Output then grows with the simulated time, not the number of
+ * packets.  Empty bins are written as 0 for sum and count and skipped
+ * otherwise.
+ *
+ * \code
+ *   TimeBinAggregator bins (Seconds (1), TimeBinAggregator::SUM);
+ *   bins.ConnectProbe ("ns3::ApplicationPacketProbe", tracePath, "OutputBytes");
+ *   bins.AddAggregator (gnuplotAggregator, "bytes");
+ *   bins.AddAggregator (fileAggregator, "bytes");
+ *   bins.Start ();
+ * \endcode
+ *
+ * Probe trace sources of type TracedValueCallback::Double or ::Uint32,
+ * or Packet::SizeTracedCallback (an old and a new uint32_t size, as the
+ * packet probes' OutputBytes) are supported.
+ */
+class TimeBinAggregator
+{
+public:
+  enum Mode
+  {
+    SUM,
+    COUNT,
+    MIN,
+    MAX,
+    MEAN
+  };
+
+  TimeBinAggregator (Time interval, Mode mode)
+    : m_interval (interval),
+      m_mode (mode)
+  {
+    Reset ();
+  }
+
+  /// "sum", "count", "min", "max" or "mean"
+  static Mode
+  ParseMode (std::string mode)
+  {
+    if (mode == "sum")
+      {
+        return SUM;
+      }
+    if (mode == "count")
+      {
+        return COUNT;
+      }
+    if (mode == "min")
+      {
+        return MIN;
+      }
+    if (mode == "max")
+      {
+        return MAX;
+      }
+    NS_ABORT_MSG_UNLESS (mode == "mean", "Unknown bin mode " << mode);
+    return MEAN;
+  }
+
+  /**
+   * Create a \p probeType probe on every match of \p path, which ends in
+   * the trace source the probe connects to, and bin the probe's
+   * \p traceSource.
+   */
+  void
+  ConnectProbe (std::string probeType, std::string path, std::string traceSource)
+  {
+    TypeId tid = TypeId::LookupByName (probeType);
+    struct TypeId::TraceSourceInformation info;
+    NS_ABORT_MSG_UNLESS (tid.LookupTraceSourceByName (traceSource, &info),
+                         probeType << " has no trace source " << traceSource);
+    bool isDouble = info.callback.find ("Double") != std::string::npos;
+    bool isUint32 = info.callback.find ("Uint32") != std::string::npos
+      || info.callback == "ns3::Packet::SizeTracedCallback";
+    NS_ABORT_MSG_UNLESS (isDouble || isUint32,
+                         "Cannot bin " << probeType << "::" << traceSource << " (" << info.callback << ")");
+
+    // As GnuplotHelper: match the objects, then append the traced source
+    std::size_t lastSlash = path.find_last_of ("/");
+    NS_ABORT_MSG_IF (lastSlash == std::string::npos, "No trace source in " << path);
+    std::string objects = path.substr (0, lastSlash);
+    std::string source = path.substr (lastSlash + 1);
+    Config::MatchContainer matches = Config::LookupMatches (objects);
+    NS_ABORT_MSG_IF (matches.GetN () == 0, "No match for " << objects);
+    for (uint32_t i = 0; i < matches.GetN (); ++i)
+      {
+        ObjectFactory factory;
+        factory.SetTypeId (tid);
+        Ptr<Probe> probe = factory.Create ()->GetObject<Probe> ();
+        NS_ABORT_MSG_UNLESS (probe->ConnectByPath (matches.GetMatchedPath (i) + "/" + source),
+                             "Cannot connect " << probeType << " to " << matches.GetMatchedPath (i) << "/" << source);
+        if (isDouble)
+          {
+            probe->TraceConnectWithoutContext (traceSource, MakeCallback (&TimeBinAggregator::RecordDouble, this));
+          }
+        else
+          {
+            probe->TraceConnectWithoutContext (traceSource, MakeCallback (&TimeBinAggregator::RecordUint32, this));
+          }
+        m_probes.push_back (probe);
+      }
+  }
+
+  /// Write each bin to \p aggregator as a point of dataset \p context
+  void
+  AddAggregator (Ptr<GnuplotAggregator> aggregator, std::string context)
+  {
+    m_gnuplot.push_back (aggregator);
+    m_gnuplotContext.push_back (context);
+  }
+
+  /// Write each bin to \p aggregator as a line of \p context
+  void
+  AddAggregator (Ptr<FileAggregator> aggregator, std::string context)
+  {
+    m_file.push_back (aggregator);
+    m_fileContext.push_back (context);
+  }
+
+  void
+  Start (void)
+  {
+    m_binStart = Simulator::Now ();
+    m_event = Simulator::Schedule (m_interval, &TimeBinAggregator::CloseBin, this);
+  }
+
+  /// Write the partial last bin; call after Simulator::Run
+  void
+  Flush (void)
+  {
+    m_event.Cancel ();
+    if (Simulator::Now () > m_binStart)
+      {
+        WriteBin ();
+      }
+    Reset ();
+    m_binStart = Simulator::Now ();
+  }
+
+private:
+  void
+  Reset (void)
+  {
+    m_count = 0;
+    m_sum = 0;
+    m_min = std::numeric_limits<double>::max ();
+    m_max = -std::numeric_limits<double>::max ();
+  }
+
+  void
+  Record (double value)
+  {
+    ++m_count;
+    m_sum += value;
+    m_min = std::min (m_min, value);
+    m_max = std::max (m_max, value);
+  }
+
+  void RecordDouble (double oldValue, double newValue) { Record (newValue); }
+  void RecordUint32 (uint32_t oldValue, uint32_t newValue) { Record (newValue); }
+
+  void
+  CloseBin (void)
+  {
+    WriteBin ();
+    Reset ();
+    m_binStart = Simulator::Now ();
+    m_event = Simulator::Schedule (m_interval, &TimeBinAggregator::CloseBin, this);
+  }
+
+  void
+  WriteBin (void)
+  {
+    if (m_count > 0 || m_mode == SUM || m_mode == COUNT)
+      {
+        double value;
+        switch (m_mode)
+          {
+          case SUM:
+            value = m_sum;
+            break;
+          case COUNT:
+            value = m_count;
+            break;
+          case MIN:
+            value = m_min;
+            break;
+          case MAX:
+            value = m_max;
+            break;
+          default:
+            value = m_sum / m_count;
+            break;
+          }
+        double t = m_binStart.GetSeconds ();
+        for (std::size_t i = 0; i < m_gnuplot.size (); ++i)
+          {
+            m_gnuplot[i]->Write2d (m_gnuplotContext[i], t, value);
+          }
+        for (std::size_t i = 0; i < m_file.size (); ++i)
+          {
+            m_file[i]->Write2d (m_fileContext[i], t, value);
+          }
+      }
+  }
+
+  Time                                 m_interval;
+  Mode                                 m_mode;
+  std::vector<Ptr<Probe> >             m_probes;
+  std::vector<Ptr<GnuplotAggregator> > m_gnuplot;
+  std::vector<std::string>             m_gnuplotContext;
+  std::vector<Ptr<FileAggregator> >    m_file;
+  std::vector<std::string>             m_fileContext;
+  Time                                 m_binStart;
+  uint64_t                             m_count;
+  double                               m_sum;
+  double                               m_min;
+  double                               m_max;
+  EventId                              m_event;
+};
+
+} // namespace ns3
+
+#endif /* TIME_BIN_AGGREGATOR_H */
@@ -0,0 +1,430 @@
+#ifndef TOPOLOGY_BUILDER_H
+#define TOPOLOGY_BUILDER_H
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+namespace ns3 {
+
+/**
+ * Point-to-point topology builder for dumbbell, parking-lot and
+ * leaf-spine layouts with any number of senders and receivers.
+ *
+ * Building is split into the same three steps the hand-written scenarios
+ * use, so queue discs can still be installed between the stack and the
+ * addresses:
+ *
+ * \code
+ *   TopologyBuilder topo;
+ *   topo.BuildDumbbell (2, 2, access, bottleneck, access);
+ *   topo.InstallStack (internet);
+ *   tch.Install (topo.GetCoreDevices (0));
+ *   topo.AssignIpv4Addresses (Ipv4Address ("10.1.1.0"), Ipv4Mask ("255.255.255.0"));
+ * \endcode
+ *
+ * Node ids are allocated senders first, then receivers, then routers, and
+ * links are numbered sender access links, core links, receiver access
+ * links.  Every access link is installed host first.  Each link gets its
+ * own subnet; subnets are handed out consecutively from the base network,
+ * so a 2x2 dumbbell on 10.1.1.0/24 gets the same addresses as lab2.cc's
+ * hand-built one.  SetLayout reproduces the other order some scenarios
+ * were written with, so that moving them to the builder changes no node
+ * id, device index or address.
+ *
+ * Addresses are assigned directly instead of through Ipv4AddressHelper,
+ * whose global duplicate-address bookkeeping grows with every
+ * non-contiguous allocation and dominates setup beyond a few thousand
+ * links.  The builder's address range must therefore not overlap
+ * addresses assigned elsewhere.
+ */
+class TopologyBuilder
+{
+public:
+  /// Order of node ids and devices
+  enum Layout
+  {
+    /**
+     * Node ids senders, receivers, routers; links installed sender access,
+     * core, receiver access, every access link host first (the default)
+     */
+    LAYOUT_DEFAULT,
+    /**
+     * As prob1_new.cc's hand-built dumbbell: node ids senders, routers,
+     * receivers; receiver access links installed router first and before
+     * the core link, so the right router numbers its devices towards the
+     * receivers first.  Only for BuildDumbbell.
+     */
+    LAYOUT_RECEIVERS_LAST
+  };
+
+  TopologyBuilder ()
+    : m_layout (LAYOUT_DEFAULT),
+      m_rssBefore (0),
+      m_rssAfter (0),
+      m_buildSeconds (0),
+      m_stackSeconds (0),
+      m_addressSeconds (0)
+  {
+  }
+
+  /// Call before building (default LAYOUT_DEFAULT)
+  void SetLayout (Layout layout) { m_layout = layout; }
+
+  /**
+   * Senders hang off the left router, receivers off the right router and
+   * the two routers share one bottleneck link (core link 0).
+   */
+  void
+  BuildDumbbell (uint32_t nLeft, uint32_t nRight,
+                 PointToPointHelper leftLink, PointToPointHelper bottleneckLink,
+                 PointToPointHelper rightLink)
+  {
+    StartBuild (nLeft, nRight, 2);
+    for (uint32_t i = 0; i < nLeft; ++i)
+      {
+        m_leftLink.push_back (AddLink (leftLink, m_left.Get (i), m_routers.Get (0)));
+      }
+    if (m_layout == LAYOUT_RECEIVERS_LAST)
+      {
+        for (uint32_t i = 0; i < nRight; ++i)
+          {
+            m_rightLink.push_back (AddLink (rightLink, m_routers.Get (1), m_right.Get (i)));
+          }
+        m_coreLink.push_back (AddLink (bottleneckLink, m_routers.Get (0), m_routers.Get (1)));
+      }
+    else
+      {
+        m_coreLink.push_back (AddLink (bottleneckLink, m_routers.Get (0), m_routers.Get (1)));
+        for (uint32_t i = 0; i < nRight; ++i)
+          {
+            m_rightLink.push_back (AddLink (rightLink, m_right.Get (i), m_routers.Get (1)));
+          }
+      }
+    EndBuild ();
+  }
+
+  /**
+   * A chain of nHops + 1 routers joined by hop links (core links 0 to
+   * nHops - 1).  Sender/receiver 0 is the long flow from the first to the
+   * last router; for every hop h, crossPerHop further sender/receiver
+   * pairs attach to routers h and h + 1.
+   */
+  void
+  BuildParkingLot (uint32_t nHops, uint32_t crossPerHop,
+                   PointToPointHelper accessLink, PointToPointHelper hopLink)
+  {
+    NS_ABORT_MSG_IF (m_layout != LAYOUT_DEFAULT, "Only BuildDumbbell has another layout");
+    uint32_t nFlows = 1 + nHops * crossPerHop;
+    StartBuild (nFlows, nFlows, nHops + 1);
+    m_leftLink.push_back (AddLink (accessLink, m_left.Get (0), m_routers.Get (0)));
+    for (uint32_t h = 0; h < nHops; ++h)
+      {
+        for (uint32_t c = 0; c < crossPerHop; ++c)
+          {
+            uint32_t flow = 1 + h * crossPerHop + c;
+            m_leftLink.push_back (AddLink (accessLink, m_left.Get (flow), m_routers.Get (h)));
+          }
+      }
+    for (uint32_t h = 0; h < nHops; ++h)
+      {
+        m_coreLink.push_back (AddLink (hopLink, m_routers.Get (h), m_routers.Get (h + 1)));
+      }
+    m_rightLink.push_back (AddLink (accessLink, m_right.Get (0), m_routers.Get (nHops)));
+    for (uint32_t h = 0; h < nHops; ++h)
+      {
+        for (uint32_t c = 0; c < crossPerHop; ++c)
+          {
+            uint32_t flow = 1 + h * crossPerHop + c;
+            m_rightLink.push_back (AddLink (accessLink, m_right.Get (flow), m_routers.Get (h + 1)));
+          }
+      }
+    EndBuild ();
+  }
+
+  /**
+   * nLeaf leaf switches fully meshed to nSpine spine switches (routers are
+   * the leaves followed by the spines; core link l * nSpine + s joins leaf
+   * l to spine s).  Senders are spread round-robin over the leaves
+   * starting at leaf 0, receivers round-robin starting at leaf nLeaf / 2,
+   * so with two or more leaves most flows cross the spine.
+   */
+  void
+  BuildLeafSpine (uint32_t nSenders, uint32_t nReceivers, uint32_t nLeaf, uint32_t nSpine,
+                  PointToPointHelper hostLink, PointToPointHelper fabricLink)
+  {
+    NS_ASSERT (nLeaf > 0 && nSpine > 0);
+    NS_ABORT_MSG_IF (m_layout != LAYOUT_DEFAULT, "Only BuildDumbbell has another layout");
+    StartBuild (nSenders, nReceivers, nLeaf + nSpine);
+    for (uint32_t i = 0; i < nSenders; ++i)
+      {
+        m_leftLink.push_back (AddLink (hostLink, m_left.Get (i), m_routers.Get (i % nLeaf)));
+      }
+    for (uint32_t l = 0; l < nLeaf; ++l)
+      {
+        for (uint32_t s = 0; s < nSpine; ++s)
+          {
+            m_coreLink.push_back (AddLink (fabricLink, m_routers.Get (l), m_routers.Get (nLeaf + s)));
+          }
+      }
+    for (uint32_t i = 0; i < nReceivers; ++i)
+      {
+        uint32_t leaf = (nLeaf / 2 + i) % nLeaf;
+        m_rightLink.push_back (AddLink (hostLink, m_right.Get (i), m_routers.Get (leaf)));
+      }
+    EndBuild ();
+  }
+
+  /**
+   * Assign nodes to partitions of a distributed (MPI) simulation, one
+   * system id per node in node id order (senders, receivers, routers by
+   * default; see SetLayout).
+   * Links whose ends differ become cut links with remote channels.  Call
+   * before building; without it every node is on system 0.
+   */
+  void
+  SetSystemIds (const std::vector<uint32_t> &systemIds)
+  {
+    m_systemIds = systemIds;
+  }
+
+  void
+  InstallStack (InternetStackHelper &stack)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    stack.Install (m_all);
+    m_stackSeconds = Elapsed (start);
+    m_rssAfter = GetRssBytes ();
+  }
+
+  /**
+   * Give every link its own subnet of size \p mask, starting at \p network
+   * and stepping by the subnet size, in order sender access, core and
+   * receiver access links whatever the layout.  The first device
+   * installed on a link gets host address 1 and the second host address 2.
+   */
+  void
+  AssignIpv4Addresses (Ipv4Address network, Ipv4Mask mask)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    uint32_t step = ~mask.Get () + 1;
+    NS_ABORT_MSG_IF (step < 4, "Subnets need room for two hosts");
+    uint64_t last = network.Get () + static_cast<uint64_t> (step) * GetNLinks ();
+    NS_ABORT_MSG_IF (last > 0xffffffffULL, "Address space exhausted: use a smaller subnet mask");
+
+    m_interfaces.resize (m_devices.size ());
+    m_addresses.resize (m_devices.size ());
+    std::vector<uint32_t> links (m_leftLink);
+    links.insert (links.end (), m_coreLink.begin (), m_coreLink.end ());
+    links.insert (links.end (), m_rightLink.begin (), m_rightLink.end ());
+    uint32_t net = network.Get ();
+    for (std::size_t l = 0; l < links.size (); ++l, net += step)
+      {
+        AssignAddress (2 * links[l], Ipv4Address (net + 1), mask);
+        AssignAddress (2 * links[l] + 1, Ipv4Address (net + 2), mask);
+      }
+    m_addressSeconds = Elapsed (start);
+    m_rssAfter = GetRssBytes ();
+  }
+
+  NodeContainer GetLeft (void) const { return m_left; }
+  NodeContainer GetRight (void) const { return m_right; }
+  NodeContainer GetRouters (void) const { return m_routers; }
+  NodeContainer GetAll (void) const { return m_all; }
+
+  uint32_t GetNLinks (void) const { return m_devices.size () / 2; }
+  uint32_t GetNCoreLinks (void) const { return m_coreLink.size (); }
+
+  /// Devices of sender i's access link, sender side first.
+  NetDeviceContainer GetLeftDevices (uint32_t i) const { return GetLinkDevices (m_leftLink[i]); }
+  /// Devices of receiver i's access link, receiver side first.
+  NetDeviceContainer
+  GetRightDevices (uint32_t i) const
+  {
+    uint32_t host = RightHostDevice (i);
+    return NetDeviceContainer (m_devices[host], m_devices[host ^ 1]);
+  }
+  NetDeviceContainer GetCoreDevices (uint32_t i) const { return GetLinkDevices (m_coreLink[i]); }
+
+  NetDeviceContainer
+  GetLinkDevices (uint32_t link) const
+  {
+    return NetDeviceContainer (m_devices[2 * link], m_devices[2 * link + 1]);
+  }
+
+  /// Address of sender i on its access link.
+  Ipv4Address GetLeftAddress (uint32_t i) const { return m_addresses[2 * m_leftLink[i]]; }
+  /// Address of receiver i on its access link.
+  Ipv4Address GetRightAddress (uint32_t i) const { return m_addresses[RightHostDevice (i)]; }
+
+  Ipv4InterfaceContainer
+  GetLinkInterfaces (uint32_t link) const
+  {
+    Ipv4InterfaceContainer c;
+    for (uint32_t d = 2 * link; d < 2 * link + 2; ++d)
+      {
+        c.Add (m_devices[d]->GetNode ()->GetObject<Ipv4> (), m_interfaces[d]);
+      }
+    return c;
+  }
+
+  /// Print construction time and resident memory per node.
+  void
+  PrintReport (std::ostream &os) const
+  {
+    uint32_t n = m_all.GetN ();
+    double total = m_buildSeconds + m_stackSeconds + m_addressSeconds;
+    os << "Topology: " << n << " nodes, " << GetNLinks () << " links\n";
+    os << "  Nodes and links: " << m_buildSeconds << " s\n";
+    os << "  Internet stack:  " << m_stackSeconds << " s\n";
+    os << "  Addresses:       " << m_addressSeconds << " s\n";
+    os << "  Total:           " << total << " s (" << (n ? total * 1e6 / n : 0) << " us/node)\n";
+    if (m_rssAfter > 0)
+      {
+        uint64_t grown = m_rssAfter > m_rssBefore ? m_rssAfter - m_rssBefore : 0;
+        os << "  Memory:          " << grown / 1048576.0 << " MiB ("
+           << (n ? grown / n : 0) << " bytes/node)\n";
+      }
+  }
+
+  /// \return resident set size of this process, or 0 if unknown
+  static uint64_t
+  GetRssBytes (void)
+  {
+    std::ifstream statm ("/proc/self/statm");
+    uint64_t pages = 0;
+    uint64_t resident = 0;
+    if (!(statm >> pages >> resident))
+      {
+        return 0;
+      }
+    return resident * sysconf (_SC_PAGESIZE);
+  }
+
+private:
+  // Index in m_devices of receiver i's end of its access link
+  uint32_t
+  RightHostDevice (uint32_t i) const
+  {
+    return 2 * m_rightLink[i] + (m_layout == LAYOUT_RECEIVERS_LAST ? 1 : 0);
+  }
+
+  void
+  StartBuild (uint32_t nLeft, uint32_t nRight, uint32_t nRouters)
+  {
+    NS_ABORT_MSG_IF (m_all.GetN () > 0, "TopologyBuilder can build one topology");
+    m_rssBefore = GetRssBytes ();
+    m_buildStart = std::chrono::steady_clock::now ();
+    NS_ABORT_MSG_IF (!m_systemIds.empty () && m_systemIds.size () != nLeft + nRight + nRouters,
+                     "SetSystemIds needs one entry per node");
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < nLeft; ++i)
+      {
+        m_left.Create (1, GetSystemId (n++));
+      }
+    bool receiversLast = m_layout == LAYOUT_RECEIVERS_LAST;
+    for (uint32_t i = 0; i < nRouters && receiversLast; ++i)
+      {
+        m_routers.Create (1, GetSystemId (n++));
+      }
+    for (uint32_t i = 0; i < nRight; ++i)
+      {
+        m_right.Create (1, GetSystemId (n++));
+      }
+    for (uint32_t i = 0; i < nRouters && !receiversLast; ++i)
+      {
+        m_routers.Create (1, GetSystemId (n++));
+      }
+    m_all.Add (m_left);
+    m_all.Add (receiversLast ? m_routers : m_right);
+    m_all.Add (receiversLast ? m_right : m_routers);
+    m_devices.reserve (2 * (nLeft + nRight + nRouters));
+  }
+
+  uint32_t
+  GetSystemId (uint32_t n) const
+  {
+    return m_systemIds.empty () ? 0 : m_systemIds[n];
+  }
+
+  void
+  EndBuild (void)
+  {
+    m_buildSeconds = Elapsed (m_buildStart);
+    m_rssAfter = GetRssBytes ();
+  }
+
+  uint32_t
+  AddLink (PointToPointHelper &helper, Ptr<Node> a, Ptr<Node> b)
+  {
+    NetDeviceContainer d = helper.Install (a, b);
+    m_devices.push_back (d.Get (0));
+    m_devices.push_back (d.Get (1));
+    return m_devices.size () / 2 - 1;
+  }
+
+  // What Ipv4AddressHelper::Assign does for one device, minus the global
+  // address generator.
+  void
+  AssignAddress (std::size_t d, Ipv4Address address, Ipv4Mask mask)
+  {
+    Ptr<NetDevice> device = m_devices[d];
+    Ptr<Node> node = device->GetNode ();
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+    NS_ABORT_MSG_UNLESS (ipv4, "InstallStack must be called before AssignIpv4Addresses");
+    int32_t interface = ipv4->GetInterfaceForDevice (device);
+    if (interface == -1)
+      {
+        interface = ipv4->AddInterface (device);
+      }
+    ipv4->AddAddress (interface, Ipv4InterfaceAddress (address, mask));
+    ipv4->SetMetric (interface, 1);
+    ipv4->SetUp (interface);
+    m_interfaces[d] = interface;
+    m_addresses[d] = address;
+
+    Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer> ();
+    if (tc && !tc->GetRootQueueDiscOnDevice (device) && device->GetObject<NetDeviceQueueInterface> ())
+      {
+        TrafficControlHelper::Default ().Install (device);
+      }
+  }
+
+  static double
+  Elapsed (std::chrono::steady_clock::time_point start)
+  {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+    return d.count ();
+  }
+
+  Layout                                m_layout;
+  NodeContainer                         m_left;
+  NodeContainer                         m_right;
+  NodeContainer                         m_routers;
+  NodeContainer                         m_all;
+  std::vector<Ptr<NetDevice> >          m_devices;     //!< two per link
+  std::vector<uint32_t>                 m_interfaces;  //!< Ipv4 interface per device
+  std::vector<Ipv4Address>              m_addresses;   //!< address per device
+  std::vector<uint32_t>                 m_leftLink;
+  std::vector<uint32_t>                 m_rightLink;
+  std::vector<uint32_t>                 m_coreLink;
+  std::vector<uint32_t>                 m_systemIds;   //!< per node, empty for all 0
+  std::chrono::steady_clock::time_point m_buildStart;
+  uint64_t                              m_rssBefore;
+  uint64_t                              m_rssAfter;
+  double                                m_buildSeconds;
+  double                                m_stackSeconds;
+  double                                m_addressSeconds;
+};
+
+} // namespace ns3
+
+#endif /* TOPOLOGY_BUILDER_H */
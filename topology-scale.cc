@@ -0,0 +1,111 @@
+// Topology construction benchmark
+//
+// Builds a dumbbell, parking-lot or leaf-spine topology with
+// TopologyBuilder and reports the time and memory spent per node.  With
+// --legacy the addresses are instead assigned the way lab2.cc used to,
+// one Ipv4AddressHelper::SetBase/Assign pair per link, for comparison.
+//
+//   ./waf --run "topology-scale --topology=dumbbell --hosts=10000"
+//   ./waf --run "topology-scale --topology=leafspine --hosts=20000 --leaves=64 --spines=16"
+//   ./waf --run "topology-scale --topology=parkinglot --hops=100 --hosts=10"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+
+#include "topology-builder.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TopologyScale");
+
+static double
+Since (std::chrono::steady_clock::time_point start)
+{
+  std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+  return d.count ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string topology = "dumbbell";
+  uint32_t hosts = 1000;
+  uint32_t leaves = 16;
+  uint32_t spines = 4;
+  uint32_t hops = 10;
+  bool legacy = false;
+  bool routing = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("topology", "dumbbell, parkinglot or leafspine", topology);
+  cmd.AddValue ("hosts", "Senders (and receivers); cross flows per hop for parkinglot", hosts);
+  cmd.AddValue ("leaves", "Leaf switches for leafspine", leaves);
+  cmd.AddValue ("spines", "Spine switches for leafspine", spines);
+  cmd.AddValue ("hops", "Router hops for parkinglot", hops);
+  cmd.AddValue ("legacy", "Assign addresses with one Ipv4AddressHelper per link", legacy);
+  cmd.AddValue ("routing", "Also time Ipv4GlobalRoutingHelper::PopulateRoutingTables", routing);
+  cmd.Parse (argc, argv);
+
+  PointToPointHelper access;
+  access.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+  access.SetChannelAttribute ("Delay", StringValue ("10us"));
+  PointToPointHelper core;
+  core.SetDeviceAttribute ("DataRate", StringValue ("10Gbps"));
+  core.SetChannelAttribute ("Delay", StringValue ("50us"));
+
+  TopologyBuilder topo;
+  if (topology == "dumbbell")
+    {
+      topo.BuildDumbbell (hosts, hosts, access, core, access);
+    }
+  else if (topology == "parkinglot")
+    {
+      topo.BuildParkingLot (hops, hosts, access, core);
+    }
+  else if (topology == "leafspine")
+    {
+      topo.BuildLeafSpine (hosts, hosts, leaves, spines, access, core);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown topology " << topology);
+    }
+
+  InternetStackHelper internet;
+  topo.InstallStack (internet);
+
+  if (legacy)
+    {
+      // One /30 per link, as a hand-written scenario would do it
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      Ipv4AddressHelper ipv4;
+      uint32_t net = Ipv4Address ("10.0.0.0").Get ();
+      for (uint32_t l = 0; l < topo.GetNLinks (); ++l, net += 4)
+        {
+          ipv4.SetBase (Ipv4Address (net), Ipv4Mask ("255.255.255.252"));
+          ipv4.Assign (topo.GetLinkDevices (l));
+        }
+      std::cout << "Ipv4AddressHelper: " << Since (start) << " s\n";
+    }
+  else
+    {
+      topo.AssignIpv4Addresses (Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.255.255.252"));
+    }
+  topo.PrintReport (std::cout);
+
+  if (routing)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+      std::cout << "Global routing:    " << Since (start) << " s\n";
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
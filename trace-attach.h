@@ -0,0 +1,172 @@
+#ifndef TRACE_ATTACH_H
+#define TRACE_ATTACH_H
+
+#include <string>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/**
+ * Typed trace attachment by walking containers instead of Config paths.
+ *
+ * Config::ConnectWithoutContext resolves "/NodeList/ * /ApplicationList/ *
+ * /$ns3::PacketSink/Rx" by splitting the path and matching every segment
+ * against every node, application and aggregated object, looking types
+ * up by name as it goes.  These functions visit the same objects straight
+ * from the containers the scenario already has:
+ *
+ * \code
+ *   // Config::ConnectWithoutContext ("/NodeList/ * /ApplicationList/ * /$ns3::PacketSink/Rx", cb)
+ *   TraceAttach::Applications<PacketSink> (NodeContainer::GetGlobal (), "Rx", cb);
+ *   // Config::ConnectWithoutContext ("/NodeList/0/$ns3::Ipv4L3Protocol/Tx", cb)
+ *   TraceAttach::Aggregated<Ipv4L3Protocol> (nodes.Get (0), "Tx", cb);
+ *   // Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", cb)
+ *   TraceAttach::TcpSocket (nodes.Get (0), 0, "CongestionWindow", cb);
+ * \endcode
+ *
+ * Each returns the number of trace sources connected.  Unlike Config, a
+ * trace name the matched object does not have is a fatal error rather
+ * than a silent no-op.
+ */
+class TraceAttach
+{
+public:
+  /// Every application of type T installed on \p nodes
+  template <typename T>
+  static uint32_t
+  Applications (NodeContainer nodes, std::string traceName, const CallbackBase &cb)
+  {
+    uint32_t n = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        for (uint32_t a = 0; a < (*i)->GetNApplications (); ++a)
+          {
+            n += Connect (DynamicCast<T> ((*i)->GetApplication (a)), traceName, cb);
+          }
+      }
+    return n;
+  }
+
+  /// Every application of type T in \p apps
+  template <typename T>
+  static uint32_t
+  Applications (ApplicationContainer apps, std::string traceName, const CallbackBase &cb)
+  {
+    uint32_t n = 0;
+    for (ApplicationContainer::Iterator i = apps.Begin (); i != apps.End (); ++i)
+      {
+        n += Connect (DynamicCast<T> (*i), traceName, cb);
+      }
+    return n;
+  }
+
+  /// The object of type T aggregated to each node, like "$ns3::Ipv4L3Protocol"
+  template <typename T>
+  static uint32_t
+  Aggregated (NodeContainer nodes, std::string traceName, const CallbackBase &cb)
+  {
+    uint32_t n = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        n += Connect ((*i)->GetObject<T> (), traceName, cb);
+      }
+    return n;
+  }
+
+  /// Every device of type T on \p nodes
+  template <typename T>
+  static uint32_t
+  Devices (NodeContainer nodes, std::string traceName, const CallbackBase &cb)
+  {
+    uint32_t n = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        for (uint32_t d = 0; d < (*i)->GetNDevices (); ++d)
+          {
+            n += Connect (DynamicCast<T> ((*i)->GetDevice (d)), traceName, cb);
+          }
+      }
+    return n;
+  }
+
+  /**
+   * Socket \p index of the node's TcpL4Protocol SocketList, the objects
+   * behind ".../$ns3::TcpL4Protocol/SocketList/<index>".  Sockets only
+   * appear in the list once an application has created them.
+   */
+  static uint32_t
+  TcpSocket (Ptr<Node> node, uint32_t index, std::string traceName, const CallbackBase &cb)
+  {
+    Ptr<Object> socket = GetSocket<TcpL4Protocol> (node, index);
+    return Connect (socket, traceName, cb);
+  }
+
+  /// Every TCP socket that currently exists on \p nodes
+  static uint32_t
+  TcpSockets (NodeContainer nodes, std::string traceName, const CallbackBase &cb)
+  {
+    uint32_t n = 0;
+    for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+      {
+        Ptr<TcpL4Protocol> tcp = (*i)->GetObject<TcpL4Protocol> ();
+        if (!tcp)
+          {
+            continue;
+          }
+        ObjectVectorValue sockets;
+        tcp->GetAttribute ("SocketList", sockets);
+        for (ObjectVectorValue::Iterator s = sockets.Begin (); s != sockets.End (); ++s)
+          {
+            n += Connect (s->second, traceName, cb);
+          }
+      }
+    return n;
+  }
+
+  /// Like TcpSocket, for the UdpL4Protocol SocketList
+  static uint32_t
+  UdpSocket (Ptr<Node> node, uint32_t index, std::string traceName, const CallbackBase &cb)
+  {
+    Ptr<Object> socket = GetSocket<UdpL4Protocol> (node, index);
+    return Connect (socket, traceName, cb);
+  }
+
+private:
+  template <typename L4>
+  static Ptr<Object>
+  GetSocket (Ptr<Node> node, uint32_t index)
+  {
+    Ptr<L4> l4 = node->GetObject<L4> ();
+    if (!l4)
+      {
+        return 0;
+      }
+    ObjectVectorValue sockets;
+    l4->GetAttribute ("SocketList", sockets);
+    if (index >= sockets.GetN ())
+      {
+        return 0;
+      }
+    return sockets.Get (index);
+  }
+
+  static uint32_t
+  Connect (Ptr<Object> object, const std::string &traceName, const CallbackBase &cb)
+  {
+    if (!object)
+      {
+        return 0;
+      }
+    if (!object->TraceConnectWithoutContext (traceName, cb))
+      {
+        NS_FATAL_ERROR (object->GetInstanceTypeId ().GetName () << " has no trace source " << traceName);
+      }
+    return 1;
+  }
+};
+
+} // namespace ns3
+
+#endif /* TRACE_ATTACH_H */